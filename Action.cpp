@@ -1,18 +1,46 @@
 #include "Action.hpp"
 #include "Signal.hpp"
 #include "Slot.hpp"
+#include "Domain.hpp"
 
 namespace MPO
 {
     const TypeDef Action::m_type( "Action" );
 
-    // Register the Slot name
+    // Constructor registering the Action in the main Domain
+    Action::Action( const std::string& name ) :
+        m_name(name), m_domain(&Domain::main())
+    {
+        Action::add( name, *this );
+    }
+
+    // Register the Signal name and assign it to the Action Domain
     void Action::add( const std::string& name, AnySignal& signal )
-        { signal.setName( m_name + "::" + name ); }
+    {
+        m_signals[name] = &signal;
+        signal.setName( m_name + "::" + name );
+        signal.setDomain( *m_domain );
+    }
 
-    // Register the Slot name
+    // Register the Slot name and assign it to the Action Domain
     void Action::add( const std::string& name, AnySlot& slot )
-        { slot.setName( m_name + "::" + name ); }
+    {
+        m_slots[name] = &slot;
+        slot.setName( m_name + "::" + name );
+        slot.setDomain( *m_domain );
+    }
+
+    // Assign the registered Signals and Slots to the Domain
+    void Action::setDomain( Domain& domain )
+    {
+        m_domain = &domain;
+        for( SignalMap::const_iterator it = m_signals.begin();
+                it != m_signals.end(); ++it )
+            it->second->setDomain( domain );
+        for( SlotMap::const_iterator it = m_slots.begin();
+                it != m_slots.end(); ++it )
+            it->second->setDomain( domain );
+    }
 
     Action::ActionMap Action::m_actions;
 }
@@ -15,8 +15,10 @@
 #include <iostream>
 #include <boost/shared_ptr.hpp>
 #include <boost/enable_shared_from_this.hpp>
+#include <boost/unordered_map.hpp>
 
 #include "Message.hpp"
+#include "GraphArena.hpp"
 
 /*!
     @brief Action: Root base class of user defined Action classes.
@@ -158,6 +160,7 @@ namespace MPO
 
 class AnySlot;
 class AnySignal;
+class Domain;
 
 /**
     @brief Action root base class of user defined actions
@@ -293,12 +296,47 @@ class AnySignal;
 class Action : public boost::enable_shared_from_this<Action>
 {
     friend class Link;
+    friend class GraphArena; // GraphArena removes its Actions from the map
 
 public:
 
     /// Virtual Action destructor
     virtual ~Action() {}
 
+    /**
+     * @brief Allocate an Action with the global operator new
+     *
+     * Every Action is preceded by a header recording the GraphMemory
+     * holding it, so that any Action may be deleted by its shared pointers.
+     *
+     * @param size Size of the Action
+     * @return pointer on the memory of the Action
+     */
+    static void* operator new( size_t size );
+
+    /**
+     * @brief Allocate an Action in a GraphArena
+     *
+     * The Action is deleted when the arena is cleared, unless a shared
+     * pointer still references it.
+     *
+     * @param size Size of the Action
+     * @param arena GraphArena in which the Action is allocated
+     * @return pointer on the memory of the Action
+     */
+    static void* operator new( size_t size, GraphArena& arena );
+
+    /**
+     * @brief Release the memory of an Action allocated by new or in a
+     *        GraphArena
+     *
+     * @param ptr Pointer on the Action memory
+     */
+    static void operator delete( void* ptr );
+
+    /// Release an Action whose construction in a GraphArena failed
+    static void operator delete( void* ptr, GraphArena& arena );
+
     /// Define Action smart pointer type
     typedef boost::shared_ptr<Action> Ptr;
 
@@ -341,17 +379,20 @@ protected:
      *
      * @param name Name of the Action object instance
      */
-    Action( const std::string& name ) : m_name(name)
-    {
-        Action::add( name, *this );
-    }
+    Action( const std::string& name );
 
     /// Definition of a map of Signal member variables with their name as key
-    typedef std::map<std::string, AnySignal*> SignalMap;
+    typedef boost::unordered_map<std::string, AnySignal*> SignalMap;
 
     /// Map of registered Signal member variables
     SignalMap m_signals;
 
+    /// Definition of a map of Slot member variables with their name as key
+    typedef boost::unordered_map<std::string, AnySlot*> SlotMap;
+
+    /// Map of registered Slot member variables
+    SlotMap m_slots;
+
     /**
      * @brief Register the Slot name
      *
@@ -370,7 +411,7 @@ protected:
     void add( const std::string& name, AnySlot& slot );
 
     /// Map of string name to Action object shared pointers
-    typedef std::map<std::string, Ptr > ActionMap;
+    typedef boost::unordered_map<std::string, Ptr > ActionMap;
 
     /// Global map of registered Action instances
     static ActionMap m_actions;
@@ -409,6 +450,62 @@ public:
         return it == m_actions.end() ? nullptr : it->second.get();
     }
 
+    /**
+     * @brief Returns the Signal registered with the given name or nullptr
+     *
+     * @param name Name of the Signal in the Action
+     * @return Pointer to the Signal or nullptr if not found
+     */
+    AnySignal* getSignal( const std::string& name ) const
+    {
+        SignalMap::const_iterator it = m_signals.find( name );
+        return it == m_signals.end() ? nullptr : it->second;
+    }
+
+    /**
+     * @brief Returns the Slot registered with the given name or nullptr
+     *
+     * @param name Name of the Slot in the Action
+     * @return Pointer to the Slot or nullptr if not found
+     */
+    AnySlot* getSlot( const std::string& name ) const
+    {
+        SlotMap::const_iterator it = m_slots.find( name );
+        return it == m_slots.end() ? nullptr : it->second;
+    }
+
+    /**
+     * @brief Returns the Signal of the named Action or nullptr
+     *
+     * The Action is looked up first and then the Signal in its own map,
+     * so that the "action::signal" name doesn't have to be built.
+     *
+     * @param action Name of the Action
+     * @param name Name of the Signal in the Action
+     * @return Pointer to the Signal or nullptr if not found
+     */
+    static AnySignal* getSignal( const std::string& action,
+                                 const std::string& name )
+    {
+        Action* a = getAction( action );
+        return a ? a->getSignal( name ) : nullptr;
+    }
+
+    /**
+     * @brief Returns the Slot of the named Action or nullptr
+     *
+     * @see getSignal()
+     * @param action Name of the Action
+     * @param name Name of the Slot in the Action
+     * @return Pointer to the Slot or nullptr if not found
+     */
+    static AnySlot* getSlot( const std::string& action,
+                             const std::string& name )
+    {
+        Action* a = getAction( action );
+        return a ? a->getSlot( name ) : nullptr;
+    }
+
     /**
      * @brief Clears the map of actions
      *
@@ -428,6 +525,23 @@ public:
      */
     const std::string& name() const { return m_name; }
 
+    /**
+     * @brief Returns the dispatch Domain of the Action
+     *
+     * @return the Domain of the Action Signals and Slots
+     */
+    Domain& domain() const { return *m_domain; }
+
+    /**
+     * @brief Assign the Action and its registered Signals and Slots to
+     *        a dispatch Domain
+     *
+     * Signals and Slots registered later are also assigned to the Domain.
+     *
+     * @param domain Domain of the Action
+     */
+    void setDomain( Domain& domain );
+
     /**
      * @brief Returns the static Action instance type
      *
@@ -447,6 +561,9 @@ private:
     /// Action instance's name
     std::string m_name;
 
+    /// Dispatch Domain of the Action Signals and Slots
+    Domain* m_domain;
+
     /// The Action class type with the name "Action" and no parent class
     static const TypeDef m_type;
 };
@@ -0,0 +1,183 @@
+#ifndef ASIOADAPTOR_HPP
+#define ASIOADAPTOR_HPP
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/io_context_strand.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/atomic.hpp>
+#include <boost/bind/bind.hpp>
+#include <boost/chrono.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/make_shared.hpp>
+
+#include "Domain.hpp"
+
+namespace MPO
+{
+
+/**
+    @brief Adaptor processing a Domain from the handlers of an io_context
+
+    The adaptor owns the message notifier of its Domain. When a Message is
+    queued in the empty Domain, a single handler is posted in the strand of
+    the adaptor. The handler processes the Domain for a time slice, then
+    reposts itself if Message are still pending, so that the timers and
+    sockets handled by the io_context stay responsive, or disarms until the
+    Domain receives a Message again. Each Message thus costs no post.
+
+    @code
+        boost::asio::io_context io;
+        Domain domain;
+        ping->setDomain( domain );
+        AsioAdaptor adaptor( io, domain );
+        ...
+        io.run();
+    @endcode
+
+    Several adaptors may share an io_context run by a pool of threads:
+    each adaptor has its own strand, so that a Domain is processed by a
+    single thread at a time while distinct Domains run in parallel. The
+    Slot methods may post their own handlers in strand() to be serialized
+    with the Domain processing.
+
+    The adaptor must be created before Message are emitted in the Domain by
+    other threads. It must be destroyed from its strand or while the
+    io_context isn't running, the handlers still pending then return
+    without processing the Domain.
+
+    This header is not included by MPO.hpp, so that the library doesn't
+    depend on Boost.Asio unless an application uses the adaptor.
+*/
+class AsioAdaptor
+{
+public:
+    /// Define the strand type of the adaptor
+    typedef boost::asio::io_context::strand Strand;
+
+    /// Define the duration type of the time slices
+    typedef boost::chrono::steady_clock::duration Duration;
+
+    /**
+     * @brief Constructor attaching domain to the io_context
+     *
+     * @param io io_context running the handlers of the adaptor
+     * @param domain Domain to process
+     * @param slice Maximum time spent processing the Domain per handler
+     * @param batchSize Number of Message processed between deadline checks
+     */
+    AsioAdaptor( boost::asio::io_context& io, Domain& domain,
+                 Duration slice = boost::chrono::microseconds( 500 ),
+                 size_t batchSize = 64 ) :
+        m_state( boost::make_shared<State>( boost::ref( io ),
+                                            boost::ref( domain ),
+                                            slice, batchSize ) )
+    {
+        domain.setMessageNotifier( boost::bind( &State::notify, m_state.get() ) );
+        m_state->rearm();
+    }
+
+    /// Destructor detaching the Domain, pending handlers do nothing
+    ~AsioAdaptor()
+    {
+        m_state->stopped.store( true );
+        m_state->domain.setMessageNotifier( MessageNotifier() );
+    }
+
+    /**
+     * @brief Return the strand serializing the processing of the Domain
+     *
+     * @return the strand of the adaptor
+     */
+    Strand& strand() { return m_state->strand; }
+
+    /**
+     * @brief Return the Domain processed by the adaptor
+     *
+     * @return the processed Domain
+     */
+    Domain& domain() { return m_state->domain; }
+
+    /**
+     * @brief Return the number of handlers posted to process the Domain
+     *
+     * @return the number of posted handlers
+     */
+    size_t nbrPosts() const { return m_state->nbrPosts.load( boost::memory_order_relaxed ); }
+
+private:
+    typedef Domain::MessageNotifier MessageNotifier;
+
+    /// State shared with the posted handlers, which may outlive the adaptor
+    struct State : public boost::enable_shared_from_this<State>
+    {
+        State( boost::asio::io_context& io, Domain& domain, Duration slice,
+               size_t batchSize ) :
+            strand( io ), domain( domain ), slice( slice ),
+            batchSize( batchSize ), armed( false ), stopped( false ),
+            nbrPosts( 0 ) {}
+
+        /// Message notifier, posts the handler unless already armed
+        void notify()
+        {
+            if( !armed.exchange( true ) )
+                post();
+        }
+
+        /// Post the handler processing the Domain
+        void post()
+        {
+            nbrPosts.fetch_add( 1, boost::memory_order_relaxed );
+            boost::asio::post( strand, boost::bind( &State::run,
+                                                    shared_from_this() ) );
+        }
+
+        /// Arm the handler if Message are pending
+        void rearm()
+        {
+            boost::atomic_thread_fence( boost::memory_order_seq_cst );
+            if( !domain.empty() )
+                notify();
+        }
+
+        /// Process the Domain for a time slice and repost or disarm
+        void run()
+        {
+            if( stopped.load() )
+            {
+                armed.store( false );
+                return;
+            }
+            // A first batch is processed even if the slice is shorter
+            boost::chrono::steady_clock::time_point deadline =
+                boost::chrono::steady_clock::now() + slice;
+            domain.processBatch( batchSize );
+            domain.processUntil( deadline, batchSize );
+            if( !domain.empty() )
+            {
+                post();
+                return;
+            }
+            // A Message queued before disarming didn't post a handler
+            armed.store( false );
+            rearm();
+        }
+
+        Strand strand;              ///< Strand serializing the handlers
+        Domain& domain;             ///< Processed Domain
+        Duration slice;             ///< Maximum processing time per handler
+        size_t batchSize;           ///< Message processed between checks
+        boost::atomic<bool> armed;  ///< True while a handler is pending
+        boost::atomic<bool> stopped; ///< True once the adaptor is destroyed
+        boost::atomic<size_t> nbrPosts; ///< Number of posted handlers
+    };
+
+    // Non copyable
+    AsioAdaptor( const AsioAdaptor& );
+    AsioAdaptor& operator=( const AsioAdaptor& );
+
+    boost::shared_ptr<State> m_state; ///< State shared with the handlers
+};
+
+} // namespace MPO
+
+#endif // ASIOADAPTOR_HPP
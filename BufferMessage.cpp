@@ -0,0 +1,113 @@
+#include <cstring>
+#include <new>
+#include <boost/align/aligned_alloc.hpp>
+#include <boost/make_shared.hpp>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define MPO_HAS_MMAP
+#endif
+
+#include "BufferMessage.hpp"
+
+namespace MPO
+{
+    const size_t Buffer::DefaultAlignment;
+
+    namespace
+    {
+        // Buffer of aligned memory allocated on the heap
+        class AlignedBuffer : public Buffer
+        {
+        public:
+            AlignedBuffer( char* data, size_t size ) : Buffer( data, size ) {}
+            ~AlignedBuffer() { boost::alignment::aligned_free( data() ); }
+        };
+
+#ifdef MPO_HAS_MMAP
+        // Buffer mapping a file read only
+        class MappedBuffer : public Buffer
+        {
+        public:
+            MappedBuffer( char* data, size_t size ) : Buffer( data, size ) {}
+            ~MappedBuffer() { if( size() ) munmap( data(), size() ); }
+        };
+#endif
+    }
+
+    // Allocate an aligned writable Buffer
+    boost::shared_ptr<Buffer> Buffer::create( size_t size, size_t alignment )
+    {
+        if( alignment == 0 || ( alignment & ( alignment - 1 ) ) )
+            throw std::runtime_error( "Buffer alignment must be a power of 2" );
+        if( alignment < sizeof(void*) )
+            alignment = sizeof(void*);
+        char* data = static_cast<char*>(
+            boost::alignment::aligned_alloc( alignment, size ? size : 1 ) );
+        if( !data )
+            throw std::bad_alloc();
+        try
+        {
+            return boost::make_shared<AlignedBuffer>( data, size );
+        }
+        catch( ... )
+        {
+            boost::alignment::aligned_free( data );
+            throw;
+        }
+    }
+
+    // Allocate a Buffer holding a copy of data
+    Buffer::Ptr Buffer::copy( const void* data, size_t size, size_t alignment )
+    {
+        boost::shared_ptr<Buffer> buffer = create( size, alignment );
+        if( size )
+            std::memcpy( buffer->data(), data, size );
+        return buffer;
+    }
+
+    // Map a file read only, an empty file gives an empty Buffer
+    Buffer::Ptr Buffer::map( const std::string& path )
+    {
+#ifdef MPO_HAS_MMAP
+        int fd = open( path.c_str(), O_RDONLY );
+        if( fd < 0 )
+            throw std::runtime_error( "Buffer can't open " + path );
+        struct stat st;
+        if( fstat( fd, &st ) != 0 )
+        {
+            close( fd );
+            throw std::runtime_error( "Buffer can't stat " + path );
+        }
+        size_t size = static_cast<size_t>( st.st_size );
+        void* data = nullptr;
+        if( size )
+        {
+            data = mmap( nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0 );
+            if( data == MAP_FAILED )
+            {
+                close( fd );
+                throw std::runtime_error( "Buffer can't map " + path );
+            }
+        }
+        close( fd );
+        try
+        {
+            return boost::make_shared<MappedBuffer>( static_cast<char*>( data ),
+                                                     size );
+        }
+        catch( ... )
+        {
+            if( size )
+                munmap( data, size );
+            throw;
+        }
+#else
+        throw std::runtime_error( "Buffer can't map " + path +
+                                  ", mmap is not supported" );
+#endif
+    }
+}
@@ -0,0 +1,256 @@
+#ifndef BUFFERMESSAGE_HPP
+#define BUFFERMESSAGE_HPP
+
+#include <cstddef>
+#include <string>
+#include <stdexcept>
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
+
+#include "MessagePool.hpp"
+
+namespace MPO
+{
+
+/**
+    @brief Reference counted block of memory holding a Message payload
+
+    A Buffer is created writable with create(), filled by its producer and
+    then shared read only through BufferSlice instances, so that Message
+    referring to it may be fanned out to many Slots and to other Domains
+    without copying the payload. Its memory is aligned on 64 bytes by
+    default, which suits cache lines and vector instructions.
+
+    @code
+        boost::shared_ptr<Buffer> buffer = Buffer::create( frameSize );
+        camera.read( buffer->data(), buffer->size() );
+        frame.emit( Frame::create( BufferSlice( buffer ) ) );
+    @endcode
+
+    A Buffer may also map a file read only with map(), the payload is then
+    loaded on demand by the operating system.
+*/
+class Buffer : private boost::noncopyable
+{
+public:
+    /// Define the shared_ptr type on a shared read only Buffer
+    typedef boost::shared_ptr<const Buffer> Ptr;
+
+    /// Default alignment of the memory of created Buffers
+    static const size_t DefaultAlignment = 64;
+
+    /// Release the memory of the Buffer
+    virtual ~Buffer() {}
+
+    /// Return a pointer on the first byte, writable until the Buffer is shared
+    char* data() { return m_data; }
+
+    /// Return a pointer on the first byte of the Buffer
+    const char* data() const { return m_data; }
+
+    /// Return the number of bytes of the Buffer
+    size_t size() const { return m_size; }
+
+    /**
+     * @brief Allocate a writable Buffer
+     *
+     * @param size Number of bytes of the Buffer
+     * @param alignment Alignment of the first byte, a power of 2
+     * @return shared_ptr on the new Buffer
+     */
+    static boost::shared_ptr<Buffer> create( size_t size,
+                                             size_t alignment = DefaultAlignment );
+
+    /**
+     * @brief Allocate a Buffer holding a copy of data
+     *
+     * @param data Pointer on the bytes to copy
+     * @param size Number of bytes to copy
+     * @param alignment Alignment of the first byte, a power of 2
+     * @return shared_ptr on the new Buffer
+     */
+    static Ptr copy( const void* data, size_t size,
+                     size_t alignment = DefaultAlignment );
+
+    /**
+     * @brief Map a file read only in a Buffer
+     *
+     * The file is unmapped when the Buffer is released. Mapping is only
+     * supported on POSIX systems.
+     *
+     * @param path Path of the file to map
+     * @return shared_ptr on the Buffer mapping the file
+     * @throw std::runtime_error if the file can't be mapped
+     */
+    static Ptr map( const std::string& path );
+
+protected:
+    /**
+     * @brief Constructor of a Buffer over memory owned by the sub class
+     *
+     * @param data Pointer on the first byte
+     * @param size Number of bytes
+     */
+    Buffer( char* data, size_t size ) : m_data(data), m_size(size) {}
+
+private:
+    char* m_data;  ///< First byte of the Buffer
+    size_t m_size; ///< Number of bytes of the Buffer
+};
+
+
+/**
+    @brief Read only view on a range of bytes of a shared Buffer
+
+    A BufferSlice holds a reference on its Buffer, copying a slice or taking
+    a sub slice of it only copies the reference. The bounds of sub slices
+    are checked against the slice they are taken from.
+*/
+class BufferSlice
+{
+public:
+    /// Constructor of an empty slice
+    BufferSlice() : m_offset(0), m_size(0) {}
+
+    /**
+     * @brief Constructor of a slice covering a whole Buffer
+     *
+     * @param buffer Buffer to view
+     */
+    BufferSlice( const Buffer::Ptr& buffer ) :
+        m_buffer(buffer), m_offset(0), m_size(buffer ? buffer->size() : 0) {}
+
+    /**
+     * @brief Constructor of a slice covering a range of a Buffer
+     *
+     * @param buffer Buffer to view
+     * @param offset Offset of the first byte of the range in the Buffer
+     * @param size Number of bytes of the range
+     * @throw std::runtime_error if the range exceeds the Buffer
+     */
+    BufferSlice( const Buffer::Ptr& buffer, size_t offset, size_t size ) :
+        m_buffer(buffer), m_offset(offset), m_size(size)
+    {
+        checkRange( buffer ? buffer->size() : 0, offset, size );
+    }
+
+    /// Return a pointer on the first byte of the slice or nullptr if empty
+    const char* data() const
+        { return m_buffer ? m_buffer->data() + m_offset : nullptr; }
+
+    /// Return the number of bytes of the slice
+    size_t size() const { return m_size; }
+
+    /// Return true if the slice has no byte
+    bool empty() const { return m_size == 0; }
+
+    /// Return the Buffer viewed by the slice
+    const Buffer::Ptr& buffer() const { return m_buffer; }
+
+    /// Return the offset of the slice in its Buffer
+    size_t offset() const { return m_offset; }
+
+    /**
+     * @brief Return a slice of a range of the current one
+     *
+     * @param offset Offset of the first byte of the range in the slice
+     * @param size Number of bytes of the range
+     * @return the slice sharing the Buffer
+     * @throw std::runtime_error if the range exceeds the slice
+     */
+    BufferSlice slice( size_t offset, size_t size ) const
+    {
+        checkRange( m_size, offset, size );
+        return BufferSlice( m_buffer, m_offset + offset, size );
+    }
+
+    /**
+     * @brief Return a slice of the bytes following offset
+     *
+     * @param offset Offset of the first byte of the range in the slice
+     * @return the slice sharing the Buffer
+     * @throw std::runtime_error if offset exceeds the slice
+     */
+    BufferSlice slice( size_t offset ) const
+    {
+        checkRange( m_size, offset, 0 );
+        return slice( offset, m_size - offset );
+    }
+
+private:
+    /// Throw if the range offset, size exceeds limit bytes
+    static void checkRange( size_t limit, size_t offset, size_t size )
+    {
+        if( offset > limit || size > limit - offset )
+            throw std::runtime_error( "BufferSlice range exceeds its Buffer" );
+    }
+
+    Buffer::Ptr m_buffer; ///< Viewed Buffer
+    size_t m_offset;      ///< Offset of the slice in the Buffer
+    size_t m_size;        ///< Number of bytes of the slice
+};
+
+
+template <class TMsg, class TBase = Message>
+/*! @class BufferMessage  Base class of Message carrying a shared payload
+
+    A BufferMessage is a small pooled Message header holding a BufferSlice
+    on a large payload. Fanning it out to many Slots, or to other Domains,
+    only shares the Message, and an intermediate Action forwarding a part
+    of the payload emits a new header with a sub slice, so that the payload
+    is never copied.
+
+    @code
+        class Frame : public BufferMessage<Frame>
+        {
+        public:
+            typedef boost::shared_ptr<Frame> Ptr;
+            Frame( const BufferSlice& payload ) : BufferMessage( payload ) {}
+            ...
+        };
+
+        Frame::Ptr frame = Frame::create( BufferSlice( buffer ) );
+        Frame::Ptr header = Frame::create( frame->payload().slice( 0, 64 ) );
+    @endcode
+
+    The header is created by PooledMessage::create() and the TypeDef of the
+    class must be defined with TBase as parent class. The clone of a header
+    made by Message::mutate() shares its payload.
+*/
+class BufferMessage : public PooledMessage<TMsg, TBase>
+{
+public:
+    /// Return the payload slice
+    const BufferSlice& payload() const { return m_payload; }
+
+    /// Return a pointer on the first byte of the payload
+    const char* data() const { return m_payload.data(); }
+
+    /// Return the number of bytes of the payload
+    size_t size() const { return m_payload.size(); }
+
+protected:
+    /// Constructor of a Message without payload
+    BufferMessage() {}
+
+    /**
+     * @brief Constructor of a Message viewing payload
+     *
+     * @param payload Slice of the shared payload
+     */
+    BufferMessage( const BufferSlice& payload ) : m_payload(payload) {}
+
+    /**
+     * @brief Replace the payload, before the Message is emitted
+     *
+     * @param payload Slice of the shared payload
+     */
+    void setPayload( const BufferSlice& payload ) { m_payload = payload; }
+
+private:
+    BufferSlice m_payload; ///< Slice of the shared payload
+};
+
+} // namespace MPO
+
+#endif // BUFFERMESSAGE_HPP
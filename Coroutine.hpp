@@ -0,0 +1,537 @@
+#ifndef COROUTINE_HPP
+#define COROUTINE_HPP
+
+#include "Slot.hpp"
+#include "Signal.hpp"
+#include "Link.hpp"
+#include "Domain.hpp"
+
+// The coroutine Slots require a C++20 compiler, the header is empty
+// otherwise so that MPO.hpp may include it in any build.
+#ifdef __cpp_impl_coroutine
+
+#include <algorithm>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <boost/function.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/lock_guard.hpp>
+
+#define MPO_HAS_COROUTINES
+
+namespace MPO
+{
+
+class TaskSlotBase;
+
+/**
+    @brief Return type of the coroutine methods bound to a TaskSlot
+
+    A Task is started by its TaskSlot once the Slot method returned it. The
+    coroutine then runs until its first suspension point, where the
+    dispatcher goes on with the next Message, and is resumed later by the
+    thread processing the Domain of the TaskSlot.
+
+    @code
+        Task MyAction::request( Request::Ptr r, Link* )
+        {
+            Result::Ptr res = co_await offload( boost::bind( &work, r ) );
+            output.emit( res );
+        }
+    @endcode
+
+    Emitting a Message never suspends the coroutine: Signal::emit() queues
+    the Message and returns. The Signals the coroutine emits must belong to
+    the Domain of the TaskSlot as for any Slot method.
+*/
+class Task
+{
+public:
+    /// Promise of the Task coroutines, required by the compiler
+    struct promise_type;
+
+    /// Handle on the suspended coroutine of a Task
+    typedef std::coroutine_handle<promise_type> Handle;
+
+    /// Awaiter of the final suspension, releasing the TaskSlot
+    struct FinalAwaiter
+    {
+        bool await_ready() const noexcept { return false; }
+        void await_suspend( Handle handle ) noexcept;
+        void await_resume() const noexcept {}
+    };
+
+    struct promise_type
+    {
+        promise_type() : slot( nullptr ) {}
+
+        Task get_return_object()
+            { return Task( Handle::from_promise( *this ) ); }
+
+        /// The TaskSlot starts the coroutine once registered in the promise
+        std::suspend_always initial_suspend() const noexcept { return {}; }
+
+        FinalAwaiter final_suspend() const noexcept { return {}; }
+
+        void return_void() {}
+
+        /// The exception is propagated to the caller of the dispatcher
+        void unhandled_exception() { throw; }
+
+        TaskSlotBase* slot; ///< TaskSlot running the coroutine
+    };
+
+    /// Move constructor
+    Task( Task&& other ) : m_handle( std::exchange( other.m_handle, Handle() ) ) {}
+
+    /// Destructor destroying a coroutine never started
+    ~Task() { if( m_handle ) m_handle.destroy(); }
+
+    /**
+     * @brief Release the handle on the coroutine
+     *
+     * @return the handle, which the caller must resume or destroy
+     */
+    Handle release() { return std::exchange( m_handle, Handle() ); }
+
+private:
+    explicit Task( Handle handle ) : m_handle( handle ) {}
+
+    // Non copyable
+    Task( const Task& ) = delete;
+    Task& operator=( const Task& ) = delete;
+
+    Handle m_handle; ///< Coroutine not started yet or null
+};
+
+
+/**
+    @brief Resume a suspended Task in the Domain of its TaskSlot
+
+    A Resumer is given to the awaitables of suspendWith(). It may be called
+    once from any thread, when the awaited operation completed, to queue the
+    resumption of the coroutine in the Domain of its TaskSlot.
+*/
+class Resumer
+{
+public:
+    /// Queue the resumption of the coroutine
+    void operator()() const;
+
+private:
+    friend class TaskSlotBase;
+
+    Resumer( TaskSlotBase* slot, Task::Handle handle ) :
+        m_slot( slot ), m_handle( handle ) {}
+
+    TaskSlotBase* m_slot;   ///< TaskSlot of the coroutine
+    Task::Handle m_handle;  ///< Suspended coroutine
+};
+
+
+/**
+    @brief Base class of the TaskSlot classes
+
+    A TaskSlot starts a coroutine per received Message, one at a time: the
+    Message received while a Task is suspended are queued in the TaskSlot
+    and delivered in order once the Task completed. A slow Task thus only
+    holds up its own Slot while the Domain dispatches the Message of the
+    other Slots, and the order of the Message processed by the TaskSlot is
+    kept.
+
+    The suspended Tasks are resumed by the thread processing the Domain of
+    the TaskSlot: the Resumer emits a resumption Message through an
+    internal Link from a private Domain, whose channel is fed under a lock
+    by any thread. The TaskSlot must outlive its suspended Tasks.
+*/
+class TaskSlotBase : public AnySlot
+{
+    friend class Task;
+    friend class Resumer;
+
+public:
+    /**
+     * @brief Return the number of Message waiting for the running Task
+     *
+     * @return the number of queued Message
+     */
+    size_t pending() const { return m_pending.size(); }
+
+    /**
+     * @brief Return true while a Task is suspended
+     *
+     * @return true if a Task is running
+     */
+    bool running() const { return m_running; }
+
+    /**
+     * @brief Return a Resumer of a suspended coroutine
+     *
+     * Called by the awaitables from their await_suspend(), in the thread
+     * processing the Domain. The internal Link is moved to the current
+     * Domain of the TaskSlot first, so that the channel it uses is created
+     * by the thread the channel belongs to.
+     *
+     * @param handle Coroutine being suspended
+     * @return the Resumer of the coroutine
+     */
+    static Resumer resumer( Task::Handle handle )
+    {
+        TaskSlotBase* slot = handle.promise().slot;
+        if( &slot->m_resumeSlot.domain() != &slot->domain() )
+            slot->m_resumeSlot.setDomain( slot->domain() );
+        return Resumer( slot, handle );
+    }
+
+protected:
+    /// Message queued for a TaskSlot
+    struct Pending
+    {
+        Message::Ptr msg; ///< Received Message
+        Link* link;       ///< Link through which the Message was received
+    };
+
+    /**
+     * @brief Constructor of the TaskSlot
+     *
+     * @param type Type of Message accepted by the Slot
+     */
+    TaskSlotBase( const TypeDef& type ) :
+        AnySlot( type ), m_resumeSlot( this ), m_running( false )
+    {
+        m_resumeSignal.setDomain( resumeDomain() );
+        Link::connect( &m_resumeSignal, &m_resumeSlot, true );
+    }
+
+    /// Destructor, the suspended Tasks must have completed
+    virtual ~TaskSlotBase() {}
+
+    /**
+     * @brief Call the Slot method returning the Task of a Message
+     *
+     * @param msg Message of the Task, of the type of the Slot
+     * @param link Link through which the Message was received or nullptr
+     * @return the Task not started yet
+     */
+    virtual Task start( Message::Ptr& msg, Link* link ) = 0;
+
+    /**
+     * @brief Queue a received Message and start its Task if none is running
+     *
+     * @param msg Received Message
+     * @param link Link through which the Message was received
+     */
+    void deliver( Message::Ptr& msg, Link* link )
+    {
+        Pending p;
+        p.msg.swap( msg );
+        p.link = link;
+        m_pending.push_back( p );
+        runPending();
+    }
+
+private:
+    /// Message holding a coroutine to resume
+    class Resume : public Message
+    {
+    public:
+        typedef boost::shared_ptr<Resume> Ptr;
+
+        Resume( Task::Handle handle ) : handle( handle ) {}
+
+        static const TypeDef& Type() { return Resume::m_type; }
+        virtual const TypeDef& type() const { return Resume::Type(); }
+
+        Task::Handle handle; ///< Suspended coroutine
+    private:
+        static inline const TypeDef m_type{ "TaskSlot::Resume", &Message::Type() };
+    };
+
+    /// Source Domain of the resumption Message, never processed nor
+    /// deleted so that the jobs may resume their Task until exit
+    static Domain& resumeDomain()
+    {
+        static Domain* domain = new Domain();
+        return *domain;
+    }
+
+    /// Lock of the channels fed by the resumption Message, never deleted
+    static boost::mutex& resumeMutex()
+    {
+        static boost::mutex* mutex = new boost::mutex();
+        return *mutex;
+    }
+
+    /// Queue the resumption of a coroutine, called from any thread
+    void post( Task::Handle handle )
+    {
+        boost::lock_guard<boost::mutex> lock( resumeMutex() );
+        m_resumeSignal.emit( Resume::Ptr( new Resume( handle ) ) );
+    }
+
+    /// Resume a coroutine, in the thread processing the Domain
+    void resume( Resume::Ptr r, Link* )
+    {
+        resumeTask( r->handle );
+        runPending();
+    }
+
+    /// Called by the final awaiter of the running Task
+    void finished() { m_running = false; }
+
+    /// Resume a coroutine, destroying it if its exception escaped
+    void resumeTask( Task::Handle handle )
+    {
+        try
+        {
+            handle.resume();
+        }
+        catch( ... )
+        {
+            // The coroutine is at its final suspension point
+            handle.destroy();
+            m_running = false;
+            throw;
+        }
+    }
+
+    /// Start the queued Message in order until a Task suspends
+    void runPending()
+    {
+        while( !m_running && !m_pending.empty() )
+        {
+            Pending p = m_pending.front();
+            m_pending.pop_front();
+            if( p.link && std::find( m_links.begin(), m_links.end(), p.link ) == m_links.end() )
+                p.link = nullptr; // disconnected while the Message was queued
+            Task::Handle handle = start( p.msg, p.link ).release();
+            if( !handle )
+                continue;
+            handle.promise().slot = this;
+            m_running = true;
+            resumeTask( handle );
+        }
+    }
+
+    Signal<Resume> m_resumeSignal;      ///< Emits the resumption Message
+    Slot<Resume, TaskSlotBase, &TaskSlotBase::resume> m_resumeSlot; ///< Resumes in the Domain
+    std::deque<Pending> m_pending;      ///< Message waiting for the running Task
+    bool m_running;                     ///< True while a Task is suspended
+};
+
+// Destroy the completed coroutine and release its TaskSlot
+inline void Task::FinalAwaiter::await_suspend( Handle handle ) noexcept
+{
+    TaskSlotBase* slot = handle.promise().slot;
+    handle.destroy();
+    if( slot )
+        slot->finished();
+}
+
+// Queue the resumption in the Domain of the TaskSlot
+inline void Resumer::operator()() const
+{
+    m_slot->post( m_handle );
+}
+
+
+template <class TMsg, class TObj, Task (TObj::*TMethod)(typename TMsg::Ptr, Link*)>
+/*! @class TaskSlot  Slots bound to a coroutine method returning a Task.
+
+    A TaskSlot is declared as a Slot, with a method returning a Task in
+    which the Message processing may co_await the awaitables of offload()
+    and suspendWith().
+
+    @code
+        class MyClass ...
+        {
+        public:
+            MyClass( ... ) : ..., m_slot(this), ... { ... }
+        protected:
+            Task mySlotMethod( MyMessage::Ptr m, Link * l ) { ... }
+            TaskSlot<MyMessage, MyClass, &MyClass::mySlotMethod> m_slot;
+        };
+    @endcode
+
+    The method is called for each Message once the Task of the previous
+    Message completed, the Message are meanwhile queued in the TaskSlot.
+    The coroutine is always resumed by the thread processing the Domain of
+    the TaskSlot.
+*/
+class TaskSlot : public TaskSlotBase
+{
+public:
+
+    /// Type of the current class
+    typedef TaskSlot<TMsg,TObj,TMethod> MyType;
+
+    /**
+     * @brief Constructor initializing the Slot
+     *
+     * @param obj Pointer on the object owning the Slot (this)
+     */
+    TaskSlot( TObj* obj ) : TaskSlotBase( TMsg::Type() ), m_obj( obj )
+    {
+        m_dynamicCastFunction = Function( &MyType::dynamicCastFunction, this );
+        m_staticCastFunction = Function( &MyType::staticCastFunction, this );
+    }
+
+protected:
+    /// Call the coroutine method with the queued Message
+    virtual Task start( Message::Ptr& msg, Link* link )
+    {
+        return (m_obj->*TMethod)( staticCast<TMsg>( msg ), link );
+    }
+
+private:
+    /// Queue the Message if it is an instance of TMsg
+    static void dynamicCastFunction( void* slot, Message::Ptr& msg, Link* link )
+    {
+        if( isa<TMsg>( msg ) )
+            static_cast<MyType*>(slot)->deliver( msg, link );
+    }
+
+    /// Queue the Message
+    static void staticCastFunction( void* slot, Message::Ptr& msg, Link* link )
+    {
+        if( msg )
+            static_cast<MyType*>(slot)->deliver( msg, link );
+    }
+
+    TObj* m_obj; ///< Object owning the coroutine method
+};
+
+
+/// Function running a job in another thread, as a thread pool would
+typedef boost::function<void ( const boost::function<void ()>& )> Executor;
+
+namespace detail
+{
+    /// Result of a job run by offload()
+    template <class R>
+    struct JobResult
+    {
+        template <class F> void run( F& f ) { value.emplace( f() ); }
+        R get() { return std::move( *value ); }
+        std::optional<R> value;
+    };
+
+    template <>
+    struct JobResult<void>
+    {
+        template <class F> void run( F& f ) { f(); }
+        void get() {}
+    };
+
+    /// Awaiter starting an operation given a Resumer
+    template <class F>
+    struct SuspendAwaiter
+    {
+        bool await_ready() const { return false; }
+        void await_suspend( Task::Handle handle )
+            { start( TaskSlotBase::resumer( handle ) ); }
+        void await_resume() const {}
+        F start; ///< Function starting the operation
+    };
+
+    /// Awaiter running a job with an Executor
+    template <class F>
+    class OffloadAwaiter
+    {
+        typedef std::invoke_result_t<F&> R;
+    public:
+        OffloadAwaiter( F f, const Executor& executor ) :
+            m_f( std::move( f ) ), m_executor( executor ) {}
+
+        bool await_ready() const { return false; }
+
+        void await_suspend( Task::Handle handle )
+        {
+            Resumer resume = TaskSlotBase::resumer( handle );
+            boost::function<void ()> job = [this, resume]()
+            {
+                try
+                {
+                    m_result.run( m_f );
+                }
+                catch( ... )
+                {
+                    m_error = std::current_exception();
+                }
+                resume();
+            };
+            if( m_executor )
+                m_executor( job );
+            else
+                boost::thread( job ).detach();
+        }
+
+        R await_resume()
+        {
+            if( m_error )
+                std::rethrow_exception( m_error );
+            return m_result.get();
+        }
+
+    private:
+        F m_f;                    ///< Job to run
+        Executor m_executor;      ///< Executor of the job or empty
+        JobResult<R> m_result;    ///< Value returned by the job
+        std::exception_ptr m_error; ///< Exception thrown by the job
+    };
+}
+
+/**
+ * @brief Return an awaitable running a job in another thread
+ *
+ * The coroutine is suspended while the job runs and is resumed in the
+ * Domain of its TaskSlot. The co_await expression returns the value
+ * returned by the job or rethrows its exception.
+ *
+ * GCC before version 13 destroys twice the lambda temporaries of a
+ * co_await expression, the job should then be a named variable.
+ *
+ * @param f Job to run
+ * @param executor Function running the job in a pool thread or empty to
+ *                 run it in a new thread
+ * @return the awaitable
+ */
+template <class F>
+detail::OffloadAwaiter<F> offload( F f, const Executor& executor = Executor() )
+{
+    return detail::OffloadAwaiter<F>( std::move( f ), executor );
+}
+
+/**
+ * @brief Return an awaitable suspending the coroutine until resumed
+ *
+ * The function is called with the Resumer of the coroutine when it is
+ * suspended, it starts an operation, such as an asynchronous I/O, whose
+ * completion handler calls the Resumer from any thread.
+ *
+ * @code
+ *     co_await suspendWith( [&]( Resumer resume ) {
+ *         socket.async_read_some( buffer, [&, resume]( auto, size_t n )
+ *             { received = n; resume(); } );
+ *     } );
+ * @endcode
+ *
+ * @param start Function starting the operation
+ * @return the awaitable
+ */
+template <class F>
+detail::SuspendAwaiter<F> suspendWith( F start )
+{
+    return detail::SuspendAwaiter<F>{ std::move( start ) };
+}
+
+} // namespace MPO
+
+#endif // __cpp_impl_coroutine
+
+#endif // COROUTINE_HPP
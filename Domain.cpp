@@ -0,0 +1,20 @@
+#include "Domain.hpp"
+
+namespace MPO
+{
+    // Return the main Domain using the global emitted Message queue
+    Domain& Domain::main()
+    {
+        static Domain domain( Message::emitted );
+        return domain;
+    }
+
+    // Return the channel from the source Domain, creating it if required
+    Message::Emitted::Channel* Domain::channelFrom( Domain& source )
+    {
+        ChannelMap::const_iterator it = m_channels.find( &source );
+        if( it != m_channels.end() )
+            return it->second;
+        return m_channels[&source] = m_emitted->addChannel();
+    }
+}
@@ -0,0 +1,235 @@
+#ifndef DOMAIN_HPP
+#define DOMAIN_HPP
+
+#include <map>
+
+#include "Message.hpp"
+
+namespace MPO
+{
+
+/**
+    @brief Dispatch Domain owning a queue of emitted Message
+
+    A Domain is a partition of the Signal and Slot network whose Message
+    queue is processed by a single thread. Signals and Slots, and all the
+    Signals and Slots of an Action, are assigned to a Domain with their
+    setDomain() method. By default they belong to the main Domain whose
+    queue is the one processed by the static Message::processNext() methods.
+
+    A Message emitted by a Signal is queued in the Domain of the connected
+    Slot. When the Signal and the Slot belong to the same Domain, the entry
+    is added directly to its queue. Otherwise it is sent through a lock-free
+    single producer single consumer channel dedicated to the pair of
+    Domains. The channel is drained by the processing thread of the
+    destination Domain.
+
+    @code
+        Domain domainA, domainB;
+        pingAction->setDomain( domainA );
+        pongAction->setDomain( domainB );
+
+        // Each thread processes the Message queue of its Domain
+        boost::thread threadA( boost::bind( &run, &domainA ) );
+        boost::thread threadB( boost::bind( &run, &domainB ) );
+    @endcode
+
+    The following rules apply to keep the Domains thread safe:
+
+    @li A Signal must only emit Message from the thread processing its
+        Domain or while that thread doesn't process it.
+    @li Links must be connected and disconnected, and Domains assigned,
+        while the threads processing the concerned Domains are idle.
+    @li The message notifier of a Domain may be called by the thread of
+        any Domain sending Message to it, and must thus be thread safe.
+    @li A Domain must outlive the Signals and Slots assigned to it.
+*/
+class Domain
+{
+    friend class AnySignal;
+    friend class Link;
+
+public:
+    /// Define the Message notifier call back function type
+    typedef Message::MessageNotifier MessageNotifier;
+
+    /// Constructor of a Domain with an empty Message queue
+    Domain() : m_emitted( &m_ownEmitted ) {}
+
+    /**
+     * @brief Return the main Domain processed by Message::processNext()
+     *
+     * @return the main Domain
+     */
+    static Domain& main();
+
+    /**
+     * @brief Process the next pending Message or return false if empty
+     *
+     * @return False if the Message queue is empty
+     */
+    bool processNext() { return m_emitted->processNext(); }
+
+    /**
+     * @brief Process up to n pending Message and return the number processed
+     *
+     * @param n Maximum number of Message to process
+     * @return the number of Message forwarded to a Slot
+     */
+    size_t processBatch( size_t n ) { return m_emitted->processBatch( n ); }
+
+    /**
+     * @brief Process pending Message until the queue is empty or the deadline
+     *        is reached and return the number processed
+     *
+     * @param deadline Time point after which no new batch is started
+     * @param batchSize Number of Message processed between deadline checks
+     * @return the number of Message forwarded to a Slot
+     */
+    template <class TTimePoint>
+    size_t processUntil( const TTimePoint& deadline, size_t batchSize = 64 )
+        { return m_emitted->processUntil( deadline, batchSize ); }
+
+    /**
+     * @brief Return true if no Message is pending in the Domain
+     *
+     * @return true if no Message is pending in the Domain
+     */
+    bool empty() const { return m_emitted->empty(); }
+
+    /**
+     * @brief Return the number of Message pending in the Domain
+     *
+     * @return the number of Message pending in the Domain
+     */
+    size_t size() const { return m_emitted->size(); }
+
+    /**
+     * @brief Return the statistics of the Domain Message queue
+     *
+     * @see Message::stats()
+     * @return the statistics recorded by the Instrumentation policy
+     */
+    const Instrumentation::QueueStats& stats() const { return m_emitted->stats(); }
+
+    /**
+     * @brief set the Message queuing notification call back function
+     *
+     * @see Message::setMessageNotifier()
+     * @param messageNotifier a function pointer on the message notifier
+     *                        callback function or 0 to clear an existing
+     *                        callback.
+     */
+    void setMessageNotifier( MessageNotifier messageNotifier )
+        { m_emitted->setMessageNotifier( messageNotifier ); }
+
+    /**
+     * @brief Set the queue size at which the message notifier is called again
+     *
+     * @see Message::setHighWaterMark()
+     * @param highWaterMark Queue size triggering a notification or 0 to
+     *                      only notify when queuing in an empty queue
+     */
+    void setHighWaterMark( size_t highWaterMark )
+        { m_emitted->setHighWaterMark( highWaterMark ); }
+
+    /**
+     * @brief Enable or disable the multiple producers mode of the queue
+     *
+     * @see Message::setMultiProducer()
+     * @param multiProducer true to enable the multiple producers mode
+     */
+    void setMultiProducer( bool multiProducer )
+        { m_emitted->setMultiProducer( multiProducer ); }
+
+    /**
+     * @brief Limit the number of Message pending in the Domain
+     *
+     * @see Message::setCapacity()
+     * @param capacity Maximum number of pending Message or 0 for no limit
+     */
+    void setCapacity( size_t capacity ) { m_emitted->setCapacity( capacity ); }
+
+    /**
+     * @brief Set the policy applied when a Message is emitted in the full
+     *        queue of the Domain
+     *
+     * @see Message::setOverflowPolicy()
+     * @param policy Overflow policy
+     */
+    void setOverflowPolicy( Message::OverflowPolicy policy )
+        { m_emitted->setOverflowPolicy( policy ); }
+
+    /**
+     * @brief Set the call back function called when the queue of the Domain
+     *        is writable again
+     *
+     * @see Message::setWritableNotifier()
+     * @param writableNotifier function called when the queue is writable
+     *                         again or 0 to clear an existing one
+     */
+    void setWritableNotifier( MessageNotifier writableNotifier )
+        { m_emitted->setWritableNotifier( writableNotifier ); }
+
+    /**
+     * @brief Set the policy serving the priority lanes of the queue
+     *
+     * @see Message::setScheduling()
+     * @param scheduling Policy serving the lanes
+     */
+    void setScheduling( Message::Scheduling scheduling )
+        { m_emitted->setScheduling( scheduling ); }
+
+    /**
+     * @brief Set the number of Message processed from a lane in a round of
+     *        the WeightedRoundRobin scheduling
+     *
+     * @see Message::setLaneWeight()
+     * @param priority Priority class of the lane
+     * @param weight Number of Message processed per round
+     */
+    void setLaneWeight( Message::Priority priority, size_t weight )
+        { m_emitted->setLaneWeight( priority, weight ); }
+
+    /**
+     * @brief Return the number of Message pending in a priority lane
+     *
+     * @see Message::laneSize()
+     * @param priority Priority class of the lane
+     * @return the number of entries in the lane
+     */
+    size_t laneSize( Message::Priority priority ) const
+        { return m_emitted->laneSize( priority ); }
+
+private:
+    /**
+     * @brief Constructor of a Domain using an existing Message queue
+     *
+     * @param emitted Message queue of the Domain
+     */
+    explicit Domain( Message::Emitted& emitted ) : m_emitted( &emitted ) {}
+
+    /**
+     * @brief Return the channel through which the source Domain sends
+     *        Message to this Domain, creating it if required
+     *
+     * @param source Domain sending Message through the channel
+     * @return the channel from source to this Domain
+     */
+    Message::Emitted::Channel* channelFrom( Domain& source );
+
+    // Non copyable
+    Domain( const Domain& );
+    Domain& operator=( const Domain& );
+
+    /// Map of channels from other Domains
+    typedef std::map<Domain*, Message::Emitted::Channel*> ChannelMap;
+
+    Message::Emitted m_ownEmitted; ///< Message queue owned by the Domain
+    Message::Emitted* m_emitted;   ///< Message queue of the Domain
+    ChannelMap m_channels;         ///< Channels from other Domains
+};
+
+} // namespace MPO
+
+#endif // DOMAIN_HPP
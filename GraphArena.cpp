@@ -0,0 +1,240 @@
+#include <algorithm>
+#include <new>
+
+#include "GraphArena.hpp"
+#include "Action.hpp"
+#include "Link.hpp"
+
+namespace MPO
+{
+    // Constructor of a GraphMemory referenced by its owner
+    GraphMemory::GraphMemory( size_t blockSize ) :
+        m_blockSize( objectSize( blockSize ) ), m_block( 0 ), m_position( 0 ),
+        m_size( 0 ), m_nbrRefs( 1 ) {}
+
+    // Destructor releasing the blocks
+    GraphMemory::~GraphMemory()
+    {
+        for( size_t i = 0; i < m_blocks.size(); ++i )
+            ::operator delete( m_blocks[i].first );
+    }
+
+    // Return the memory of the next object, in the next block if the current
+    // one is full, an object larger than a block getting a block of its own
+    void* GraphMemory::allocate( size_t size )
+    {
+        size_t n = objectSize( size );
+        if( m_blocks.empty() || m_position + n > m_blocks[m_block].second )
+        {
+            if( !m_blocks.empty() )
+                ++m_block;
+            if( m_block == m_blocks.size() || m_blocks[m_block].second < n )
+            {
+                size_t capacity = std::max( n, m_blockSize );
+                m_blocks.insert( m_blocks.begin() + m_block, Block(
+                    static_cast<char*>( ::operator new( capacity ) ), capacity ) );
+            }
+            m_position = 0;
+        }
+        Header* header = reinterpret_cast<Header*>( m_blocks[m_block].first + m_position );
+        header->block.memory = this;
+        header->block.released = false;
+        m_position += n;
+        m_size += n;
+        retain();
+        return header + 1;
+    }
+
+    // Only the owner may reference the memory so that no object is overwritten
+    bool GraphMemory::rewind()
+    {
+        if( m_nbrRefs.load( boost::memory_order_acquire ) != 1 )
+            return false;
+        m_block = 0;
+        m_position = 0;
+        m_size = 0;
+        return true;
+    }
+
+    // Drop references, the objects may be released by several threads
+    void GraphMemory::release( size_t n )
+    {
+        if( n && m_nbrRefs.fetch_sub( n, boost::memory_order_acq_rel ) == n )
+            delete this;
+    }
+
+    // Allocate an object with a header recording it is not in a GraphMemory
+    void* GraphMemory::allocateHeap( size_t size )
+    {
+        Header* header = static_cast<Header*>( ::operator new( sizeof(Header) + size ) );
+        header->block.memory = nullptr;
+        header->block.released = false;
+        return header + 1;
+    }
+
+    // Release the object memory to the global heap or its GraphMemory
+    void GraphMemory::free( void* ptr )
+    {
+        if( !ptr )
+            return;
+        Header* h = header( ptr );
+        if( h->block.memory )
+        {
+            h->block.released = true;
+            h->block.memory->release();
+        }
+        else
+            ::operator delete( h );
+    }
+
+    // Allocate a Link with a header recording it is not in a GraphMemory
+    void* Link::operator new( size_t size )
+    {
+        return GraphMemory::allocateHeap( size );
+    }
+
+    // Allocate a Link in the given GraphMemory
+    void* Link::operator new( size_t size, GraphMemory& memory )
+    {
+        return memory.allocate( size );
+    }
+
+    // Release the Link memory to the global heap or its GraphMemory
+    void Link::operator delete( void* ptr )
+    {
+        GraphMemory::free( ptr );
+    }
+
+    // Release a Link whose constructor failed
+    void Link::operator delete( void* ptr, GraphMemory& )
+    {
+        GraphMemory::free( ptr );
+    }
+
+    // Allocate an Action with a header recording it is not in an arena
+    void* Action::operator new( size_t size )
+    {
+        return GraphMemory::allocateHeap( size );
+    }
+
+    // Allocate an Action in the memory of the arena
+    void* Action::operator new( size_t size, GraphArena& arena )
+    {
+        void* ptr = arena.m_memory->allocate( size );
+        arena.m_actions.push_back( ptr );
+        return ptr;
+    }
+
+    // Release the Action memory to the global heap or its GraphMemory
+    void Action::operator delete( void* ptr )
+    {
+        GraphMemory::free( ptr );
+    }
+
+    // Release an Action whose constructor failed
+    void Action::operator delete( void* ptr, GraphArena& arena )
+    {
+        std::vector<void*>::iterator it =
+                std::find( arena.m_actions.begin(), arena.m_actions.end(), ptr );
+        if( it != arena.m_actions.end() )
+            arena.m_actions.erase( it );
+        GraphMemory::free( ptr );
+    }
+
+
+    GraphArena::GraphArena( size_t blockSize ) :
+        m_blockSize( blockSize ), m_memory( new GraphMemory( blockSize ) ) {}
+
+    // Establish a connection with a Link of the arena
+    bool GraphArena::connect( AnySignal* signal, AnySlot* slot, bool forceStatic )
+    {
+        if( !signal || !slot )
+            return false;
+        if( !signal->isConnected( *slot ) )
+        {
+            signal->checkUnfrozen();
+            Link* link = new( *m_memory ) Link( *signal, *slot,
+                    forceStatic || Link::isStaticCast( *signal, *slot ) );
+            signal->connect( *slot, *link );
+            slot->connect( *link );
+            adopt( link );
+        }
+        return true;
+    }
+
+    bool GraphArena::connect( const std::string& signalName,
+                              const std::string& slotName, bool forceStatic )
+    {
+        return connect( AnySignal::get( signalName ), AnySlot::get( slotName ),
+                        forceStatic );
+    }
+
+    bool GraphArena::connect( const std::string& signalAction,
+                              const std::string& signalName,
+                              const std::string& slotAction,
+                              const std::string& slotName, bool forceStatic )
+    {
+        return connect( Action::getSignal( signalAction, signalName ),
+                        Action::getSlot( slotAction, slotName ), forceStatic );
+    }
+
+    void GraphArena::clear()
+    {
+        teardown();
+        if( !m_memory->rewind() )
+        {
+            m_memory->release();
+            m_memory = new GraphMemory( m_blockSize );
+        }
+    }
+
+    GraphArena::~GraphArena()
+    {
+        teardown();
+        m_memory->release();
+    }
+
+    // The Links deleted individually released their memory already. The
+    // detached Links are never deleted, their references are handed over
+    // to the Message queues holding their entries, one per queue. The arena
+    // keeps its own reference
+    void GraphArena::teardown()
+    {
+        std::vector<Message::Emitted*> queues;
+        size_t nbrDetached = 0;
+        for( size_t i = 0; i < m_links.size(); ++i )
+        {
+            Link* link = m_links[i];
+            if( GraphMemory::header( link )->block.released || !link->m_connected )
+                continue;
+            link->m_signal->disconnect( *link->m_slot );
+            link->m_slot->disconnect( *link );
+            link->m_connected = false;
+            if( std::find( queues.begin(), queues.end(), link->m_queue ) == queues.end() )
+                queues.push_back( link->m_queue );
+            ++nbrDetached;
+        }
+        for( size_t i = 0; i < queues.size(); ++i )
+        {
+            m_memory->retain();
+            queues[i]->retire( m_memory );
+        }
+        m_memory->release( nbrDetached );
+        m_links.clear();
+
+        // Deleting an Action of the arena releases its memory. The Actions
+        // are recognised by their address, since the header of an Action
+        // that wasn't allocated with new may not be read
+        std::sort( m_actions.begin(), m_actions.end() );
+        for( Action::ActionMap::iterator it = Action::m_actions.begin();
+             !m_actions.empty() && it != Action::m_actions.end(); )
+        {
+            void* ptr = dynamic_cast<void*>( it->second.get() );
+            if( std::binary_search( m_actions.begin(), m_actions.end(), ptr ) )
+                it = Action::m_actions.erase( it );
+            else
+                ++it;
+        }
+        m_actions.clear();
+    }
+}
@@ -0,0 +1,274 @@
+#ifndef GRAPHARENA_HPP
+#define GRAPHARENA_HPP
+
+#include <string>
+#include <utility>
+#include <vector>
+#include <boost/atomic.hpp>
+
+#include "Type.hpp"
+
+namespace MPO
+{
+
+class AnySignal;
+class AnySlot;
+class Link;
+class Action;
+
+/**
+    @brief Reference counted blocks of memory holding Links and Actions
+
+    Every Link and Action is preceded by a header recording the GraphMemory
+    holding it, or nullptr if it was allocated with the global operator new,
+    so that any of them may be released with delete. The objects allocated
+    in a GraphMemory are laid out contiguously in blocks, and each of them
+    references the GraphMemory as well as its owner. The blocks are released
+    when the last reference is dropped.
+*/
+class GraphMemory
+{
+public:
+    /// Header preceding the memory of every Link and Action
+    union Header
+    {
+        struct
+        {
+            GraphMemory* memory; ///< Memory holding the object or nullptr
+            bool released;       ///< True once the object was deleted
+        } block;
+        long double align;       ///< Keep the objects aligned
+    };
+
+    /**
+     * @brief Constructor of a GraphMemory referenced by its owner
+     *
+     * @param blockSize Size of the blocks of memory
+     */
+    explicit GraphMemory( size_t blockSize );
+
+    /**
+     * @brief Return the memory of a new object, which references the
+     *        GraphMemory
+     *
+     * @param size Size of the object
+     * @return pointer on the memory of the object, following its header
+     */
+    void* allocate( size_t size );
+
+    /// Add a reference
+    void retain() { m_nbrRefs.fetch_add( 1, boost::memory_order_relaxed ); }
+
+    /**
+     * @brief Drop references, deleting the GraphMemory on the last one
+     *
+     * @param n Number of references to drop
+     */
+    void release( size_t n = 1 );
+
+    /**
+     * @brief Reuse the blocks for new objects, once no object references
+     *        the GraphMemory
+     *
+     * @return false if the GraphMemory is still referenced by objects
+     */
+    bool rewind();
+
+    /**
+     * @brief Return the number of bytes of the allocated objects
+     *
+     * @return the used memory, headers included
+     */
+    size_t size() const { return m_size; }
+
+    /**
+     * @brief Allocate an object with the global operator new
+     *
+     * @param size Size of the object
+     * @return pointer on the memory of the object, following its header
+     */
+    static void* allocateHeap( size_t size );
+
+    /**
+     * @brief Release the memory of an object to the global heap or to its
+     *        GraphMemory
+     *
+     * @param ptr Pointer on the object memory
+     */
+    static void free( void* ptr );
+
+    /**
+     * @brief Return the header of an object
+     *
+     * @param ptr Pointer on the object memory
+     * @return the header preceding the object
+     */
+    static Header* header( const void* ptr )
+        { return static_cast<Header*>( const_cast<void*>( ptr ) ) - 1; }
+
+    /**
+     * @brief Return the size of an object and its header, keeping the
+     *        headers aligned
+     *
+     * @param size Size of the object
+     * @return the memory taken by the object in a block
+     */
+    static size_t objectSize( size_t size )
+    {
+        return ( sizeof(Header) + size + sizeof(Header) - 1 ) /
+               sizeof(Header) * sizeof(Header);
+    }
+
+private:
+    /// Destructor releasing the blocks, called by release()
+    ~GraphMemory();
+
+    // Non copyable
+    GraphMemory( const GraphMemory& );
+    GraphMemory& operator=( const GraphMemory& );
+
+    /// Block of memory and its size
+    typedef std::pair<char*, size_t> Block;
+
+    std::vector<Block> m_blocks;         ///< Blocks of memory
+    size_t m_blockSize;                  ///< Size of the blocks
+    size_t m_block;                      ///< Index of the current block
+    size_t m_position;                   ///< Used bytes of the current block
+    size_t m_size;                       ///< Bytes of the allocated objects
+    boost::atomic<size_t> m_nbrRefs;     ///< Number of objects and owners
+};
+
+
+/**
+    @brief Arena owning the Links and Actions of a network torn down at once
+
+    The Links created by connect() and the Actions allocated with the
+    placement new operator of Action are laid out contiguously in the
+    blocks of the arena. They behave as any other Link and Action and may
+    be disconnected or deleted individually.
+
+    @code
+        GraphArena arena;
+        new( arena ) Relay( "first" );
+        new( arena ) Relay( "second" );
+        arena.connect( "first", "output", "second", "input" );
+        ...
+        arena.clear();
+    @endcode
+
+    Clearing or destroying the arena tears the network down. Its Links are
+    detached from their Signals and Slots without being retired one by
+    one, the blocks of memory are instead handed once to each Message
+    queue holding their entries, which releases them after processing the
+    entries queued before. Its Actions are then removed from the Action map,
+    which deletes them unless a shared pointer still references them, and
+    their Signals and Slots disconnect the other Links as usual. The arena
+    must be cleared by the thread processing the Domains of its Links,
+    like Link::disconnect().
+*/
+class GraphArena
+{
+    friend class Action; // Action is allocated in the arena
+    friend class Topology; // Topology builds Links in the arena
+
+public:
+    /**
+     * @brief Constructor of an empty arena
+     *
+     * @param blockSize Size of the blocks of memory
+     */
+    explicit GraphArena( size_t blockSize = 64 << 10 );
+
+    /// Destructor tearing down the network of the arena
+    ~GraphArena();
+
+    /**
+     * @brief Establish a connection from a Signal to a Slot with a Link
+     *        of the arena
+     *
+     * @param signal Signal to connect from
+     * @param slot Slot to connect to
+     * @param forceStatic true if a static cast must always be performed
+     * @return false if signal or slot is a nullptr
+     * @throws runtime_error if signal is frozen
+     */
+    bool connect( AnySignal* signal, AnySlot* slot, bool forceStatic = false );
+
+    /**
+     * @brief Establish a connection from a named Signal to a named Slot
+     *        with a Link of the arena
+     *
+     * @param signalName Name of Signal to connect from
+     * @param slotName Name of Slot to connect to
+     * @param forceStatic true if a static cast must always be performed
+     * @return false if the signal or slot was not found
+     */
+    bool connect( const std::string& signalName, const std::string& slotName,
+                  bool forceStatic = false );
+
+    /**
+     * @brief Establish a connection from a Signal of an Action to a Slot of
+     *        an Action with a Link of the arena
+     *
+     * @param signalAction Name of the Action owning the Signal
+     * @param signalName Name of the Signal in its Action
+     * @param slotAction Name of the Action owning the Slot
+     * @param slotName Name of the Slot in its Action
+     * @param forceStatic true if a static cast must always be performed
+     * @return false if the signal or slot was not found
+     */
+    bool connect( const std::string& signalAction, const std::string& signalName,
+                  const std::string& slotAction, const std::string& slotName,
+                  bool forceStatic = false );
+
+    /**
+     * @brief Tear down the Links and Actions of the arena, which may be
+     *        reused
+     *
+     * The blocks of memory are kept for the new Links and Actions if no
+     * Message queue holds entries of the Links and no shared pointer holds
+     * an Action.
+     */
+    void clear();
+
+    /**
+     * @brief Return the number of Links created in the arena
+     *
+     * @return the number of Links, including the disconnected ones
+     */
+    size_t nbrLinks() const { return m_links.size(); }
+
+    /**
+     * @brief Return the number of Actions allocated in the arena
+     *
+     * @return the number of Actions, including the deleted ones
+     */
+    size_t nbrActions() const { return m_actions.size(); }
+
+    /**
+     * @brief Return the number of bytes of the objects of the arena
+     *
+     * @return the used memory
+     */
+    size_t size() const { return m_memory->size(); }
+
+private:
+    /// Remember a Link created in the arena for the teardown
+    void adopt( Link* link ) { m_links.push_back( link ); }
+
+    /// Detach the Links, delete the Actions and drop the memory
+    void teardown();
+
+    // Non copyable
+    GraphArena( const GraphArena& );
+    GraphArena& operator=( const GraphArena& );
+
+    size_t m_blockSize;         ///< Size of the blocks of memory
+    GraphMemory* m_memory;      ///< Memory of the Links and Actions
+    std::vector<Link*> m_links; ///< Links created in the arena
+    std::vector<void*> m_actions; ///< Memory of the Actions allocated
+};
+
+} // namespace MPO
+
+#endif // GRAPHARENA_HPP
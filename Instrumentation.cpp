@@ -0,0 +1,51 @@
+#include <cmath>
+#include <algorithm>
+
+#include "Instrumentation.hpp"
+
+namespace MPO
+{
+    const size_t Histogram::SubBuckets;
+    const size_t Histogram::NbrBuckets;
+    const bool NullInstrumentation::enabled;
+    const bool CounterInstrumentation::enabled;
+
+    // Upper bound of the bucket holding the value of rank p percent
+    boost::uint64_t HistogramSnapshot::percentile( double p ) const
+    {
+        if( count == 0 )
+            return 0;
+        boost::uint64_t rank = boost::uint64_t( std::ceil( p / 100 * count ) );
+        if( rank == 0 )
+            rank = 1;
+        boost::uint64_t cumulated = 0;
+        for( size_t i = 0; i + 1 < buckets.size(); ++i )
+        {
+            cumulated += buckets[i];
+            if( cumulated >= rank )
+                return std::min( Histogram::lowerBound( i + 1 ) - 1, max );
+        }
+        return max;
+    }
+
+    // Constructor of an Histogram with all counters set to 0
+    Histogram::Histogram() : m_max(0)
+    {
+        for( size_t i = 0; i < NbrBuckets; ++i )
+            m_buckets[i].store( 0, boost::memory_order_relaxed );
+    }
+
+    // Copy the counters, the count is the sum of the copied buckets
+    HistogramSnapshot Histogram::snapshot() const
+    {
+        HistogramSnapshot snapshot;
+        snapshot.buckets.resize( NbrBuckets );
+        for( size_t i = 0; i < NbrBuckets; ++i )
+        {
+            snapshot.buckets[i] = m_buckets[i].load( boost::memory_order_relaxed );
+            snapshot.count += snapshot.buckets[i];
+        }
+        snapshot.max = m_max.load( boost::memory_order_relaxed );
+        return snapshot;
+    }
+}
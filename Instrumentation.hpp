@@ -0,0 +1,312 @@
+#ifndef INSTRUMENTATION_HPP
+#define INSTRUMENTATION_HPP
+
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+#include <boost/cstdint.hpp>
+#include <boost/atomic.hpp>
+#include <boost/chrono.hpp>
+
+namespace MPO
+{
+
+/// Copy of the counts of a Histogram, taken by Histogram::snapshot()
+struct HistogramSnapshot
+{
+    /// Constructor of an empty snapshot
+    HistogramSnapshot() : count(0), max(0) {}
+
+    /**
+     * @brief Return the value below which p percent of the values are
+     *
+     * The value returned is the upper bound of the bucket holding the
+     * value of rank p, which is at most 12.5% greater than the value.
+     *
+     * @param p Percentile between 0 and 100
+     * @return the value of percentile p or 0 if no value was recorded
+     */
+    boost::uint64_t percentile( double p ) const;
+
+    boost::uint64_t count;                ///< Number of recorded values
+    boost::uint64_t max;                  ///< Maximum recorded value
+    std::vector<boost::uint64_t> buckets; ///< Number of values per bucket
+};
+
+
+/**
+    @brief Histogram of durations in nanoseconds with logarithmic buckets
+
+    As in HDR histograms, each power of 2 is split in 8 linear buckets, so
+    that the values are recorded with a relative precision of 12.5% over
+    the whole 64 bit range in 496 counters. A single thread records the
+    values while any thread may take snapshots, the counters are read and
+    written with relaxed atomic operations.
+*/
+class Histogram
+{
+public:
+    /// Number of buckets per power of 2
+    static const size_t SubBuckets = 8;
+
+    /// Number of buckets covering the 64 bit values
+    static const size_t NbrBuckets = 62 * SubBuckets;
+
+    /// Constructor of an empty Histogram
+    Histogram();
+
+    /**
+     * @brief Record a value, called by a single thread
+     *
+     * @param value Value to record
+     */
+    void record( boost::uint64_t value )
+    {
+        increment( m_buckets[bucket( value )] );
+        if( value > m_max.load( boost::memory_order_relaxed ) )
+            m_max.store( value, boost::memory_order_relaxed );
+    }
+
+    /// Return a copy of the counts of the Histogram
+    HistogramSnapshot snapshot() const;
+
+    /**
+     * @brief Return the bucket holding value
+     *
+     * @param value Value to look for
+     * @return the index of the bucket
+     */
+    static size_t bucket( boost::uint64_t value )
+    {
+        if( value < SubBuckets )
+            return size_t( value );
+        unsigned e = log2( value );
+        return ( e - 2 ) * SubBuckets +
+               size_t( ( value >> ( e - 3 ) ) & ( SubBuckets - 1 ) );
+    }
+
+    /**
+     * @brief Return the smallest value of a bucket
+     *
+     * @param bucket Index of the bucket
+     * @return the smallest value held by the bucket
+     */
+    static boost::uint64_t lowerBound( size_t bucket )
+    {
+        if( bucket < SubBuckets )
+            return bucket;
+        unsigned e = unsigned( bucket / SubBuckets ) + 2;
+        return boost::uint64_t( SubBuckets + bucket % SubBuckets ) << ( e - 3 );
+    }
+
+private:
+    /// Increment a counter written by a single thread
+    static void increment( boost::atomic<boost::uint64_t>& counter )
+    {
+        counter.store( counter.load( boost::memory_order_relaxed ) + 1,
+                       boost::memory_order_relaxed );
+    }
+
+    /// Return the index of the most significant bit of value, not 0
+    static unsigned log2( boost::uint64_t value )
+    {
+#if defined(__GNUC__)
+        return 63 - unsigned( __builtin_clzll( value ) );
+#else
+        unsigned e = 0;
+        while( value >>= 1 )
+            ++e;
+        return e;
+#endif
+    }
+
+    boost::atomic<boost::uint64_t> m_buckets[NbrBuckets]; ///< Counts
+    boost::atomic<boost::uint64_t> m_max;   ///< Maximum recorded value
+};
+
+
+/**
+    @brief Instrumentation policy compiled out of the dispatcher
+
+    The policy classes are the empty base classes of the Message queue
+    entries, of the Links, of the Slots and of the Message queues, whose
+    hooks are inline and empty. The instrumented classes thus have the
+    same size and code as without instrumentation. The statistics
+    accessors return 0 and empty snapshots.
+*/
+struct NullInstrumentation
+{
+    /// False since no statistics are recorded
+    static const bool enabled = false;
+
+    /// Return the current time, not read
+    static boost::uint64_t now() { return 0; }
+
+    /// Time stamp of a queued entry
+    class EntryStats
+    {
+    public:
+        void stamp( boost::uint64_t ) {}
+        boost::uint64_t stamped() const { return 0; }
+        void swap( EntryStats& ) {}
+    };
+
+    /// Statistics of a Link
+    class LinkStats
+    {
+    public:
+        void forwarded( size_t ) {}
+
+        /// Return the number of Message forwarded by the Link
+        boost::uint64_t count() const { return 0; }
+    };
+
+    /// Statistics of a Slot
+    class SlotStats
+    {
+    public:
+        void executed( boost::uint64_t, size_t ) {}
+
+        /// Return the number of Message processed by the Slot
+        boost::uint64_t count() const { return 0; }
+
+        /// Return the durations of the Slot method calls in nanoseconds
+        HistogramSnapshot executionTime() const { return HistogramSnapshot(); }
+    };
+
+    /// Statistics of a Message queue
+    class QueueStats
+    {
+    public:
+        void recordDepth( size_t ) {}
+        void recordLatency( boost::uint64_t, boost::uint64_t ) {}
+
+        /// Return the largest number of entries queued in the lanes
+        size_t maxDepth() const { return 0; }
+
+        /// Return the delays from the emission to the dispatch in nanoseconds
+        HistogramSnapshot latency() const { return HistogramSnapshot(); }
+    };
+};
+
+
+/**
+    @brief Instrumentation policy recording counters and histograms
+
+    Each Link counts the Message it forwarded, each Slot counts the Message
+    it processed and records the duration of its method calls, and each
+    Message queue records its maximum depth and the delay between the
+    emission of a Message and its dispatch. The counters are written by
+    the thread processing the Domain of the queue and may be read by any
+    thread to export them.
+*/
+struct CounterInstrumentation
+{
+    /// True since statistics are recorded
+    static const bool enabled = true;
+
+    /// Return the current steady time in nanoseconds
+    static boost::uint64_t now()
+    {
+        return boost::chrono::duration_cast<boost::chrono::nanoseconds>(
+            boost::chrono::steady_clock::now().time_since_epoch() ).count();
+    }
+
+    /// Time stamp of a queued entry, set when emitted
+    class EntryStats
+    {
+    public:
+        EntryStats() : m_stamp(0) {}
+        void stamp( boost::uint64_t time ) { m_stamp = time; }
+        boost::uint64_t stamped() const { return m_stamp; }
+        void swap( EntryStats& other ) { std::swap( m_stamp, other.m_stamp ); }
+    private:
+        boost::uint64_t m_stamp; ///< Time the entry was emitted
+    };
+
+    /// Statistics of a Link
+    class LinkStats
+    {
+    public:
+        LinkStats() : m_count(0) {}
+        void forwarded( size_t n )
+        {
+            m_count.store( m_count.load( boost::memory_order_relaxed ) + n,
+                           boost::memory_order_relaxed );
+        }
+
+        /// Return the number of Message forwarded by the Link
+        boost::uint64_t count() const
+            { return m_count.load( boost::memory_order_relaxed ); }
+    private:
+        boost::atomic<boost::uint64_t> m_count; ///< Forwarded Message
+    };
+
+    /// Statistics of a Slot
+    class SlotStats
+    {
+    public:
+        SlotStats() : m_count(0) {}
+        void executed( boost::uint64_t start, size_t n )
+        {
+            m_time.record( now() - start );
+            m_count.store( m_count.load( boost::memory_order_relaxed ) + n,
+                           boost::memory_order_relaxed );
+        }
+
+        /// Return the number of Message processed by the Slot
+        boost::uint64_t count() const
+            { return m_count.load( boost::memory_order_relaxed ); }
+
+        /// Return the durations of the Slot method calls in nanoseconds
+        HistogramSnapshot executionTime() const { return m_time.snapshot(); }
+    private:
+        boost::atomic<boost::uint64_t> m_count; ///< Processed Message
+        Histogram m_time;                       ///< Method call durations
+    };
+
+    /// Statistics of a Message queue
+    class QueueStats
+    {
+    public:
+        QueueStats() : m_maxDepth(0) {}
+        void recordDepth( size_t depth )
+        {
+            if( depth > m_maxDepth.load( boost::memory_order_relaxed ) )
+                m_maxDepth.store( depth, boost::memory_order_relaxed );
+        }
+        void recordLatency( boost::uint64_t stamp, boost::uint64_t time )
+            { m_latency.record( time - stamp ); }
+
+        /// Return the largest number of entries queued in the lanes
+        size_t maxDepth() const
+            { return m_maxDepth.load( boost::memory_order_relaxed ); }
+
+        /// Return the delays from the emission to the dispatch in nanoseconds
+        HistogramSnapshot latency() const { return m_latency.snapshot(); }
+    private:
+        boost::atomic<size_t> m_maxDepth; ///< Largest number of entries
+        Histogram m_latency;              ///< Emission to dispatch delays
+    };
+};
+
+/*! Instrumentation policy of the dispatcher
+
+    The policy is selected at compile time. It is NullInstrumentation by
+    default and CounterInstrumentation when MPO_INSTRUMENTATION is defined.
+    An application may also define MPO_INSTRUMENTATION_POLICY as its own
+    policy class with the same interface. The choice must be the same in
+    all translation units.
+*/
+#ifndef MPO_INSTRUMENTATION_POLICY
+#  ifdef MPO_INSTRUMENTATION
+#    define MPO_INSTRUMENTATION_POLICY CounterInstrumentation
+#  else
+#    define MPO_INSTRUMENTATION_POLICY NullInstrumentation
+#  endif
+#endif
+typedef MPO_INSTRUMENTATION_POLICY Instrumentation;
+
+} // namespace MPO
+
+#endif // INSTRUMENTATION_HPP
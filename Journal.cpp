@@ -0,0 +1,401 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <boost/bind.hpp>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define MPO_HAS_MMAP
+#endif
+
+#include "Journal.hpp"
+#include "Link.hpp"
+
+namespace MPO
+{
+    // Mapped segment file, written by the Slot then closed by the thread
+    struct JournalWriter::Segment
+    {
+        int fd;             ///< Descriptor of the file
+        char* data;         ///< Mapped file
+        size_t size;        ///< Size of the file
+        size_t position;    ///< Offset of the next record
+        std::string path;   ///< Path of the file
+    };
+
+    namespace
+    {
+        const char magic[8] = { 'M', 'P', 'O', 'J', 'R', 'N', 'L', '2' };
+
+        // Header of a segment, followed by its records
+        struct SegmentHeader
+        {
+            char magic[8];         ///< "MPOJRNL2"
+            boost::uint32_t index; ///< Index of the segment in the journal
+            boost::uint32_t pad;   ///< Unused, 0
+        };
+
+        // Size of a record, its payload padded to 8 bytes
+        size_t recordSize( size_t size )
+        {
+            return sizeof(JournalRecord) + ( ( size + 7 ) & ~size_t(7) );
+        }
+
+        std::string segmentPath( const std::string& directory, boost::uint32_t index )
+        {
+            char name[32];
+            std::sprintf( name, "/journal-%08u.mpoj", unsigned( index ) );
+            return directory + name;
+        }
+
+        // Return the indexes of the segments of a directory in order
+        std::vector<boost::uint32_t> segmentIndexes( const std::string& directory )
+        {
+            std::vector<boost::uint32_t> indexes;
+#ifdef MPO_HAS_MMAP
+            DIR* dir = opendir( directory.c_str() );
+            if( !dir )
+                throw std::runtime_error( "Journal can't read " + directory );
+            while( struct dirent* entry = readdir( dir ) )
+            {
+                unsigned index;
+                char end;
+                if( std::sscanf( entry->d_name, "journal-%8u.mpo%c", &index, &end ) == 2 &&
+                    end == 'j' && std::strlen( entry->d_name ) == 21 )
+                    indexes.push_back( boost::uint32_t( index ) );
+            }
+            closedir( dir );
+            std::sort( indexes.begin(), indexes.end() );
+#else
+            (void)directory;
+#endif
+            return indexes;
+        }
+
+        boost::uint64_t now()
+        {
+            return boost::uint64_t( boost::chrono::duration_cast<boost::chrono::nanoseconds>(
+                boost::chrono::system_clock::now().time_since_epoch() ).count() );
+        }
+
+        // Create and map a segment, its pages populated so that the Slot
+        // doesn't fault on them
+        JournalWriter::Segment* createSegment( const std::string& directory,
+                                               boost::uint32_t index, size_t size )
+        {
+#ifdef MPO_HAS_MMAP
+            std::string path = segmentPath( directory, index );
+            int fd = open( path.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644 );
+            if( fd < 0 )
+                throw std::runtime_error( "JournalWriter can't create " + path );
+            if( ftruncate( fd, off_t( size ) ) != 0 )
+            {
+                close( fd );
+                unlink( path.c_str() );
+                throw std::runtime_error( "JournalWriter can't size " + path );
+            }
+            int flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+            flags |= MAP_POPULATE;
+#endif
+            void* p = mmap( nullptr, size, PROT_READ | PROT_WRITE, flags, fd, 0 );
+            if( p == MAP_FAILED )
+            {
+                close( fd );
+                unlink( path.c_str() );
+                throw std::runtime_error( "JournalWriter can't map " + path );
+            }
+            SegmentHeader* header = static_cast<SegmentHeader*>( p );
+            std::memcpy( header->magic, magic, sizeof(magic) );
+            header->index = index;
+            JournalWriter::Segment* segment = new JournalWriter::Segment();
+            segment->fd = fd;
+            segment->data = static_cast<char*>( p );
+            segment->size = size;
+            segment->position = sizeof(SegmentHeader);
+            segment->path = path;
+            return segment;
+#else
+            (void)directory;
+            (void)index;
+            (void)size;
+            throw std::runtime_error( "JournalWriter requires memory-mapped files" );
+#endif
+        }
+
+        // Synchronise the records and truncate the file after the last one,
+        // an unused segment is removed
+        void closeSegment( JournalWriter::Segment* segment, bool remove )
+        {
+#ifdef MPO_HAS_MMAP
+            if( !remove )
+                msync( segment->data, segment->position, MS_SYNC );
+            munmap( segment->data, segment->size );
+            if( remove )
+                unlink( segment->path.c_str() );
+            else if( segment->position + sizeof(JournalRecord) <= segment->size &&
+                     ftruncate( segment->fd, off_t( segment->position + sizeof(JournalRecord) ) ) == 0 )
+                fsync( segment->fd );
+            close( segment->fd );
+#endif
+            delete segment;
+        }
+    }
+
+    JournalWriter::JournalWriter( const std::string& directory, size_t segmentSize ) :
+        AnySlot( Message::Type() ), m_directory( directory ),
+        m_segmentSize( std::max( segmentSize, size_t(4096) ) ), m_current( nullptr ),
+        m_next( nullptr ), m_nextIndex( 1 ), m_failed( false ), m_stop( false ),
+        m_lastType( nullptr ), m_lastCodec( nullptr ), m_nbrRecords( 0 ),
+        m_nbrStalls( 0 )
+    {
+        m_dynamicCastFunction = Function( &JournalWriter::write, this );
+        m_staticCastFunction = m_dynamicCastFunction;
+#ifdef MPO_HAS_MMAP
+        if( mkdir( directory.c_str(), 0755 ) != 0 && errno != EEXIST )
+            throw std::runtime_error( "JournalWriter can't create " + directory );
+#endif
+        std::vector<boost::uint32_t> indexes = segmentIndexes( directory );
+        if( !indexes.empty() )
+            m_nextIndex = indexes.back() + 1;
+        m_current = createSegment( m_directory, m_nextIndex++, m_segmentSize );
+        m_thread = boost::thread( boost::bind( &JournalWriter::run, this ) );
+    }
+
+    // The full segments are closed before the thread stops
+    JournalWriter::~JournalWriter()
+    {
+        {
+            boost::lock_guard<boost::mutex> lock( m_mutex );
+            if( m_current )
+                m_full.push_back( m_current );
+            m_current = nullptr;
+            m_stop = true;
+        }
+        m_wakeUp.notify_one();
+        m_thread.join();
+    }
+
+    bool JournalWriter::tap( AnySignal* signal )
+    {
+        return Link::connect( signal, this );
+    }
+
+    // The header is written after the payload and its size last, so that a
+    // crash leaves either a complete record or the end of the segment
+    void JournalWriter::write( void* obj, Message::Ptr& msg, Link* )
+    {
+        if( !msg )
+            return;
+        JournalWriter* writer = static_cast<JournalWriter*>( obj );
+        const TypeDef* type = &msg->type();
+        if( type != writer->m_lastType )
+        {
+            const MessageCodec::Codec* codec = MessageCodec::find( *type );
+            if( !codec )
+                throw std::runtime_error( "JournalWriter has no codec for " +
+                                          type->name() );
+            writer->m_lastType = type;
+            writer->m_lastCodec = codec;
+        }
+        const MessageCodec::Codec& codec = *writer->m_lastCodec;
+        size_t size = codec.encode( *msg, nullptr, 0 );
+        size_t need = recordSize( size ) + sizeof(JournalRecord);
+        if( need > writer->m_segmentSize - sizeof(SegmentHeader) )
+            throw std::runtime_error( "JournalWriter record too large for " +
+                                      type->name() );
+        Segment* segment = writer->m_current;
+        if( !segment || segment->position + need > segment->size )
+        {
+            writer->rotate();
+            segment = writer->m_current;
+        }
+        JournalRecord* record =
+            reinterpret_cast<JournalRecord*>( segment->data + segment->position );
+        codec.encode( *msg, record + 1, size );
+        record->size = boost::uint32_t( size );
+        record->type = codec.id;
+        record->time = now();
+        boost::atomic_thread_fence( boost::memory_order_release );
+        record->committed = 1;
+        segment->position += recordSize( size );
+        ++writer->m_nbrRecords;
+    }
+
+    // Wait for the thread only if it didn't map the next segment yet
+    void JournalWriter::rotate()
+    {
+        boost::unique_lock<boost::mutex> lock( m_mutex );
+        if( m_current )
+            m_full.push_back( m_current );
+        m_current = nullptr;
+        if( !m_next && !m_failed )
+        {
+            ++m_nbrStalls;
+            m_wakeUp.notify_one();
+            while( !m_next && !m_failed )
+                m_ready.wait( lock );
+        }
+        if( !m_next )
+            throw std::runtime_error( "JournalWriter can't create a segment in " +
+                                      m_directory );
+        m_current = m_next;
+        m_next = nullptr;
+        m_wakeUp.notify_one();
+    }
+
+    void JournalWriter::run()
+    {
+        boost::unique_lock<boost::mutex> lock( m_mutex );
+        for( ;; )
+        {
+            if( !m_full.empty() )
+            {
+                Segment* segment = m_full.front();
+                m_full.pop_front();
+                lock.unlock();
+                closeSegment( segment, false );
+                lock.lock();
+            }
+            else if( m_stop )
+                break;
+            else if( !m_next && !m_failed )
+            {
+                boost::uint32_t index = m_nextIndex++;
+                lock.unlock();
+                Segment* segment = nullptr;
+                try
+                {
+                    segment = createSegment( m_directory, index, m_segmentSize );
+                }
+                catch( const std::runtime_error& ) {}
+                lock.lock();
+                m_next = segment;
+                m_failed = !segment;
+                m_ready.notify_one();
+            }
+            else
+                m_wakeUp.wait( lock );
+        }
+        if( m_next )
+            closeSegment( m_next, true );
+        m_next = nullptr;
+    }
+
+
+    JournalReplay::JournalReplay( const std::string& directory, Domain& domain ) :
+        m_nextPath( 0 ), m_data( nullptr ), m_size( 0 ), m_position( 0 ),
+        m_started( false ), m_baseTime( 0 ), m_nbrDropped( 0 )
+    {
+        std::vector<boost::uint32_t> indexes = segmentIndexes( directory );
+        for( size_t i = 0; i < indexes.size(); ++i )
+            m_paths.push_back( segmentPath( directory, indexes[i] ) );
+        m_output.setDomain( domain );
+    }
+
+    JournalReplay::~JournalReplay()
+    {
+        unmap();
+    }
+
+    // The record is skipped before emitting its decoded Message
+    size_t JournalReplay::replay( Pace pace, size_t max )
+    {
+        size_t n = 0;
+        while( n < max )
+        {
+            const JournalRecord* record = next();
+            if( !record )
+                break;
+            m_position += recordSize( record->size );
+            const MessageCodec::Codec* codec = MessageCodec::find( record->type );
+            if( !codec )
+            {
+                ++m_nbrDropped;
+                continue;
+            }
+            Message::Ptr msg = codec->decode( record->payload(), record->size );
+            if( pace == RecordedSpeed )
+            {
+                if( !m_started )
+                {
+                    m_started = true;
+                    m_baseTime = record->time;
+                    m_baseClock = boost::chrono::steady_clock::now();
+                }
+                else if( record->time > m_baseTime )
+                    boost::this_thread::sleep_until( m_baseClock +
+                        boost::chrono::nanoseconds( record->time - m_baseTime ) );
+            }
+            m_output.emit( msg );
+            ++n;
+        }
+        return n;
+    }
+
+    // A record not committed or past the end of the file ends the segment
+    const JournalRecord* JournalReplay::next()
+    {
+        for( ;; )
+        {
+            if( m_data && m_position + sizeof(JournalRecord) <= m_size )
+            {
+                const JournalRecord* record =
+                    reinterpret_cast<const JournalRecord*>( m_data + m_position );
+                if( record->committed &&
+                    m_position + recordSize( record->size ) <= m_size )
+                    return record;
+            }
+            unmap();
+            if( m_nextPath == m_paths.size() )
+                return nullptr;
+            map( m_paths[m_nextPath++] );
+        }
+    }
+
+    void JournalReplay::map( const std::string& path )
+    {
+#ifdef MPO_HAS_MMAP
+        int fd = open( path.c_str(), O_RDONLY );
+        if( fd < 0 )
+            throw std::runtime_error( "JournalReplay can't open " + path );
+        struct stat st;
+        if( fstat( fd, &st ) != 0 || size_t( st.st_size ) < sizeof(SegmentHeader) )
+        {
+            close( fd );
+            throw std::runtime_error( "JournalReplay invalid segment " + path );
+        }
+        void* p = mmap( nullptr, size_t( st.st_size ), PROT_READ, MAP_SHARED, fd, 0 );
+        close( fd );
+        if( p == MAP_FAILED )
+            throw std::runtime_error( "JournalReplay can't map " + path );
+        m_data = static_cast<const char*>( p );
+        m_size = size_t( st.st_size );
+        m_position = sizeof(SegmentHeader);
+        if( std::memcmp( m_data, magic, sizeof(magic) ) != 0 )
+        {
+            unmap();
+            throw std::runtime_error( "JournalReplay invalid segment " + path );
+        }
+#else
+        throw std::runtime_error( "JournalReplay requires memory-mapped files " + path );
+#endif
+    }
+
+    void JournalReplay::unmap()
+    {
+#ifdef MPO_HAS_MMAP
+        if( m_data )
+            munmap( const_cast<char*>( m_data ), m_size );
+#endif
+        m_data = nullptr;
+        m_size = 0;
+        m_position = 0;
+    }
+}
@@ -0,0 +1,241 @@
+#ifndef JOURNAL_HPP
+#define JOURNAL_HPP
+
+#include <deque>
+#include <string>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/chrono.hpp>
+#include <boost/thread.hpp>
+
+#include "Slot.hpp"
+#include "Signal.hpp"
+#include "Domain.hpp"
+#include "MessageCodec.hpp"
+
+namespace MPO
+{
+
+/// Header of a record of a journal segment
+struct JournalRecord
+{
+    boost::uint32_t size;      ///< Size of the payload
+    boost::uint32_t committed; ///< 1 once written, 0 past the last record
+    boost::uint64_t type;     ///< Wire id of the payload type
+    boost::uint64_t time;     ///< Nanoseconds since the epoch when written
+
+    /// Return the payload following the header
+    const void* payload() const { return this + 1; }
+};
+
+/**
+    @brief Slot appending the received Message to a memory-mapped journal
+
+    The journal is a directory of append-only segment files, named
+    journal-00000001.mpoj, journal-00000002.mpoj and so on. The Links of a
+    tapped Signal forward its Message to the writer, which encodes them
+    with the codec of their type in place in the mapped segment, after a
+    header holding the wire id of the type and the time. A segment holds
+    the records padded to 8 bytes and ends with a record not committed, so
+    that a Message encoded in 0 bytes is journaled as any other.
+
+    @code
+        JournalWriter journal( "/var/lib/app/journal" );
+        journal.tap( "Ping::output" );
+    @endcode
+
+    A background thread creates and maps the next segment in advance and
+    closes the full ones, so that the thread processing the Domain of the
+    writer only copies the encodings to memory and swaps the segments. The
+    segments are synchronised to the disk when closed, the records of the
+    mapped segments survive a crash of the process but not of the system.
+    A new writer appends its segments after the existing ones.
+*/
+class JournalWriter : public AnySlot
+{
+public:
+    /**
+     * @brief Constructor creating the first segment
+     *
+     * @param directory Directory of the segments, created if missing
+     * @param segmentSize Size of a segment file in bytes
+     * @throw std::runtime_error if the segment can't be created
+     */
+    JournalWriter( const std::string& directory, size_t segmentSize = 16 << 20 );
+
+    /// Destructor closing the segments and joining the background thread
+    ~JournalWriter();
+
+    /**
+     * @brief Record the Message of a Signal
+     *
+     * @param signal Tapped Signal
+     * @return false if signal is nullptr
+     */
+    bool tap( AnySignal* signal );
+
+    /**
+     * @brief Record the Message of a named Signal
+     *
+     * @param signalName Name of the tapped Signal
+     * @return false if no Signal has the name signalName
+     */
+    bool tap( const std::string& signalName )
+        { return tap( AnySignal::get( signalName ) ); }
+
+    /**
+     * @brief Return the directory of the segments
+     *
+     * @return the journal directory
+     */
+    const std::string& directory() const { return m_directory; }
+
+    /**
+     * @brief Return the number of recorded Message
+     *
+     * @return the number of records
+     */
+    size_t nbrRecords() const { return m_nbrRecords; }
+
+    /**
+     * @brief Return the number of times a full segment had no successor
+     *
+     * @return the number of waits for the background thread
+     */
+    size_t nbrStalls() const { return m_nbrStalls; }
+
+    /// Mapped segment file, defined in Journal.cpp
+    struct Segment;
+
+private:
+    /// Thunk appending the Message to the current segment
+    static void write( void* slot, Message::Ptr& msg, Link* link );
+
+    /// Hand the current segment to the background thread and take the next
+    void rotate();
+
+    /// Close the full segments and map the next one in advance
+    void run();
+
+    // Non copyable
+    JournalWriter( const JournalWriter& );
+    JournalWriter& operator=( const JournalWriter& );
+
+    std::string m_directory;               ///< Directory of the segments
+    size_t m_segmentSize;                  ///< Size of a segment file
+    Segment* m_current;                    ///< Segment written by the Slot
+    Segment* m_next;                       ///< Segment mapped in advance
+    std::deque<Segment*> m_full;           ///< Segments to close
+    boost::uint32_t m_nextIndex;           ///< Index of the next segment
+    bool m_failed;                         ///< True if m_next can't be created
+    bool m_stop;                           ///< True to stop the thread
+    boost::mutex m_mutex;                  ///< Mutex of the segment hand off
+    boost::condition_variable m_wakeUp;    ///< Condition of the thread
+    boost::condition_variable m_ready;     ///< Condition of m_next
+    boost::thread m_thread;                ///< Background thread
+    const TypeDef* m_lastType;             ///< Type of the last Message
+    const MessageCodec::Codec* m_lastCodec; ///< Codec of m_lastType
+    size_t m_nbrRecords;                   ///< Number of records
+    size_t m_nbrStalls;                    ///< Number of waits for m_next
+};
+
+
+/**
+    @brief Source emitting the Message recorded in a journal
+
+    The replay maps the segments of a journal directory in order, decodes
+    the records with the codecs of their wire id and emits them through its
+    output Signal, connected to any Slot with Link::connect(). The records
+    are emitted as fast as possible, or at the pace they were recorded,
+    relative to the first replayed record. Records of an unknown type are
+    dropped and counted.
+
+    @code
+        JournalReplay replay( "/var/lib/app/journal" );
+        Link::connect( &replay.output(), pong.getSlot( 0 ) );
+        while( replay.replay( JournalReplay::RecordedSpeed, 100 ) )
+            while( Message::processNext() ) {}
+    @endcode
+*/
+class JournalReplay
+{
+public:
+    /// Pace of the emitted Message
+    enum Pace
+    {
+        MaximumSpeed, ///< Emit the records without waiting
+        RecordedSpeed ///< Wait for the recorded delay between the records
+    };
+
+    /**
+     * @brief Constructor listing the segments of a journal
+     *
+     * @param directory Directory of the segments
+     * @param domain Domain of the output Signal
+     * @throw std::runtime_error if the directory can't be read
+     */
+    JournalReplay( const std::string& directory, Domain& domain = Domain::main() );
+
+    /// Destructor unmapping the current segment
+    ~JournalReplay();
+
+    /**
+     * @brief Return the Signal emitting the recorded Message
+     *
+     * @return the output Signal
+     */
+    Signal<Message>& output() { return m_output; }
+
+    /**
+     * @brief Emit the next recorded Message
+     *
+     * @param pace Pace of the emitted Message
+     * @param max Maximum number of Message to emit
+     * @return the number of emitted Message, 0 at the end of the journal
+     * @throw std::runtime_error if a segment is invalid
+     */
+    size_t replay( Pace pace = MaximumSpeed, size_t max = size_t(-1) );
+
+    /**
+     * @brief Return the number of segments of the journal
+     *
+     * @return the number of segment files
+     */
+    size_t nbrSegments() const { return m_paths.size(); }
+
+    /**
+     * @brief Return the number of dropped records
+     *
+     * @return the number of records of unknown types
+     */
+    size_t nbrDropped() const { return m_nbrDropped; }
+
+private:
+    /// Return the next record, mapping the next segments when needed
+    const JournalRecord* next();
+
+    /// Map a segment and check its header
+    void map( const std::string& path );
+
+    /// Unmap the current segment
+    void unmap();
+
+    // Non copyable
+    JournalReplay( const JournalReplay& );
+    JournalReplay& operator=( const JournalReplay& );
+
+    std::vector<std::string> m_paths;      ///< Paths of the segments
+    size_t m_nextPath;                     ///< Index of the next segment
+    const char* m_data;                    ///< Mapped segment
+    size_t m_size;                         ///< Size of the mapped segment
+    size_t m_position;                     ///< Offset of the next record
+    Signal<Message> m_output;              ///< Signal of the Message
+    bool m_started;                        ///< True once a record is paced
+    boost::uint64_t m_baseTime;            ///< Time of the first paced record
+    boost::chrono::steady_clock::time_point m_baseClock; ///< Its replay time
+    size_t m_nbrDropped;                   ///< Number of dropped records
+};
+
+} // namespace MPO
+
+#endif // JOURNAL_HPP
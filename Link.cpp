@@ -8,7 +8,8 @@ namespace MPO
 {
 
 // Establish a connection from a Signal to a Slot
-bool Link::connect( AnySignal* signal, AnySlot* slot, bool forceStatic )
+bool Link::connect( AnySignal* signal, AnySlot* slot, bool forceStatic,
+                    Mode mode )
 {
     // if a signal or a slot are not specified, connecting fails
     if( !signal || !slot )
@@ -17,23 +18,104 @@ bool Link::connect( AnySignal* signal, AnySlot* slot, bool forceStatic )
     // if not already connected, instantiate the link and connect it
     if( !signal->isConnected( *slot ) )
     {
-        Link* link = new Link( *signal, *slot, forceStatic );
+        signal->checkUnfrozen();
+        Link* link = new Link( *signal, *slot,
+                               forceStatic || isStaticCast( *signal, *slot ),
+                               mode == Direct );
         signal->connect( *slot, *link );
         slot->connect( *link );
     }
     return true;
 }
 
+// Establish a connection from a Signal to a Slot of named Actions
+bool Link::connect( const std::string& signalAction,
+                    const std::string& signalName,
+                    const std::string& slotAction,
+                    const std::string& slotName,
+                    bool forceStatic, Mode mode )
+{
+    return Link::connect( Action::getSignal( signalAction, signalName ),
+                          Action::getSlot( slotAction, slotName ),
+                          forceStatic, mode );
+}
+
+// Disconnect a Signal from a Slot of named Actions
+bool Link::disconnect( const std::string& signalAction,
+                       const std::string& signalName,
+                       const std::string& slotAction,
+                       const std::string& slotName )
+{
+    return Link::disconnect( Action::getSignal( signalAction, signalName ),
+                             Action::getSlot( slotAction, slotName ) );
+}
+
+// Disconnect a Signal from a Slot by retiring the Link connecting them
+bool Link::disconnect( AnySignal* signal, AnySlot* slot )
+{
+    if( !signal || !slot )
+        return false;
+    Link* link = signal->findLink( *slot );
+    if( !link )
+        return false;
+    signal->checkUnfrozen();
+    link->disconnect();
+    return true;
+}
+
+// Set the priority of the Link connecting signal to slot
+bool Link::setPriority( AnySignal* signal, AnySlot* slot,
+                        Message::Priority priority )
+{
+    Link* link = signal && slot ? signal->findLink( *slot ) : nullptr;
+    if( !link )
+        return false;
+    link->setPriority( priority );
+    return true;
+}
+
+// Set the coalescing mode of the Link connecting signal to slot
+bool Link::setCoalescing( AnySignal* signal, AnySlot* slot, bool coalescing )
+{
+    Link* link = signal && slot ? signal->findLink( *slot ) : nullptr;
+    if( !link )
+        return false;
+    link->setCoalescing( coalescing );
+    return true;
+}
+
 // Constructor binding signal and slot: called by static connect
-Link::Link( AnySignal& signal, AnySlot& slot, bool forceStatic ) :
-    m_signal(&signal), m_slot(&slot)
+Link::Link( AnySignal& signal, AnySlot& slot, bool staticCast, bool direct ) :
+    m_signal(&signal), m_slot(&slot), m_connected(true),
+    m_priority(signal.priority()), m_coalesce(signal.isCoalescing()),
+    m_direct(direct), m_pendingLane(m_priority), m_pendingSeq(0)
 {
-    // Pick the slot function performing a static or dynamic cast on the message
-    if( forceStatic ||
-            m_signal->messageType().isSameOrSubtypeOf(&m_slot->messageType()) )
+    updateDomains();
+    if( staticCast )
         m_slotFunction = m_slot->getStaticCastFunction();
     else
         m_slotFunction = m_slot->getDynamicCastFunction();
 }
 
+// Detach the Link from its Signal and Slot and let its queue delete it
+void Link::disconnect()
+{
+    m_signal->disconnect( *m_slot );
+    m_slot->disconnect( *this );
+    m_connected = false;
+    m_queue->retire( this );
+}
+
+// Queue emitted Message in the Slot Domain, through a channel if required
+void Link::updateDomains()
+{
+    Domain& target = m_slot->domain();
+    m_queue = target.m_emitted;
+    if( &m_signal->domain() == &target )
+        m_channel = nullptr;
+    else
+        m_channel = target.channelFrom( m_signal->domain() );
+    m_signal->replan();
+}
+
 }
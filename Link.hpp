@@ -3,6 +3,8 @@
 
 #include "Signal.hpp"
 #include "Slot.hpp"
+#include "Domain.hpp"
+#include "GraphArena.hpp"
 
 namespace MPO
 {
@@ -20,7 +22,9 @@ namespace MPO
     a configuration files and each Signal and Slot is identified by a
     unique name in the program.
 
-    Deleting a Link object removes the connection.
+    The static disconnect() methods remove the connection. The Message
+    pending on a disconnected Link are dropped when the dispatcher reaches
+    them, and the Link object is deleted once they are all processed.
 
     The following example shows how to establish a connection Link between
     a Signal named "output" and a Slot named "input" of two instances of
@@ -75,18 +79,22 @@ namespace MPO
     @see Slot
     @see Signal
  */
-class Link
+class Link : private Instrumentation::LinkStats
 {
     friend class Message; // Message instance calls forward()
+    friend class AnySignal; // Signal queues emitted Message in m_queue
+    friend class AnySlot; // Slot updates the Domains
+    friend class Topology; // Topology builds Links in a GraphMemory
+    friend class GraphArena; // GraphArena builds and detaches its Links
+    friend class Trace; // Trace records the Slot and priority of Links
 
 public:
-    /// The destructor disconnects the connection Link
-    ~Link()
+    /// Dispatch modes of a Link
+    enum Mode
     {
-        Message::emitted.erase(this);
-        m_signal->disconnect( *m_slot );
-        m_slot->disconnect( *this );
-    }
+        Queued, ///< The dispatcher forwards the queued Message
+        Direct  ///< emit() calls the Slot at once, see isDirect()
+    };
 
     /**
      * @brief Establish a connection from a Signal to a Slot
@@ -94,9 +102,12 @@ public:
      * @param signal Signal to connect from
      * @param slot Slot to connect to
      * @param forceStatic true if a static cast must always be performed
+     * @param mode Direct if emit() calls the Slot at once
      * @return false if signal or slot is a nullptr
+     * @throws runtime_error if signal is frozen
      */
-    static bool connect( AnySignal* signal, AnySlot* slot, bool forceStatic = false );
+    static bool connect( AnySignal* signal, AnySlot* slot,
+                         bool forceStatic = false, Mode mode = Queued );
 
     /**
      * @brief Establish a connection from a named Signal to a named Slot
@@ -104,26 +115,48 @@ public:
      * @param signalName Name of Signal to connect from
      * @param slotName Name of Slot to connect to
      * @param forceStatic true if a static cast must always be performed
+     * @param mode Direct if emit() calls the Slot at once
      * @return false if signal or slot is a nullptr
      */
     static bool connect( const std::string& signalName,
                          const std::string& slotName,
-                         bool forceStatic = false )
+                         bool forceStatic = false, Mode mode = Queued )
     {
         return Link::connect( AnySignal::get(signalName),
                               AnySlot::get(slotName),
-                              forceStatic );
+                              forceStatic, mode );
     }
 
+    /**
+     * @brief Establish a connection from a Signal of an Action to a Slot of
+     *        an Action
+     *
+     * The Signal and the Slot are looked up in their Action, which avoids
+     * building their "action::port" names.
+     *
+     * @param signalAction Name of the Action owning the Signal
+     * @param signalName Name of the Signal in its Action
+     * @param slotAction Name of the Action owning the Slot
+     * @param slotName Name of the Slot in its Action
+     * @param forceStatic true if a static cast must always be performed
+     * @param mode Direct if emit() calls the Slot at once
+     * @return false if the signal or slot was not found
+     */
+    static bool connect( const std::string& signalAction,
+                         const std::string& signalName,
+                         const std::string& slotAction,
+                         const std::string& slotName,
+                         bool forceStatic = false, Mode mode = Queued );
+
     /**
      * @brief Disconnect a Signal with a Slot, return true if a link existed
      *
      * @param signal Signal to disconnect from
      * @param slot Slot to disconnect from
      * @return True if signal and slot were connected, False otherwise
+     * @throws runtime_error if signal is frozen
      */
-    static bool disconnect( AnySignal* signal, AnySlot* slot )
-        { return signal && slot && signal->disconnect(*slot); }
+    static bool disconnect( AnySignal* signal, AnySlot* slot );
 
     /**
      * @brief Disconnect a named Signal with a named Slot,
@@ -140,6 +173,21 @@ public:
                               AnySlot::get(slotName) );
     }
 
+    /**
+     * @brief Disconnect a Signal of an Action from a Slot of an Action,
+     *        return true if a link existed
+     *
+     * @param signalAction Name of the Action owning the Signal
+     * @param signalName Name of the Signal in its Action
+     * @param slotAction Name of the Action owning the Slot
+     * @param slotName Name of the Slot in its Action
+     * @return True if signal and slot were connected, False otherwise
+     */
+    static bool disconnect( const std::string& signalAction,
+                            const std::string& signalName,
+                            const std::string& slotAction,
+                            const std::string& slotName );
+
     /**
      * @brief Return true if the Signal and Slot are connected
      *
@@ -178,31 +226,203 @@ public:
      */
     AnySlot* slot() const { return m_slot; }
 
+    /**
+     * @brief Return the priority class of the Message sent through the Link
+     *
+     * @return the priority of the lane in which the Link queues Message
+     */
+    Message::Priority priority() const { return m_priority; }
+
+    /**
+     * @brief Set the priority class of the Message sent through the Link
+     *
+     * Message already queued stay in the lane of the previous priority.
+     *
+     * @param priority Priority of the lane in which the Link queues Message
+     */
+    void setPriority( Message::Priority priority )
+        { m_priority = priority; m_signal->replan(); }
+
+    /**
+     * @brief Set the priority class of the Link connecting a Signal to a Slot
+     *
+     * @param signal Signal connected from
+     * @param slot Slot connected to
+     * @param priority Priority of the lane in which the Link queues Message
+     * @return false if signal and slot are not connected
+     */
+    static bool setPriority( AnySignal* signal, AnySlot* slot,
+                             Message::Priority priority );
+
+    /**
+     * @brief Return true if the Link coalesces its Message
+     *
+     * @return true if the Link is in coalescing mode
+     */
+    bool isCoalescing() const { return m_coalesce; }
+
+    /**
+     * @brief Return true if emit() calls the Slot at once
+     *
+     * A direct Link between a Signal and a Slot of the same Domain calls
+     * the Slot method from emit(), before the Message of the next Links
+     * are queued, instead of queuing its Message. When MaxDirectDepth (4)
+     * direct calls are nested, as in a cycle of direct Links, or when the
+     * queue accepts entries from any thread, the Message is queued as
+     * usual. A direct Link to another Domain sends its Message through the
+     * channel. The Slot method of a direct Link must not connect or
+     * disconnect the Links of the emitting Signal.
+     *
+     * @see Message::Emitted::call()
+     * @return true if the Link was connected in direct mode
+     */
+    bool isDirect() const { return m_direct; }
+
+    /**
+     * @brief Return the statistics of the Link
+     *
+     * @return the statistics recorded by the Instrumentation policy
+     */
+    const Instrumentation::LinkStats& stats() const { return *this; }
+
+    /**
+     * @brief Set the coalescing mode of the Link
+     *
+     * In coalescing mode, a Message emitted while the Link still has a
+     * Message pending in the queue replaces the pending Message in place,
+     * so that the Slot only processes the latest one. The Message sent from
+     * another Domain are coalesced when moved in the queue by its thread.
+     *
+     * @param coalescing true to replace the pending Message
+     */
+    void setCoalescing( bool coalescing )
+        { m_coalesce = coalescing; m_signal->replan(); }
+
+    /**
+     * @brief Set the coalescing mode of the Link connecting a Signal to a Slot
+     *
+     * @param signal Signal connected from
+     * @param slot Slot connected to
+     * @param coalescing true to replace the pending Message
+     * @return false if signal and slot are not connected
+     */
+    static bool setCoalescing( AnySignal* signal, AnySlot* slot, bool coalescing );
+
 protected:
     /**
      * @brief Forwards the emitted message to the slot and call its function
      *
-     * @param msg The Message to pass as Slot function argument
+     * @param msg The Message to pass as Slot function argument, which may
+     *            be moved out of msg
+     * @param start Time of the dispatch read by the Instrumentation policy
+     */
+    void forward( Message::Ptr& msg, boost::uint64_t start )
+    {
+        AnySlot* slot = m_slot;
+        forwarded( 1 );
+        m_slotFunction.consume( msg, this );
+        slot->executed( start, 1 );
+    }
+
+    /**
+     * @brief Forwards a range of emitted Message to a BatchSlot
+     *
+     * @param msgs Array of the Message, which may be moved out
+     * @param n Number of Message
+     * @param start Time of the dispatch read by the Instrumentation policy
+     */
+    void forwardBatch( Message::Ptr* msgs, size_t n, boost::uint64_t start )
+    {
+        AnySlot* slot = m_slot;
+        forwarded( n );
+        m_slotFunction.consumeBatch( msgs, n, this );
+        slot->executed( start, n );
+    }
+
+    /**
+     * @brief Allocate a Link with the global operator new
+     *
+     * Every Link is preceded by a header recording the GraphMemory holding
+     * it, so that any Link may be released by its Message queue with delete.
+     *
+     * @param size Size of the Link
+     * @return pointer on the memory of the Link
      */
-    void forward( Message::Ptr msg ) { m_slotFunction( msg, this); }
+    static void* operator new( size_t size );
+
+    /**
+     * @brief Release the memory of a Link allocated by new or in a
+     *        GraphMemory
+     *
+     * @param ptr Pointer on the Link memory
+     */
+    static void operator delete( void* ptr );
 
 private:
+    /**
+     * @brief Allocate a Link in a GraphMemory
+     *
+     * @param size Size of the Link
+     * @param memory GraphMemory in which the Link is allocated
+     * @return pointer on the memory of the Link
+     */
+    static void* operator new( size_t size, GraphMemory& memory );
+
+    /// Release a Link whose construction in a GraphMemory failed
+    static void operator delete( void* ptr, GraphMemory& memory );
+
     /**
      * @brief Constructor binding a Signal and a Slot and called by static connect
      *
      * @param signal Signal to connect from
      * @param slot Slot to connect to
-     * @param forceStatic true if a static cast must always be performed
+     * @param staticCast true if a static cast is performed on the Message,
+     *                   false if their type is checked first
+     * @param direct true if emit() calls the Slot at once
      */
-    Link( AnySignal& signal, AnySlot& slot, bool forceStatic );
+    Link( AnySignal& signal, AnySlot& slot, bool staticCast, bool direct = false );
 
-    /// Disconnects the Link
+    /**
+     * @brief Return true if the Signal Message type may be static cast to
+     *        the Slot Message type
+     *
+     * @param signal Signal to connect from
+     * @param slot Slot to connect to
+     * @return true if all Message emitted by signal are accepted by slot
+     */
+    static bool isStaticCast( const AnySignal& signal, const AnySlot& slot )
+        { return signal.messageType().isSameOrSubtypeOf( &slot.messageType() ); }
+
+    /// Destructor called by the Message queue once the Link is retired
+    ~Link() {}
+
+    /**
+     * @brief Disconnect the Link from its Signal and Slot and retire it
+     *
+     * The Link is marked as disconnected so that its pending entries are
+     * skipped, and handed to its Message queue which deletes it once these
+     * entries are processed. Disconnecting is thus independent of the queue
+     * length.
+     */
     void disconnect();
 
+    /// Select the queue and channel according to the Signal and Slot Domains
+    void updateDomains();
+
 protected:
     AnySignal* m_signal;              ///< Signal member variable
     AnySlot* m_slot;                  ///< Slot member variable
     AnySlot::Function m_slotFunction; ///< Slot function to call
+    Message::Emitted* m_queue;        ///< Message queue of the Slot Domain
+    Message::Emitted::Channel* m_channel; ///< Channel between Domains or nullptr
+    size_t m_signalIndex;             ///< Position in the Signal links
+    size_t m_slotIndex;               ///< Position in the Slot links
+    bool m_connected;                 ///< False once disconnected
+    Message::Priority m_priority;     ///< Priority of the lane of the Message
+    bool m_coalesce;                  ///< True if the Message are coalesced
+    bool m_direct;                    ///< True if emit() calls the Slot
+    Message::Priority m_pendingLane;  ///< Lane of the last queued entry
+    size_t m_pendingSeq;              ///< Sequence number of the last entry
 };
 
 
@@ -3,6 +3,18 @@
 
 
 #include "Action.hpp"
+#include "MessagePool.hpp"
+#include "BufferMessage.hpp"
+#include "MessageCodec.hpp"
 #include "Link.hpp"
+#include "Topology.hpp"
+#include "GraphArena.hpp"
+#include "Domain.hpp"
+#include "Scheduler.hpp"
+#include "ShmTransport.hpp"
+#include "TcpTransport.hpp"
+#include "Journal.hpp"
+#include "Trace.hpp"
+#include "Coroutine.hpp"
 
 #endif // MPO_HPP
@@ -4,20 +4,55 @@ CONFIG -= qt
 
 //QMAKE_CXXFLAGS += -std=c++0x
 
+LIBS += -lboost_thread -lboost_chrono -lboost_system
+unix:!macx: LIBS += -lrt
+
 SOURCES += main.cpp \
     Message.cpp \
+    Instrumentation.cpp \
+    Trace.cpp \
+    BufferMessage.cpp \
+    MessageCodec.cpp \
     Link.cpp \
     Signal.cpp \
     Slot.cpp \
-    Action.cpp
+    Action.cpp \
+    Topology.cpp \
+    GraphArena.cpp \
+    Domain.cpp \
+    Scheduler.cpp \
+    RemoteSlot.cpp \
+    ShmRing.cpp \
+    ShmTransport.cpp \
+    TcpTransport.cpp \
+    Journal.cpp
 
 HEADERS += \
     Type.hpp \
+    RingBuffer.hpp \
+    MpscQueue.hpp \
+    SpscQueue.hpp \
+    Instrumentation.hpp \
+    Trace.hpp \
     Message.hpp \
+    MessagePool.hpp \
+    BufferMessage.hpp \
+    MessageCodec.hpp \
     Action.hpp \
     Link.hpp \
     Signal.hpp \
     Slot.hpp \
+    Topology.hpp \
+    GraphArena.hpp \
+    Domain.hpp \
+    Scheduler.hpp \
+    RemoteSlot.hpp \
+    ShmRing.hpp \
+    ShmTransport.hpp \
+    TcpTransport.hpp \
+    Journal.hpp \
+    AsioAdaptor.hpp \
+    Coroutine.hpp \
     MPO.hpp
 
 OTHER_FILES += \
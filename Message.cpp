@@ -1,5 +1,8 @@
+#include <boost/thread/thread.hpp>
+
 #include "Message.hpp"
 #include "Link.hpp"
+#include "Trace.hpp"
 
 namespace MPO
 {
@@ -9,19 +12,329 @@ namespace MPO
     // Instantiate the emitted Message queue
     Message::Emitted Message::emitted;
 
+    // Constructor of an empty queue notifying only when becoming non empty
+    Message::Emitted::Emitted() : m_size(0), m_scheduling(StrictPriority),
+        m_highWaterMark(0), m_capacity(0), m_overflowPolicy(DropNewest),
+        m_overflowed(false), m_multiProducer(false), m_nbrIncoming(0),
+        m_directDepth(0)
+    {
+        for( size_t i = 0; i < NbrPriorities; ++i )
+            m_weights[i] = m_credits[i] = size_t(1) << ( NbrPriorities - 1 - i );
+    }
+
+    // Delete the channels and the Links retired with pending entries
+    Message::Emitted::~Emitted()
+    {
+        for( size_t i = 0; i < m_channels.size(); ++i )
+            delete m_channels[i];
+        while( !m_retired.empty() )
+        {
+            if( m_retired.front().memory )
+                m_retired.front().memory->release();
+            else
+                delete m_retired.front().link;
+            m_retired.pop_front();
+        }
+    }
+
+    // Delete the Link now if no entry may refer to it, later otherwise
+    void Message::Emitted::retire( Link* link )
+    {
+        drainIncoming();
+        if( queued() == 0 )
+        {
+            delete link;
+            return;
+        }
+        Retired retired;
+        retired.link = link;
+        for( size_t i = 0; i < NbrPriorities; ++i )
+            retired.tails[i] = m_lanes[i].tail();
+        m_retired.push_back( retired );
+    }
+
+    // Release the memory now if no entry may refer to its Links
+    void Message::Emitted::retire( GraphMemory* memory )
+    {
+        drainIncoming();
+        if( queued() == 0 )
+        {
+            memory->release();
+            return;
+        }
+        Retired retired;
+        retired.memory = memory;
+        for( size_t i = 0; i < NbrPriorities; ++i )
+            retired.tails[i] = m_lanes[i].tail();
+        m_retired.push_back( retired );
+    }
+
+    // Delete the retired Links whose entries were all processed. The entries
+    // queued in a lane before its tail are processed once its head reached
+    // it, which is tested with offsets from tail to be safe with wrapped
+    // sequence numbers
+    void Message::Emitted::reclaim()
+    {
+        while( !m_retired.empty() )
+        {
+            Retired& retired = m_retired.front();
+            for( size_t i = 0; i < NbrPriorities; ++i )
+                if( m_lanes[i].head() - retired.tails[i] >
+                        m_lanes[i].tail() - retired.tails[i] )
+                    return;
+            if( retired.memory )
+                retired.memory->release();
+            else
+                delete retired.link;
+            m_retired.pop_front();
+        }
+    }
+
+    // Move the entries of the MPSC queue and of the channels in their lane
+    void Message::Emitted::moveIncoming()
+    {
+        size_t n = 0;
+        Entry entry;
+        if( m_multiProducer )
+            while( m_incoming.pop( entry ) )
+            {
+                if( !entry.link->m_coalesce || !replacePending( entry ) )
+                    push( entry, entry.link->m_priority );
+                ++n;
+            }
+        for( size_t i = 0; i < m_channels.size(); ++i )
+            while( m_channels[i]->pop( entry ) )
+            {
+                if( !entry.link->m_coalesce || !replacePending( entry ) )
+                    push( entry, entry.link->m_priority );
+                ++n;
+            }
+        if( n )
+            m_nbrIncoming.fetch_sub( n, boost::memory_order_acq_rel );
+    }
+
+    // Replace the Message of the pending entry of a coalescing Link
+    void Message::Emitted::coalesce( Entry& entry )
+    {
+        if( m_multiProducer || !replacePending( entry ) )
+            add( entry, entry.link->m_priority );
+    }
+
+    // Swap the Message of entry with the one of the Link pending entry if
+    // it is still queued, otherwise record where entry will be pushed
+    bool Message::Emitted::replacePending( Entry& entry )
+    {
+        Link* link = entry.link;
+        Queue& lane = m_lanes[link->m_pendingLane];
+        size_t i = link->m_pendingSeq - lane.head();
+        if( i < lane.size() && lane[i].link == link )
+        {
+            lane[i].msg.swap( entry.msg );
+            return true;
+        }
+        link->m_pendingLane = link->m_priority;
+        link->m_pendingSeq = m_lanes[link->m_priority].tail();
+        return false;
+    }
+
+    // Forward entry, with the entries of its Link following it when the Slot
+    // processes batches, and return the number of Message forwarded
+    size_t Message::Emitted::dispatch( Entry& entry, size_t max )
+    {
+        Link* link = entry.link;
+        const boost::uint64_t now = Instrumentation::now();
+        // The Link may be deleted by the Slot method, the traced data is
+        // read before
+        const bool traced = Trace::isEnabled();
+        const TypeDef* type = nullptr;
+        AnySlot* slot = nullptr;
+        if( traced )
+        {
+            type = entry.msg ? &entry.msg->type() : &Message::Type();
+            slot = link->m_slot;
+        }
+        Priority priority = link->m_priority;
+        if( !link->m_slotFunction.batch )
+        {
+            recordLatency( entry.stamped(), now );
+            if( traced )
+                Trace::record( TraceRecord::DispatchBegin, link, slot, *type,
+                               priority );
+            link->forward( entry.msg, now );
+            if( traced )
+                Trace::record( TraceRecord::DispatchEnd, link, slot, *type,
+                               priority );
+            return 1;
+        }
+        size_t limit = std::min( max, link->m_slot->batchSize() );
+        Queue& lane = m_lanes[priority];
+        // The batch is swapped out while forwarded in case the Slot method
+        // processes the queue again
+        std::vector<Message::Ptr> batch;
+        batch.swap( m_batch );
+        batch.push_back( Message::Ptr() );
+        batch.back().swap( entry.msg );
+        recordLatency( entry.stamped(), now );
+        while( batch.size() < limit && !lane.empty() && lane.front().link == link )
+        {
+            recordLatency( lane.front().stamped(), now );
+            batch.push_back( Message::Ptr() );
+            batch.back().swap( lane.front().msg );
+            lane.pop_front();
+            setQueued( queued() - 1 );
+        }
+        size_t n = batch.size();
+        if( traced )
+            Trace::record( TraceRecord::DispatchBegin, link, slot, *type,
+                           priority, n );
+        link->forwardBatch( &batch[0], n, now );
+        if( traced )
+            Trace::record( TraceRecord::DispatchEnd, link, slot, *type,
+                           priority, n );
+        batch.clear();
+        batch.swap( m_batch );
+        return n;
+    }
+
+    // Forward the entry of a direct Link while the nested calls are below
+    // the maximum depth, the depth is restored if the Slot method throws
+    void Message::Emitted::call( Entry& entry, Priority priority )
+    {
+        if( m_multiProducer || m_directDepth >= MaxDirectDepth )
+        {
+            add( entry, priority );
+            return;
+        }
+        entry.stamp( Instrumentation::now() );
+        ++m_directDepth;
+        try
+        {
+            dispatch( entry, 1 );
+        }
+        catch( ... )
+        {
+            --m_directDepth;
+            throw;
+        }
+        --m_directDepth;
+        entry.msg.reset();
+    }
+
+    // Drop the oldest entry of the lane, coalesce or drop entry
+    bool Message::Emitted::makeRoom( Entry& entry, Priority priority )
+    {
+        m_overflowed.store( true, boost::memory_order_relaxed );
+        Queue& lane = m_lanes[priority];
+        switch( m_overflowPolicy )
+        {
+        case Block:
+            throw std::runtime_error( "Message::Emitted full with the Block "
+                                      "policy in its processing thread" );
+        case DropOldest:
+            if( lane.empty() )
+                return false;
+            lane.pop_front();
+            setQueued( queued() - 1 );
+            return true;
+        case Coalesce:
+            if( !lane.empty() && lane[lane.size()-1].link == entry.link )
+                lane[lane.size()-1].msg.swap( entry.msg );
+            return false;
+        default:
+            return false;
+        }
+    }
+
+    // Wait for the processing thread to make room or drop the entry
+    bool Message::Emitted::waitForRoom()
+    {
+        m_overflowed.store( true, boost::memory_order_relaxed );
+        if( m_overflowPolicy != Block )
+            return false;
+        while( !hasRoom( 1 ) )
+            boost::this_thread::yield();
+        return true;
+    }
+
+    // Notify the producers once the queue drained to half its capacity
+    void Message::Emitted::checkWritable()
+    {
+        if( m_capacity && size() > m_capacity / 2 )
+            return;
+        m_overflowed.store( false, boost::memory_order_relaxed );
+        if( m_writable )
+            m_writable();
+    }
+
+    // Serve the first non empty lane with credits left, starting a new
+    // round when all non empty lanes used their credits
+    Message::Emitted::Queue& Message::Emitted::nextWeightedLane()
+    {
+        for( int round = 0; round < 2; ++round )
+        {
+            for( size_t i = 0; i < NbrPriorities; ++i )
+                if( !m_lanes[i].empty() && m_credits[i] )
+                {
+                    --m_credits[i];
+                    return m_lanes[i];
+                }
+            std::copy( m_weights, m_weights + NbrPriorities, m_credits );
+        }
+        // Only lanes of weight 0 have entries
+        for( size_t i = 0; ; ++i )
+            if( !m_lanes[i].empty() )
+                return m_lanes[i];
+    }
+
     // Process the next queued entry if and return false if no more entries
     bool Message::Emitted::processNext()
     {
-        if( empty() )
-            return false;
+        drainIncoming();
         Entry entry;
-        get( entry );
-        if( entry.link != nullptr )
-            entry.link->forward( entry.msg );
-
+        while( queued() )
+        {
+            pop( entry );
+            // Skip entries of disconnected Links
+            if( entry.link->m_connected )
+            {
+                dispatch( entry, size_t(-1) );
+                break;
+            }
+        }
+        if( !m_retired.empty() )
+            reclaim();
+        if( m_overflowed.load( boost::memory_order_relaxed ) )
+            checkWritable();
         return !empty();
     }
 
+    // Process up to n of the entries queued when called
+    size_t Message::Emitted::processBatch( size_t n )
+    {
+        drainIncoming();
+        if( n > queued() )
+            n = queued();
+        size_t count = 0;
+        Entry entry;
+        while( n )
+        {
+            pop( entry );
+            --n;
+            // Skip entries of disconnected Links
+            if( entry.link->m_connected )
+            {
+                size_t nbrForwarded = dispatch( entry, n + 1 );
+                count += nbrForwarded;
+                n -= nbrForwarded - 1;
+            }
+        }
+        if( !m_retired.empty() )
+            reclaim();
+        if( m_overflowed.load( boost::memory_order_relaxed ) )
+            checkWritable();
+        return count;
+    }
+
 
 
 }
@@ -4,14 +4,24 @@
 #include <boost/shared_ptr.hpp>
 #include <boost/enable_shared_from_this.hpp>
 #include <boost/function.hpp>
-#include <list>
+#include <stdexcept>
+#include <algorithm>
+#include <vector>
 
 #include "Type.hpp"
+#include "RingBuffer.hpp"
+#include "MpscQueue.hpp"
+#include "SpscQueue.hpp"
+#include "Instrumentation.hpp"
 
 namespace MPO
 {
 
 class Link;
+class GraphMemory;
+
+/// Link vector definition
+typedef std::vector<Link*> LinkVector;
 
 /**
     @brief Message root base class of user defined messages
@@ -78,6 +88,8 @@ class Message : public boost::enable_shared_from_this<Message>
 {
     friend class AnySignal;
     friend class Link;
+    friend class Domain;
+    friend class GraphArena; // GraphArena retires its Links per queue
 
 public:
 
@@ -90,6 +102,32 @@ public:
     /// Define the Message notifier call back function type
     typedef boost::function<void ()> MessageNotifier;
 
+    /// Priority classes of the Links, each queuing in its own lane
+    enum Priority
+    {
+        ControlPriority, ///< Control Message such as shutdown or reconfigure
+        HighPriority,    ///< Latency sensitive Message
+        NormalPriority,  ///< Default priority of the Links
+        BulkPriority,    ///< Bulk data Message
+        NbrPriorities    ///< Number of priority classes
+    };
+
+    /// Policies applied when a Message is emitted in a full queue
+    enum OverflowPolicy
+    {
+        Block,      ///< Wait until the processing thread made room
+        DropNewest, ///< Drop the emitted Message
+        DropOldest, ///< Drop the oldest Message of the same priority
+        Coalesce    ///< Replace the last Message of the Link if at the back
+    };
+
+    /// Policies serving the lanes of the Message queue
+    enum Scheduling
+    {
+        StrictPriority,    ///< Serve the first non empty lane in priority order
+        WeightedRoundRobin ///< Serve each lane up to its weight per round
+    };
+
     /**
      * @brief Return a copy of the shared_ptr on the instance
      *
@@ -132,6 +170,57 @@ public:
      */
     virtual const TypeDef& type() const { return Message::Type(); }
 
+    /**
+     * @brief Return a copy of the Message, used by mutate() when shared
+     *
+     * Message classes modified by their Slots must override clone() to
+     * return a copy of their own class. PooledMessage classes implement it
+     * with their copy constructor.
+     *
+     * @return shared_ptr on the copy of the Message
+     * @throw std::runtime_error if the Message class doesn't override it
+     */
+    virtual Ptr clone() const
+    {
+        throw std::runtime_error( "Message " + type().name() +
+                                  " doesn't implement clone()" );
+    }
+
+    /**
+     * @brief Make msg the sole owner of its Message and return it to modify
+     *
+     * A Message emitted through several Links is shared by their Slots. If
+     * msg is the only reference on its Message, the Message is returned in
+     * place, otherwise msg is replaced by a clone() of it, so that the other
+     * Slots still see the Message unchanged. A pipeline of Actions modifying
+     * and emitting a Message through single Links thus never copies it,
+     * only fan out points do.
+     *
+     * @code
+        void MyAction::scale( Frame::Ptr frame, Link* )
+        {
+            Message::mutate( frame ).gain *= 2;
+            m_output.emit( frame );
+        }
+     * @endcode
+     *
+     * Slots taking their Message by reference or keeping the shared_ptr
+     * they received hold references, mutate() then clones the Message.
+     * Without rvalue references the Link copies the shared_ptr it passes
+     * to the Slot, which then never holds the only reference and always
+     * clones the Message.
+     *
+     * @param msg shared_ptr on the Message, replaced by a copy if shared
+     * @return reference on the Message owned by msg alone
+     */
+    template <class TMessage>
+    static TMessage& mutate( boost::shared_ptr<TMessage>& msg )
+    {
+        if( !msg.unique() )
+            msg = boost::static_pointer_cast<TMessage>( msg->clone() );
+        return *msg;
+    }
+
     /**
      * @brief Process the next pending Message or return false if empty
      *
@@ -139,6 +228,32 @@ public:
      */
     static bool processNext() { return emitted.processNext(); }
 
+    /**
+     * @brief Process up to n pending Message and return the number processed
+     *
+     * Only the Message pending when the call is made are processed. Message
+     * emitted by the called Slot methods are left for a later call.
+     *
+     * @param n Maximum number of Message to process
+     * @return the number of Message forwarded to a Slot
+     */
+    static size_t processBatch( size_t n ) { return emitted.processBatch( n ); }
+
+    /**
+     * @brief Process pending Message until the queue is empty or the deadline
+     *        is reached and return the number processed
+     *
+     * The deadline is checked every batchSize Message. The deadline may be
+     * a std::chrono or boost::chrono time_point.
+     *
+     * @param deadline Time point after which no new batch is started
+     * @param batchSize Number of Message processed between deadline checks
+     * @return the number of Message forwarded to a Slot
+     */
+    template <class TTimePoint>
+    static size_t processUntil( const TTimePoint& deadline, size_t batchSize = 64 )
+        { return emitted.processUntil( deadline, batchSize ); }
+
     /**
      * @brief set the Message queuing notification call back function
      *
@@ -146,20 +261,178 @@ public:
      * replaced by the new one. Passing 0 as argument will clear any
      * message notification call back that was previously set.
      *
+     * The call back is only called when a Message is queued in an empty
+     * queue or when the queue size reaches the high water mark. The thread
+     * processing the queue must thus process Message until processNext()
+     * returns false before going back to sleep.
+     *
      * @param messageNotifier a function pointer on the message notifier
      *                        callback function or 0 to clear an existing
      *                        callback.
      */
-    void setMessageNotifier( MessageNotifier messageNotifier )
+    static void setMessageNotifier( MessageNotifier messageNotifier )
     {
         emitted.setMessageNotifier( messageNotifier );
     }
 
+    /**
+     * @brief Return the statistics of the main Domain Message queue
+     *
+     * The statistics are only recorded when the Instrumentation policy is
+     * CounterInstrumentation, selected by defining MPO_INSTRUMENTATION in
+     * all translation units. Otherwise the hooks compile to nothing and the
+     * statistics are 0.
+     *
+     * @return the maximum depth and latency histogram of the queue
+     */
+    static const Instrumentation::QueueStats& stats() { return emitted.stats(); }
+
+    /**
+     * @brief Set the queue size at which the message notifier is called again
+     *
+     * @param highWaterMark Queue size triggering a notification or 0 to
+     *                      only notify when queuing in an empty queue
+     */
+    static void setHighWaterMark( size_t highWaterMark )
+    {
+        emitted.setHighWaterMark( highWaterMark );
+    }
+
+    /**
+     * @brief Enable or disable the multiple producers mode of the queue
+     *
+     * In multiple producers mode, any thread may emit Message with a Signal
+     * while a single thread processes the Message queue. The emitted
+     * entries are pushed in a lock-free queue and moved in the Message
+     * queue by the processing thread. The message notifier may then be
+     * called by any emitting thread.
+     *
+     * The mode must be changed while no other thread emits Message, and
+     * the Links must not be connected or disconnected while other threads
+     * emit Message.
+     *
+     * @param multiProducer true to enable the multiple producers mode
+     */
+    static void setMultiProducer( bool multiProducer )
+    {
+        emitted.setMultiProducer( multiProducer );
+    }
+
+    /**
+     * @brief Limit the number of Message pending in the queue
+     *
+     * When a Message is emitted in a full queue the overflow policy is
+     * applied. Message sent by other threads through channels or in
+     * multiple producers mode may only be blocked or dropped, and several
+     * producers may exceed the capacity by the number of producers.
+     *
+     * @param capacity Maximum number of pending Message or 0 for no limit
+     */
+    static void setCapacity( size_t capacity )
+    {
+        emitted.setCapacity( capacity );
+    }
+
+    /**
+     * @brief Set the policy applied when a Message is emitted in a full
+     *        queue
+     *
+     * The Block policy makes the emitting thread wait, so it may only be
+     * used with Signals emitting from another thread than the one
+     * processing the queue. A runtime_error is thrown otherwise. The
+     * default policy is DropNewest.
+     *
+     * @param policy Overflow policy
+     */
+    static void setOverflowPolicy( OverflowPolicy policy )
+    {
+        emitted.setOverflowPolicy( policy );
+    }
+
+    /**
+     * @brief Set the call back function called when the queue is writable
+     *        again
+     *
+     * Once the queue overflowed or a Signal::tryEmit() failed, the call
+     * back is called by the processing thread when the queue size drops to
+     * half its capacity, so that the producers may resume emitting.
+     *
+     * @param writableNotifier function called when the queue is writable
+     *                         again or 0 to clear an existing one
+     */
+    static void setWritableNotifier( MessageNotifier writableNotifier )
+    {
+        emitted.setWritableNotifier( writableNotifier );
+    }
+
+    /**
+     * @brief Set the policy serving the priority lanes of the queue
+     *
+     * With StrictPriority, the default, a Message is only processed when
+     * the lanes of higher priority are empty, so that control Message are
+     * not delayed by the bulk ones. With WeightedRoundRobin, each non empty
+     * lane is served up to its weight in each round, so that the lower
+     * lanes are not starved.
+     *
+     * @param scheduling Policy serving the lanes
+     */
+    static void setScheduling( Scheduling scheduling )
+    {
+        emitted.setScheduling( scheduling );
+    }
+
+    /**
+     * @brief Set the number of Message processed from a lane in a round of
+     *        the WeightedRoundRobin scheduling
+     *
+     * The default weights are 8, 4, 2 and 1 from the control lane to the
+     * bulk lane. A lane of weight 0 is only served when the others are
+     * empty.
+     *
+     * @param priority Priority class of the lane
+     * @param weight Number of Message processed per round
+     */
+    static void setLaneWeight( Priority priority, size_t weight )
+    {
+        emitted.setLaneWeight( priority, weight );
+    }
+
+    /**
+     * @brief Return the number of Message pending in a priority lane
+     *
+     * The Message emitted by other threads are only counted once moved in
+     * their lane by the processing thread.
+     *
+     * @param priority Priority class of the lane
+     * @return the number of entries in the lane
+     */
+    static size_t laneSize( Priority priority )
+    {
+        return emitted.laneSize( priority );
+    }
+
 
 protected:
 
-    /// Queue of emitted Message pending to be processed
-    class Emitted
+    /**
+        @brief Queue of emitted Message pending to be processed
+
+        The entries are stored in contiguous RingBuffers whose capacity is
+        reused across bursts of emitted Message. Once the queue reached the
+        size required by the application, queuing and processing Message
+        entries doesn't allocate memory.
+
+        There is one RingBuffer, or lane, per Priority class. An entry is
+        queued in the lane of the priority of its Link and the lanes are
+        served according to the Scheduling policy, in FIFO order within a
+        lane.
+
+        Each dispatch Domain owns an Emitted queue. The entries sent by other
+        Domains go through single producer single consumer channels and the
+        entries added in multiple producers mode go through a lock-free MPSC
+        queue. They are moved in the ring buffer by the processing thread.
+    */
+    class Emitted : private Instrumentation::QueueStats
     {
     public:
 
@@ -167,7 +440,7 @@ protected:
         typedef boost::function<void ()> MessageNotifier;
 
         /// Pending Message entry
-        struct Entry
+        struct Entry : public Instrumentation::EntryStats
         {
             /**
              * @brief Constructor of Pending Message entry
@@ -175,74 +448,276 @@ protected:
              * @param msg Pending Message in queue
              * @param link Link traversed by Message
              */
-            Entry( Message::Ptr msg, Link* link ) : msg(msg), link(link) {}
+            Entry( const Message::Ptr& msg, Link* link ) : msg(msg), link(link) {}
 
             /// Default constructor
             Entry() : link(0) {}
 
+            /**
+             * @brief Exchange the content of two entries
+             *
+             * @param other Entry to exchange content with
+             */
+            void swap( Entry& other )
+            {
+                msg.swap( other.msg );
+                std::swap( link, other.link );
+                EntryStats::swap( other );
+            }
+
             Message::Ptr msg; ///< Pending Message
             Link* link;       ///< Link traversed by Message
         };
 
+        /// Channel through which another dispatch Domain adds entries
+        typedef SpscQueue<Entry> Channel;
+
+        /// Constructor of an empty queue notifying only when becoming non empty
+        Emitted();
+
+        /// Destructor deleting the channels and the retired Links
+        ~Emitted();
+
         /**
          * @brief Return true if the queue is empty
          *
          * @return true if the queue is empty
          */
-        bool empty() const { return m_queue.empty(); }
+        bool empty() const
+        {
+            if( queued() != 0 )
+                return false;
+            // Order the store of the emptied lanes before the load of the
+            // incoming count, as addIncoming() does the other way round, so
+            // that either the producer notifies or the consumer sees its entry
+            boost::atomic_thread_fence( boost::memory_order_seq_cst );
+            return m_nbrIncoming.load( boost::memory_order_acquire ) == 0;
+        }
 
         /**
          * @brief Return the number of entries in the queue
          *
+         * The count includes the entries of disconnected Links that were
+         * not yet skipped by processNext().
+         *
          * @return the number of entries in the queue
          */
-        size_t size() const { return m_queue.size(); }
+        size_t size() const
+        {
+            return queued() +
+                m_nbrIncoming.load( boost::memory_order_acquire );
+        }
+
+        /**
+         * @brief Return the number of entries the queue may hold without
+         *        allocating memory
+         *
+         * @return the capacity of the queue
+         */
+        size_t capacity() const
+        {
+            size_t n = 0;
+            for( size_t i = 0; i < NbrPriorities; ++i )
+                n += m_lanes[i].capacity();
+            return n;
+        }
+
+        /**
+         * @brief Return the number of entries in a priority lane
+         *
+         * @param priority Priority class of the lane
+         * @return the number of entries in the lane
+         */
+        size_t laneSize( Priority priority ) const
+            { return m_lanes[priority].size(); }
+
+        /**
+         * @brief Return true if n entries may be added without overflowing
+         *
+         * When false is returned, the writable notifier will be called once
+         * the queue drained to half its capacity.
+         *
+         * @param n Number of entries to add
+         * @return true if the queue has room for n entries
+         */
+        bool canAdd( size_t n )
+        {
+            if( hasRoom( n ) )
+                return true;
+            m_overflowed.store( true, boost::memory_order_relaxed );
+            return false;
+        }
 
         /**
          * @brief Add entry to the queue for FIFO processing
          *
-         * Once a message is queued, the Message notification call back
-         * function will be called if one has been provided
+         * When the entry is queued in an empty queue or when the queue size
+         * reaches the high water mark, the Message notification call back
+         * function will be called if one has been provided.
+         *
+         * The content of entry is moved in the queue with swap() and entry
+         * is left default constructed, so that queuing doesn't modify the
+         * reference count of the Message.
+         *
+         * When the queue is full, the overflow policy is applied and entry
+         * may be dropped.
          *
          * @param entry Entry to add to the queue
+         * @param priority Priority of the entry Link
          */
-        void add( const Entry& entry )
+        void add( Entry& entry, Priority priority )
         {
-            m_queue.push_front( entry );
-            if( m_notify )
+            entry.stamp( Instrumentation::now() );
+            if( m_multiProducer )
+            {
+                if( !hasRoom( 1 ) && !waitForRoom() )
+                    return;
+                // The entries in the lanes count, so that the consumer is
+                // only notified when the whole queue becomes non empty
+                size_t n = addIncoming( 1 ) + 1;
+                m_incoming.push( entry );
+                if( m_notify && ( n == 1 || n == m_highWaterMark ) )
+                    m_notify();
+                return;
+            }
+            if( !hasRoom( 1 ) && !makeRoom( entry, priority ) )
+                return;
+            push( entry, priority );
+            size_t n = queued();
+            if( m_notify && ( n == 1 || n == m_highWaterMark ) )
                 m_notify();
         }
 
         /**
-         * @brief Extract entry from the queue for FIFO processing
+         * @brief Add an entry for each of the n links to the queue
+         *
+         * The entries are appended at once and the Message notification
+         * call back function is called at most once, when the queue was
+         * empty or when the high water mark is crossed. When the entries
+         * would overflow the queue, they are added one by one with the
+         * overflow policy.
+         *
+         * @param msg Message of the entries
+         * @param links Array of the links traversed by the Message
+         * @param n Number of links
+         * @param take true if the last entry takes over msg, which is then
+         *             left empty, false if all entries hold a copy
+         * @param priority Priority of the links
+         */
+        void add( Message::Ptr& msg, Link* const* links, size_t n, bool take,
+                  Priority priority )
+        {
+            size_t before, after;
+            Entry entry;
+            const boost::uint64_t now = Instrumentation::now();
+            if( !hasRoom( n ) )
+            {
+                for( size_t i = 0; i < n; ++i )
+                {
+                    entry.link = links[i];
+                    if( take && i + 1 == n )
+                        entry.msg.swap( msg );
+                    else
+                        entry.msg = msg;
+                    add( entry, priority );
+                }
+                return;
+            }
+            if( m_multiProducer )
+            {
+                before = addIncoming( n );
+                after = before + n;
+                for( size_t i = 0; i < n; ++i )
+                {
+                    entry.link = links[i];
+                    if( take && i + 1 == n )
+                        entry.msg.swap( msg );
+                    else
+                        entry.msg = msg;
+                    entry.stamp( now );
+                    m_incoming.push( entry );
+                }
+            }
+            else
+            {
+                Queue& lane = m_lanes[priority];
+                before = queued();
+                after = before + n;
+                lane.reserve( lane.size() + n );
+                for( size_t i = 0; i < n; ++i )
+                {
+                    entry.link = links[i];
+                    if( take && i + 1 == n )
+                        entry.msg.swap( msg );
+                    else
+                        entry.msg = msg;
+                    entry.stamp( now );
+                    push( entry, priority );
+                }
+            }
+            if( m_notify && ( before == 0 ||
+                    ( before < m_highWaterMark && after >= m_highWaterMark ) ) )
+                m_notify();
+        }
+
+        /**
+         * @brief Return the statistics of the queue
+         *
+         * @return the statistics recorded by the Instrumentation policy
+         */
+        const Instrumentation::QueueStats& stats() const { return *this; }
+
+        /**
+         * @brief Add the entry of a coalescing Link to the queue
+         *
+         * If the Link of entry already has an entry pending in the queue,
+         * the Message of this entry is replaced by the one of entry, which
+         * then holds the previous Message. Otherwise entry is added as with
+         * add(). In multiple producers mode the entries are coalesced when
+         * moved in the lanes by the processing thread.
+         *
+         * @param entry Entry of a coalescing Link
+         */
+        void coalesce( Entry& entry );
+
+        /**
+         * @brief Extract the next entry to process from the queue
          *
          * @param[out] entry extracted from the queue
          * @throws runtime_error is called on an empty Message queue
          */
         void get( Entry& entry )
         {
-            if( empty() )
+            drainIncoming();
+            if( queued() == 0 )
                throw std::runtime_error( "Message::Emitted::get called on empty Message queue" );
-            entry = m_queue.back();
-            m_queue.pop_back();
+            pop( entry );
         }
 
         /**
-         * @brief Erase all queue entry with the given link
+         * @brief Delete a disconnected Link once no entry refers to it
          *
-         * This method is called when a Link is deleted to ensure that all
-         * pending Message on the Link are removed.
+         * This method is called when a Link is disconnected. The pending
+         * entries of the Link are left in the queue and skipped by
+         * processNext() and processBatch(), which release their Message.
+         * The Link is deleted right away if the queue is empty, otherwise
+         * once the entries queued before the call are all processed, so
+         * that disconnecting a Link doesn't depend on the queue length.
          *
-         * @param link to look for and remove in the Message queue
+         * @param link Disconnected Link to delete
          */
-        void erase( Link* link )
-        {
-            for( Queue::iterator it = m_queue.begin(); it != m_queue.end();)
-                if( it->link == link )
-                    it = m_queue.erase(it);
-                else
-                    ++it;
-        }
+        void retire( Link* link );
+
+        /**
+         * @brief Release a reference of a GraphMemory once no entry refers
+         *        to its Links
+         *
+         * This method is called when a GraphArena detached its Links in
+         * bulk, once per queue holding their entries.
+         *
+         * @param memory GraphMemory of the detached Links
+         */
+        void retire( GraphMemory* memory );
 
         /**
          * @brief Process the next Message in the queue or return false if empty
@@ -251,6 +726,31 @@ protected:
          */
         bool processNext();
 
+        /**
+         * @brief Process up to n entries pending when called
+         *
+         * @param n Maximum number of entries to process
+         * @return the number of Message forwarded to a Slot
+         */
+        size_t processBatch( size_t n );
+
+        /**
+         * @brief Process batches of entries until the queue is empty or the
+         *        deadline is reached
+         *
+         * @param deadline Time point after which no new batch is started
+         * @param batchSize Number of entries processed between deadline checks
+         * @return the number of Message forwarded to a Slot
+         */
+        template <class TTimePoint>
+        size_t processUntil( const TTimePoint& deadline, size_t batchSize )
+        {
+            size_t count = 0;
+            while( !empty() && TTimePoint::clock::now() < deadline )
+                count += processBatch( batchSize );
+            return count;
+        }
+
         /**
          * @brief set the Message queuing notification call back function
          *
@@ -267,11 +767,299 @@ protected:
             m_notify = messageNotifier;
         }
 
+        /**
+         * @brief Set the queue size at which the message notifier is called
+         *
+         * @param highWaterMark Queue size triggering a notification or 0 to
+         *                      only notify when queuing in an empty queue
+         */
+        void setHighWaterMark( size_t highWaterMark )
+        {
+            m_highWaterMark = highWaterMark;
+        }
+
+        /**
+         * @brief Enable or disable the multiple producers mode
+         *
+         * Entries added in multiple producers mode are pushed in a lock-free
+         * queue and moved in the Message queue by the processing thread.
+         * Disabling the mode moves the pending incoming entries in the
+         * Message queue.
+         *
+         * @param multiProducer true to enable the multiple producers mode
+         */
+        void setMultiProducer( bool multiProducer )
+        {
+            drainIncoming();
+            m_multiProducer = multiProducer;
+        }
+
+        /**
+         * @brief Set the policy serving the priority lanes
+         *
+         * @param scheduling Policy serving the lanes
+         */
+        void setScheduling( Scheduling scheduling )
+        {
+            m_scheduling = scheduling;
+            std::copy( m_weights, m_weights + NbrPriorities, m_credits );
+        }
+
+        /**
+         * @brief Set the number of entries processed from a lane in a round
+         *        of the WeightedRoundRobin scheduling
+         *
+         * @param priority Priority class of the lane
+         * @param weight Number of entries processed per round
+         */
+        void setLaneWeight( Priority priority, size_t weight )
+        {
+            m_weights[priority] = weight;
+            m_credits[priority] = weight;
+        }
+
+        /**
+         * @brief Limit the number of entries in the queue
+         *
+         * @param capacity Maximum number of entries or 0 for no limit
+         */
+        void setCapacity( size_t capacity ) { m_capacity = capacity; }
+
+        /**
+         * @brief Set the policy applied when an entry is added to a full queue
+         *
+         * @param policy Overflow policy
+         */
+        void setOverflowPolicy( OverflowPolicy policy ) { m_overflowPolicy = policy; }
+
+        /**
+         * @brief Set the call back function called when the queue drained to
+         *        half its capacity after an overflow
+         *
+         * @param writableNotifier function called when the queue is writable
+         *                         again or 0 to clear an existing one
+         */
+        void setWritableNotifier( MessageNotifier writableNotifier )
+        {
+            m_writable = writableNotifier;
+        }
+
+        /**
+         * @brief Create a new channel through which a single thread may
+         *        send entries to this queue
+         *
+         * The channel is owned by the queue.
+         *
+         * @return the newly created channel
+         */
+        Channel* addChannel()
+        {
+            m_channels.push_back( new Channel() );
+            return m_channels.back();
+        }
+
+        /**
+         * @brief Send an entry to the queue through one of its channels
+         *
+         * This method is called by the thread feeding the channel. The
+         * Message notification call back function is called in this thread
+         * when the queue had no incoming entries. As with add(), the content
+         * of entry is moved in the channel and entry left default constructed.
+         *
+         * @param channel Channel created by addChannel() on this queue
+         * @param entry Entry to send
+         */
+        void send( Channel& channel, Entry& entry )
+        {
+            if( !hasRoom( 1 ) && !waitForRoom() )
+                return;
+            entry.stamp( Instrumentation::now() );
+            size_t n = addIncoming( 1 ) + 1;
+            channel.push( entry );
+            if( m_notify && ( n == 1 || n == m_highWaterMark ) )
+                m_notify();
+        }
+
+        /// Maximum number of nested direct calls before queuing the entries
+        static const size_t MaxDirectDepth = 4;
+
+        /**
+         * @brief Call the Slot of the entry Link at once, from the
+         *        processing thread
+         *
+         * The Message is forwarded as dispatch() would, without being
+         * queued, unless MaxDirectDepth direct calls are already nested, as
+         * in a cycle of direct Links, or any thread may add entries. The
+         * entry is then added to the queue, so that the stack depth stays
+         * bounded. The entry is left without Message.
+         *
+         * @param entry Entry of a direct Link, its Message may be moved out
+         * @param priority Priority of the entry Link
+         */
+        void call( Entry& entry, Priority priority );
+
+        /**
+         * @brief Return true if call() would call the Slot at once rather
+         *        than add the entry to the queue
+         *
+         * @return true if the direct Links are called
+         */
+        bool callsDirectly() const
+            { return !m_multiProducer && m_directDepth < MaxDirectDepth; }
+
     private:
-        /// Define the Message queue type
-        typedef std::list<Entry> Queue;
-        Queue m_queue;            ///< The Message entry queue
+        /// Define the Message queue lane type
+        typedef RingBuffer<Entry> Queue;
+
+        /// Move entries added by other threads in the lanes of their Link
+        void drainIncoming()
+        {
+            if( m_nbrIncoming.load( boost::memory_order_acquire ) != 0 )
+                moveIncoming();
+        }
+
+        /// Move the incoming entries, called when there are some
+        void moveIncoming();
+
+        /**
+         * @brief Count n entries added by another thread
+         *
+         * The fence orders the increment before the load of the entries in
+         * the lanes, pairing with the fence of empty(), so that a producer
+         * never sees stale entries left in the lanes by a consumer which
+         * missed its increment.
+         *
+         * @param n Number of entries added
+         * @return number of entries in the queue before them
+         */
+        size_t addIncoming( size_t n )
+        {
+            size_t before = m_nbrIncoming.fetch_add( n,
+                                    boost::memory_order_acq_rel );
+            boost::atomic_thread_fence( boost::memory_order_seq_cst );
+            return before + queued();
+        }
+
+        /// Move entry at the back of the lane of priority
+        void push( Entry& entry, Priority priority )
+        {
+            Queue& lane = m_lanes[priority];
+            lane.push_back( Entry() );
+            lane[lane.size()-1].swap( entry );
+            setQueued( queued() + 1 );
+            recordDepth( queued() );
+        }
+
+        /// Move the next entry to process in entry, the queue must not be empty
+        void pop( Entry& entry )
+        {
+            Queue& lane = nextLane();
+            entry.swap( lane.front() );
+            lane.pop_front();
+            setQueued( queued() - 1 );
+        }
+
+        /// Return the lane to serve next according to the scheduling
+        Queue& nextLane()
+        {
+            // All entries in a single lane is the common case
+            if( m_scheduling == StrictPriority ||
+                    queued() == m_lanes[NormalPriority].size() )
+                for( size_t i = 0; i < NbrPriorities; ++i )
+                    if( !m_lanes[i].empty() )
+                        return m_lanes[i];
+            return nextWeightedLane();
+        }
+
+        /// Return the lane to serve next with weighted round robin
+        Queue& nextWeightedLane();
+
+        /// Return the number of entries in the lanes, which other threads
+        /// may read to check the capacity
+        size_t queued() const { return m_size.load( boost::memory_order_relaxed ); }
+
+        /// Set the number of entries in the lanes, only called by the
+        /// processing thread
+        void setQueued( size_t n ) { m_size.store( n, boost::memory_order_relaxed ); }
+
+        /// Return true if n more entries don't exceed the capacity
+        bool hasRoom( size_t n ) const
+            { return m_capacity == 0 || size() + n <= m_capacity; }
+
+        /**
+         * @brief Apply the overflow policy to an entry added by the
+         *        processing thread in a full queue
+         *
+         * @param entry Entry to add, left as is if dropped
+         * @param priority Priority of the entry Link
+         * @return true if entry must still be pushed
+         * @throws runtime_error if the policy is Block
+         */
+        bool makeRoom( Entry& entry, Priority priority );
+
+        /**
+         * @brief Apply the overflow policy to an entry sent by another thread
+         *        in a full queue
+         *
+         * @return true if entry must still be sent, after waiting for room
+         *         with the Block policy
+         */
+        bool waitForRoom();
+
+        /// Call the writable notifier when the queue drained after overflowing
+        void checkWritable();
+
+        /**
+         * @brief Forward the Message of entry and, if its Slot processes
+         *        batches, the ones of the same Link following it in its lane
+         *
+         * @param entry Entry of a connected Link, its Message is moved out
+         * @param max Maximum number of Message to forward
+         * @return the number of Message forwarded
+         */
+        size_t dispatch( Entry& entry, size_t max );
+
+        /**
+         * @brief Replace the Message of the pending entry of the entry Link
+         *
+         * @param entry Entry of a coalescing Link
+         * @return true if the Message was swapped with the pending one, false
+         *         if entry must be pushed, its position is then recorded
+         */
+        bool replacePending( Entry& entry );
+
+        /// Delete the retired Links whose entries were all processed
+        void reclaim();
+
+        /// Disconnected Link with the lane tails when it was retired
+        struct Retired
+        {
+            /// Default constructor
+            Retired() : link(0), memory(0) {}
+
+            size_t tails[NbrPriorities]; ///< Entries before these sequence
+                                         ///  numbers may use link
+            Link* link;                  ///< Disconnected Link to delete
+            GraphMemory* memory;         ///< Memory to release or nullptr
+        };
+        Queue m_lanes[NbrPriorities]; ///< Message entry lane per priority
+        boost::atomic<size_t> m_size; ///< Number of entries in the lanes
+        Scheduling m_scheduling;  ///< Policy serving the lanes
+        size_t m_weights[NbrPriorities]; ///< Entries served per round
+        size_t m_credits[NbrPriorities]; ///< Entries left in the round
         MessageNotifier m_notify; ///< Message notifier
+        size_t m_highWaterMark;   ///< Queue size triggering a notification
+        size_t m_capacity;        ///< Maximum number of entries or 0
+        OverflowPolicy m_overflowPolicy; ///< Policy applied on full queue
+        MessageNotifier m_writable;      ///< Writable again notifier
+        boost::atomic<bool> m_overflowed; ///< True until writable notified
+        bool m_multiProducer;     ///< True if any thread may add entries
+        MpscQueue<Entry> m_incoming;       ///< Entries added by any thread
+        std::vector<Channel*> m_channels;  ///< Channels from other Domains
+        boost::atomic<size_t> m_nbrIncoming; ///< Number of incoming entries
+        RingBuffer<Retired> m_retired;     ///< Links deleted once processed
+        std::vector<Message::Ptr> m_batch; ///< Batch reused by dispatch()
+        size_t m_directDepth;              ///< Number of nested direct calls
     };
 
     //! Global emit queue
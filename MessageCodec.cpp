@@ -0,0 +1,63 @@
+#include "MessageCodec.hpp"
+
+namespace MPO
+{
+    // The registries are never deleted, so that transports may decode
+    // until exit
+    std::vector<MessageCodec::Codec*>& MessageCodec::byType()
+    {
+        static std::vector<Codec*>* codecs = new std::vector<Codec*>();
+        return *codecs;
+    }
+
+    std::map<boost::uint64_t, MessageCodec::Codec*>& MessageCodec::byId()
+    {
+        static std::map<boost::uint64_t, Codec*>* codecs =
+            new std::map<boost::uint64_t, Codec*>();
+        return *codecs;
+    }
+
+    // Register or replace the codec of type
+    const MessageCodec::Codec& MessageCodec::add( const TypeDef& type,
+                                                  Encoder encode,
+                                                  Decoder decode,
+                                                  Viewer view )
+    {
+        boost::uint64_t id = wireId( type.name() );
+        std::map<boost::uint64_t, Codec*>::iterator it = byId().find( id );
+        if( it != byId().end() && it->second->type != &type )
+            throw std::runtime_error( "MessageCodec wire id of " + type.name() +
+                                      " already used by " +
+                                      it->second->type->name() );
+        std::vector<Codec*>& codecs = byType();
+        if( type.id() >= codecs.size() )
+            codecs.resize( type.id() + 1, nullptr );
+        Codec*& codec = codecs[type.id()];
+        if( !codec )
+            codec = byId()[id] = new Codec();
+        codec->type = &type;
+        codec->id = id;
+        codec->encode = encode;
+        codec->decode = decode;
+        codec->view = view;
+        return *codec;
+    }
+
+    const MessageCodec::Codec* MessageCodec::find( boost::uint64_t id )
+    {
+        std::map<boost::uint64_t, Codec*>::const_iterator it = byId().find( id );
+        return it == byId().end() ? nullptr : it->second;
+    }
+
+    // 64 bit FNV-1a hash
+    boost::uint64_t MessageCodec::wireId( const std::string& name )
+    {
+        boost::uint64_t hash = 14695981039346656037ULL;
+        for( size_t i = 0; i < name.size(); ++i )
+        {
+            hash ^= static_cast<unsigned char>( name[i] );
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+}
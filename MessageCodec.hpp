@@ -0,0 +1,189 @@
+#ifndef MESSAGECODEC_HPP
+#define MESSAGECODEC_HPP
+
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <boost/cstdint.hpp>
+#include <boost/static_assert.hpp>
+#include <boost/type_traits/has_trivial_copy.hpp>
+
+#include "Message.hpp"
+
+namespace MPO
+{
+
+/**
+    @brief Registry of the encoders and decoders of the Message types
+
+    The transports bridging Signals and Slots of distinct processes encode
+    the Message with the codec registered for their type. A Message type
+    is identified on the wire by the 64 bit FNV-1a hash of its TypeDef
+    name, since the dense TypeDef ids depend on the construction order of
+    the types in each process.
+
+    A Message type whose data is a trivially copyable member is registered
+    with addTrivial(), its encoding is then a single copy of the member.
+
+    @code
+        class Position : public Message
+        {
+        public:
+            struct Data { double x, y; } data;
+            ...
+        };
+        MessageCodec::addTrivial<Position, Position::Data, &Position::data>();
+    @endcode
+
+    The codecs must be registered before the transports are started, the
+    registry is then only read.
+*/
+class MessageCodec
+{
+public:
+    /**
+     * @brief Function encoding a Message
+     *
+     * The encoder writes the encoding in data if it fits in capacity, so
+     * that a call with a 0 capacity returns the size of the encoding.
+     *
+     * @param msg Message to encode, of the type of the codec
+     * @param data Buffer receiving the encoding
+     * @param capacity Size of the buffer
+     * @return the size of the encoding
+     */
+    typedef size_t (*Encoder)( const Message& msg, void* data, size_t capacity );
+
+    /**
+     * @brief Function decoding a Message
+     *
+     * @param data Encoding of the Message
+     * @param size Size of the encoding
+     * @return the decoded Message
+     * @throw std::runtime_error if the encoding is invalid
+     */
+    typedef Message::Ptr (*Decoder)( const void* data, size_t size );
+
+    /**
+     * @brief Function returning the encoding of a Message held in place
+     *
+     * A viewer lets the transports write the encoding directly from the
+     * Message with a scatter/gather write instead of copying it.
+     *
+     * @param msg Message to view, of the type of the codec
+     * @param size Set to the size of the encoding
+     * @return the encoding, valid while the Message isn't modified
+     */
+    typedef const void* (*Viewer)( const Message& msg, size_t& size );
+
+    /// Codec of a Message type
+    struct Codec
+    {
+        const TypeDef* type; ///< Encoded Message type
+        boost::uint64_t id;  ///< Wire id of the type
+        Encoder encode;      ///< Encoder of the type
+        Decoder decode;      ///< Decoder of the type
+        Viewer view;         ///< Viewer of the encoding or nullptr
+    };
+
+    /**
+     * @brief Register the codec of a Message type
+     *
+     * @param type TypeDef of the Message type
+     * @param encode Encoder of the type
+     * @param decode Decoder of the type
+     * @param view Viewer of the encoding or nullptr if none
+     * @return the registered codec
+     * @throw std::runtime_error if another type has the same wire id
+     */
+    static const Codec& add( const TypeDef& type, Encoder encode, Decoder decode,
+                             Viewer view = nullptr );
+
+    /**
+     * @brief Register a Message type encoded as a trivially copyable member
+     *
+     * The decoder default constructs the Message and copies the member,
+     * which is also the view of the encoding.
+     *
+     * @return the registered codec
+     */
+    template <class TMsg, class TData, TData TMsg::*TMember>
+    static const Codec& addTrivial()
+    {
+        BOOST_STATIC_ASSERT( boost::has_trivial_copy<TData>::value );
+        return add( TMsg::Type(), &encodeTrivial<TMsg, TData, TMember>,
+                    &decodeTrivial<TMsg, TData, TMember>,
+                    &viewTrivial<TMsg, TData, TMember> );
+    }
+
+    /**
+     * @brief Return the codec of a Message type
+     *
+     * @param type TypeDef of the Message type
+     * @return the codec or nullptr if none is registered for the type
+     */
+    static const Codec* find( const TypeDef& type )
+    {
+        const std::vector<Codec*>& codecs = byType();
+        return type.id() < codecs.size() ? codecs[type.id()] : nullptr;
+    }
+
+    /**
+     * @brief Return the codec of a wire id
+     *
+     * @param id Wire id of the Message type
+     * @return the codec or nullptr if none is registered for the id
+     */
+    static const Codec* find( boost::uint64_t id );
+
+    /**
+     * @brief Return the wire id of a type name
+     *
+     * @param name Name of the Message type
+     * @return the FNV-1a hash of the name
+     */
+    static boost::uint64_t wireId( const std::string& name );
+
+private:
+    /// Copy the member of the Message
+    template <class TMsg, class TData, TData TMsg::*TMember>
+    static size_t encodeTrivial( const Message& msg, void* data, size_t capacity )
+    {
+        if( capacity >= sizeof(TData) )
+            std::memcpy( data, &(static_cast<const TMsg&>( msg ).*TMember),
+                         sizeof(TData) );
+        return sizeof(TData);
+    }
+
+    /// Return the member of the Message
+    template <class TMsg, class TData, TData TMsg::*TMember>
+    static const void* viewTrivial( const Message& msg, size_t& size )
+    {
+        size = sizeof(TData);
+        return &(static_cast<const TMsg&>( msg ).*TMember);
+    }
+
+    /// Build a Message and copy its member
+    template <class TMsg, class TData, TData TMsg::*TMember>
+    static Message::Ptr decodeTrivial( const void* data, size_t size )
+    {
+        if( size != sizeof(TData) )
+            throw std::runtime_error( "MessageCodec invalid size of " +
+                                      TMsg::Type().name() );
+        typename TMsg::Ptr msg( new TMsg() );
+        std::memcpy( &(msg.get()->*TMember), data, sizeof(TData) );
+        return msg;
+    }
+
+    /// Return the codecs indexed by TypeDef id
+    static std::vector<Codec*>& byType();
+
+    /// Return the codecs indexed by wire id
+    static std::map<boost::uint64_t, Codec*>& byId();
+};
+
+} // namespace MPO
+
+#endif // MESSAGECODEC_HPP
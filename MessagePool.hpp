@@ -0,0 +1,372 @@
+#ifndef MESSAGEPOOL_HPP
+#define MESSAGEPOOL_HPP
+
+#include <cstddef>
+#include <new>
+#include <boost/config.hpp>
+#include <boost/static_assert.hpp>
+#include <boost/type_traits/alignment_of.hpp>
+#include <boost/atomic.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "Message.hpp"
+
+namespace MPO
+{
+
+/**
+    @brief Allocator recycling single element allocations in free lists
+
+    Each type T, rebound types included, has its own free lists shared by all
+    PoolAllocator<T> instances. Memory released by deallocate() is kept on a
+    free list and returned by the next allocate() call, so that once the
+    pool reached the number of live elements required by the application no
+    more memory is allocated.
+
+    Every thread keeps its own free list, used without any synchronization.
+    Once this list holds BatchSize elements it is set aside as a batch, and
+    a thread holding two batches gives one to a pool shared by all threads,
+    from which a thread whose list is empty takes a whole batch back. The
+    spin lock of the shared pool is thus taken once per BatchSize elements,
+    and the elements released by a consumer thread flow back to the
+    producer thread in batches. The free list of a thread is given to the
+    shared pool when the thread exits. Without C++11 thread_local storage
+    every element goes through the shared pool. Allocations of more than one
+    element bypass the pool.
+
+    The memory held by the free lists is kept until the process exits.
+*/
+template <class T>
+class PoolAllocator
+{
+public:
+    typedef T value_type;            ///< Allocated element type
+    typedef T* pointer;              ///< Pointer on element type
+    typedef const T* const_pointer;  ///< Const pointer on element type
+    typedef T& reference;            ///< Reference on element type
+    typedef const T& const_reference; ///< Const reference on element type
+    typedef std::size_t size_type;   ///< Size type
+    typedef std::ptrdiff_t difference_type; ///< Difference type
+
+    /// Number of elements moved at once between a thread and the shared pool
+    static const size_type BatchSize = 32;
+
+    /// Rebind the allocator to another element type
+    template <class U> struct rebind { typedef PoolAllocator<U> other; };
+
+    /// Default constructor
+    PoolAllocator() {}
+
+    /// Constructor from an allocator of another element type
+    template <class U> PoolAllocator( const PoolAllocator<U>& ) {}
+
+    /**
+     * @brief Allocate memory for n elements, from the free lists if n is 1
+     *
+     * @param n Number of elements to allocate
+     * @return pointer on the allocated memory
+     */
+    pointer allocate( size_type n, const void* = nullptr )
+    {
+        // The nodes allocated by ::operator new are only aligned for the
+        // fundamental types, an over-aligned element would be misaligned
+        BOOST_STATIC_ASSERT( boost::alignment_of<T>::value <=
+                             boost::alignment_of<Node>::value );
+        if( n != 1 )
+            return static_cast<pointer>( ::operator new( n * sizeof(T) ) );
+        Cache* c = cache();
+        Node* node = c ? c->free : nullptr;
+        if( !node )
+        {
+            if( c && c->full )
+            {
+                node = c->full;
+                c->full = nullptr;
+            }
+            else
+                node = pool().take();
+            if( !node )
+                return static_cast<pointer>( ::operator new( sizeof(Node) ) );
+            if( !c )
+            {
+                // Keep the rest of the batch in the shared pool
+                if( node->link.next )
+                    pool().give( node->link.next, node->link.size - 1 );
+                return reinterpret_cast<pointer>( node );
+            }
+            c->size = node->link.size;
+        }
+        c->free = node->link.next;
+        --c->size;
+        return reinterpret_cast<pointer>( node );
+    }
+
+    /**
+     * @brief Release memory allocated by allocate()
+     *
+     * @param ptr Pointer on the memory to release
+     * @param n Number of elements passed to allocate()
+     */
+    void deallocate( pointer ptr, size_type n )
+    {
+        if( n != 1 )
+        {
+            ::operator delete( ptr );
+            return;
+        }
+        Node* node = reinterpret_cast<Node*>( ptr );
+        Cache* c = cache();
+        if( !c )
+        {
+            node->link.next = nullptr;
+            pool().give( node, 1 );
+            return;
+        }
+        node->link.next = c->free;
+        c->free = node;
+        if( ++c->size == BatchSize )
+        {
+            if( c->full )
+                pool().give( c->full, BatchSize );
+            node->link.size = BatchSize;
+            c->full = node;
+            c->free = nullptr;
+            c->size = 0;
+        }
+    }
+
+    /// Construct a copy of value at ptr
+    void construct( pointer ptr, const T& value ) { new( ptr ) T( value ); }
+
+    /// Destroy the element at ptr
+    void destroy( pointer ptr ) { ptr->~T(); }
+
+    /// Return the maximum number of elements that may be allocated
+    size_type max_size() const { return size_type(-1) / sizeof(T); }
+
+    /// Return the address of value
+    pointer address( reference value ) const { return &value; }
+
+    /// Return the address of value
+    const_pointer address( const_reference value ) const { return &value; }
+
+private:
+    union Node;
+
+    /// Links of a free node
+    struct FreeLink
+    {
+        Node* next;      ///< Next free node of the batch
+        Node* nextBatch; ///< First node of the next batch of the shared pool
+        size_type size;  ///< Number of nodes of the batch starting here
+    };
+
+    /// Free list node stored in the released memory
+    union Node
+    {
+        FreeLink link;                    ///< Links while the node is free
+        char storage[sizeof(T)];          ///< Element storage
+        boost::long_long_type alignLong;  ///< Force long long alignment
+        long double alignDouble;          ///< Force long double alignment
+        void* alignPointer;               ///< Force pointer alignment
+    };
+
+    /// Batches of free nodes shared by all threads, protected by a spin lock
+    struct Pool
+    {
+        Pool() : batches( nullptr ), locked( false ) {}
+
+        /// Acquire the spin lock
+        void lock()
+        {
+            while( locked.exchange( true, boost::memory_order_acquire ) )
+                boost::this_thread::yield();
+        }
+
+        /// Release the spin lock
+        void unlock() { locked.store( false, boost::memory_order_release ); }
+
+        /// Return a batch of free nodes, or nullptr if there is none
+        Node* take()
+        {
+            lock();
+            Node* batch = batches;
+            if( batch )
+                batches = batch->link.nextBatch;
+            unlock();
+            return batch;
+        }
+
+        /// Add the batch of size nodes starting at batch
+        void give( Node* batch, size_type size )
+        {
+            batch->link.size = size;
+            lock();
+            batch->link.nextBatch = batches;
+            batches = batch;
+            unlock();
+        }
+
+        Node* batches;              ///< First batch of free nodes
+        boost::atomic<bool> locked; ///< Spin lock flag
+    };
+
+    /// Free nodes of a thread
+    struct Cache
+    {
+        Node* free;     ///< First free node of the thread
+        size_type size; ///< Number of nodes in free
+        Node* full;     ///< Batch of BatchSize nodes set aside, or nullptr
+        bool closed;    ///< Set once the thread exits
+    };
+
+    /// Give the Cache of the thread to the shared pool when the thread exits
+    struct CacheRelease
+    {
+        CacheRelease( Cache& cache ) : cache( cache ) {}
+
+        ~CacheRelease()
+        {
+            if( cache.free )
+                pool().give( cache.free, cache.size );
+            if( cache.full )
+                pool().give( cache.full, BatchSize );
+            cache.free = nullptr;
+            cache.full = nullptr;
+            cache.closed = true;
+        }
+
+        Cache& cache; ///< Cache given back
+    };
+
+    /// Return the Pool of the element type, never deleted so that elements
+    /// released during static destruction may still be recycled
+    static Pool& pool()
+    {
+        static Pool* p = new Pool();
+        return *p;
+    }
+
+    /// Return the Cache of the thread, or nullptr once the thread exits or
+    /// without thread local storage
+    static Cache* cache()
+    {
+#ifndef BOOST_NO_CXX11_THREAD_LOCAL
+        static thread_local Cache c;
+        static thread_local CacheRelease release( c );
+        return c.closed ? nullptr : &c;
+#else
+        return nullptr;
+#endif
+    }
+};
+
+/// All PoolAllocator instances share the same free lists
+template <class T, class U>
+bool operator==( const PoolAllocator<T>&, const PoolAllocator<U>& ) { return true; }
+
+/// All PoolAllocator instances share the same free lists
+template <class T, class U>
+bool operator!=( const PoolAllocator<T>&, const PoolAllocator<U>& ) { return false; }
+
+
+template <class TMsg, class TBase = Message>
+/*! @class PooledMessage  Base class of Message recycling their memory
+
+    A Message class deriving from PooledMessage is instantiated with its
+    static create() method. The Message and its shared_ptr control block are
+    then allocated by two PoolAllocator dedicated to the class, which
+    recycle the memory of released Message. They are allocated apart rather
+    than with boost::allocate_shared, which copies the shared_ptr it returns.
+    Producers creating many short lived Message thus don't call the global
+    memory allocator once the pool reached its working size.
+
+    @code
+        class Ball : public PooledMessage<Ball>
+        {
+        public:
+            typedef boost::shared_ptr<Ball> Ptr;
+            Ball( int count ) : count( count ) {}
+            ...
+        };
+
+        Ball::Ptr ball = Ball::create( 3 );
+        signal.emit( ball );
+    @endcode
+
+    The TBase template argument is the Message class to derive from, which
+    defaults to Message. The TypeDef of the class must still be defined
+    with TBase as parent class.
+
+    PooledMessage implements Message::clone() with the copy constructor of
+    the class, so that Message::mutate() copies a shared Message in the pool.
+
+    The reference count stays the atomic count of the shared_ptr, since a
+    Message may be released by any thread processing a queue it was
+    emitted in. A Message class with members aligned beyond the fundamental
+    types doesn't compile.
+*/
+class PooledMessage : public TBase
+{
+public:
+    /// Define the shared_ptr type on the Message class
+    typedef boost::shared_ptr<TMsg> Ptr;
+
+    /// Define the allocator of the Message class
+    typedef PoolAllocator<TMsg> Allocator;
+
+    /// Return a new Message built with its default constructor
+    static Ptr create()
+        { Memory m; return m.own( new( m.ptr ) TMsg() ); }
+
+    /// Return a new Message built with one constructor argument
+    template <class A1>
+    static Ptr create( const A1& a1 )
+        { Memory m; return m.own( new( m.ptr ) TMsg( a1 ) ); }
+
+    /// Return a new Message built with two constructor arguments
+    template <class A1, class A2>
+    static Ptr create( const A1& a1, const A2& a2 )
+        { Memory m; return m.own( new( m.ptr ) TMsg( a1, a2 ) ); }
+
+    /// Return a new Message built with three constructor arguments
+    template <class A1, class A2, class A3>
+    static Ptr create( const A1& a1, const A2& a2, const A3& a3 )
+        { Memory m; return m.own( new( m.ptr ) TMsg( a1, a2, a3 ) ); }
+
+    /// Return a pooled copy of the Message built with its copy constructor
+    virtual Message::Ptr clone() const
+        { return create( static_cast<const TMsg&>( *this ) ); }
+
+private:
+    /// Destroy a Message and give its memory back to the pool
+    struct Deleter
+    {
+        void operator()( TMsg* msg ) const
+        {
+            msg->~TMsg();
+            Allocator().deallocate( msg, 1 );
+        }
+    };
+
+    /// Memory of a Message under construction, released if it throws
+    struct Memory
+    {
+        Memory() : ptr( Allocator().allocate( 1 ) ) {}
+        ~Memory() { if( ptr ) Allocator().deallocate( ptr, 1 ); }
+
+        /// Return the shared_ptr owning the constructed Message
+        Ptr own( TMsg* msg )
+        {
+            ptr = nullptr;
+            return Ptr( msg, Deleter(), Allocator() );
+        }
+
+        TMsg* ptr; ///< Memory of the Message, until owned
+    };
+};
+
+} // namespace MPO
+
+#endif // MESSAGEPOOL_HPP
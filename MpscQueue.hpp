@@ -0,0 +1,169 @@
+#ifndef MPSCQUEUE_HPP
+#define MPSCQUEUE_HPP
+
+#include <boost/atomic.hpp>
+
+#include "Type.hpp"
+
+namespace MPO
+{
+
+/**
+    @brief Lock-free multiple producers single consumer FIFO queue
+
+    This is the node based queue described by Dmitry Vyukov. Any number of
+    threads may call push() concurrently while a single thread calls pop().
+    A push links its node with a single atomic exchange and never waits on
+    other producers or on the consumer.
+
+    The queue always holds a stub node. When an element is popped, the node
+    holding it becomes the new stub and the previous stub is recycled. The
+    consumer collects the recycled nodes and publishes them in a free list
+    whenever the list is empty. A producer takes the whole free list with
+    an atomic exchange, which is immune to ABA, keeps its first node and
+    gives the others back. A node is only allocated when the free list is
+    empty, so that the queue stops allocating once it holds as many nodes
+    as its peak length. The nodes are deleted with the queue.
+
+    A pop() may fail while a concurrent push() is in progress, even if other
+    elements were pushed after it. The element will be available as soon as
+    the producer completed its push().
+*/
+template <class T>
+class MpscQueue
+{
+public:
+    /// Constructor of an empty queue
+    MpscQueue() : m_head( new Node() ), m_free( nullptr ), m_recycled( nullptr )
+    {
+        m_tail = m_head.load( boost::memory_order_relaxed );
+    }
+
+    /// Destructor deleting the pending elements and the recycled nodes
+    ~MpscQueue()
+    {
+        T value;
+        while( pop( value ) );
+        deleteList( m_tail );
+        deleteList( m_recycled );
+        deleteList( m_free.load( boost::memory_order_acquire ) );
+    }
+
+    /**
+     * @brief Append value to the queue, may be called by any thread
+     *
+     * The element is exchanged with value using its swap() method, which
+     * leaves value default constructed.
+     *
+     * @param value Element to append
+     */
+    void push( T& value )
+    {
+        Node* node = m_free.exchange( nullptr, boost::memory_order_acquire );
+        if( node )
+        {
+            giveBack( node->next.load( boost::memory_order_relaxed ) );
+            node->next.store( nullptr, boost::memory_order_relaxed );
+        }
+        else
+            node = new Node();
+        node->value.swap( value );
+        Node* prev = m_head.exchange( node, boost::memory_order_acq_rel );
+        prev->next.store( node, boost::memory_order_release );
+    }
+
+    /**
+     * @brief Extract the front element, must only be called by the consumer
+     *
+     * The element is exchanged with value using its swap() method.
+     *
+     * @param[out] value Element extracted from the queue
+     * @return false if no element could be extracted
+     */
+    bool pop( T& value )
+    {
+        Node* tail = m_tail;
+        Node* next = tail->next.load( boost::memory_order_acquire );
+        if( next == nullptr )
+            return false;
+        value.swap( next->value );
+        m_tail = next;
+        // The stub holds the previous content of value, cleared so that
+        // a push leaves its value default constructed
+        T cleared;
+        tail->value.swap( cleared );
+        tail->next.store( m_recycled, boost::memory_order_relaxed );
+        m_recycled = tail;
+        Node* empty = nullptr;
+        if( m_free.load( boost::memory_order_relaxed ) == nullptr &&
+                m_free.compare_exchange_strong( empty, m_recycled,
+                                                boost::memory_order_release,
+                                                boost::memory_order_relaxed ) )
+            m_recycled = nullptr;
+        return true;
+    }
+
+private:
+    /// Queue node holding an element
+    struct Node
+    {
+        Node() : next( nullptr ) {}
+
+        boost::atomic<Node*> next; ///< Next node in the queue
+        T value;                   ///< Element held by the node
+    };
+
+    /**
+     * @brief Push back the rest of a free list taken by a producer
+     *
+     * The list is set as the free list if it is still empty, it is only
+     * walked to append the current free list in the rare case another
+     * producer or the consumer filled it meanwhile.
+     *
+     * @param list First node of the list or nullptr
+     */
+    void giveBack( Node* list )
+    {
+        if( !list )
+            return;
+        Node* head = nullptr;
+        if( m_free.compare_exchange_strong( head, list,
+                                            boost::memory_order_release,
+                                            boost::memory_order_relaxed ) )
+            return;
+        Node* last = list;
+        while( Node* next = last->next.load( boost::memory_order_relaxed ) )
+            last = next;
+        do
+            last->next.store( head, boost::memory_order_relaxed );
+        while( !m_free.compare_exchange_weak( head, list,
+                                              boost::memory_order_release,
+                                              boost::memory_order_relaxed ) );
+    }
+
+    /// Delete a list of nodes
+    static void deleteList( Node* node )
+    {
+        while( node )
+        {
+            Node* next = node->next.load( boost::memory_order_relaxed );
+            delete node;
+            node = next;
+        }
+    }
+
+    // Non copyable
+    MpscQueue( const MpscQueue& );
+    MpscQueue& operator=( const MpscQueue& );
+
+    boost::atomic<Node*> m_head; ///< Last pushed node, updated by producers
+    char m_padding[64];          ///< Keep m_tail out of producers cache line
+    Node* m_tail;                ///< Stub node, only accessed by consumer
+    char m_freePadding[64];      ///< Keep m_free out of the m_tail cache line
+    boost::atomic<Node*> m_free; ///< Recycled nodes taken by the producers
+    Node* m_recycled;            ///< Recycled nodes kept by the consumer
+};
+
+} // namespace MPO
+
+#endif // MPSCQUEUE_HPP
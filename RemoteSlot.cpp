@@ -0,0 +1,32 @@
+#include "RemoteSlot.hpp"
+
+namespace MPO
+{
+    RemoteSlot::RemoteSlot( Sink& sink, boost::uint32_t route,
+                            const std::string& remoteName ) :
+        AnySlot( Message::Type() ), m_sink( sink ), m_route( route ),
+        m_remoteName( remoteName ), m_lastType( nullptr ), m_lastCodec( nullptr )
+    {
+        m_dynamicCastFunction = Function( &RemoteSlot::forward, this );
+        m_staticCastFunction = m_dynamicCastFunction;
+    }
+
+    // Look up the codec, cached for runs of Message of the same type
+    void RemoteSlot::forward( void* obj, Message::Ptr& msg, Link* )
+    {
+        if( !msg )
+            return;
+        RemoteSlot* slot = static_cast<RemoteSlot*>( obj );
+        const TypeDef* type = &msg->type();
+        if( type != slot->m_lastType )
+        {
+            const MessageCodec::Codec* codec = MessageCodec::find( *type );
+            if( !codec )
+                throw std::runtime_error( "RemoteSlot has no codec for " +
+                                          type->name() );
+            slot->m_lastType = type;
+            slot->m_lastCodec = codec;
+        }
+        slot->m_sink.send( slot->m_route, msg, *slot->m_lastCodec );
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef REMOTESLOT_HPP
+#define REMOTESLOT_HPP
+
+#include <string>
+#include <boost/cstdint.hpp>
+
+#include "Slot.hpp"
+#include "MessageCodec.hpp"
+
+namespace MPO
+{
+
+/**
+    @brief Slot forwarding the received Message to a Slot of another process
+
+    A RemoteSlot stands for a named Slot of a remote process. It accepts any
+    Message and hands it over with its codec to the Sink of a transport,
+    which writes it through the route of the remote Slot. The transports
+    create their RemoteSlots when a local Signal is bridged to a remote
+    Slot, the Signal is connected to the RemoteSlot with a regular Link.
+*/
+class RemoteSlot : public AnySlot
+{
+public:
+    /// Transport writing the Message of its RemoteSlots
+    class Sink
+    {
+    public:
+        /**
+         * @brief Write a Message through a route
+         *
+         * @param route Route of the remote Slot
+         * @param msg Message to write, which the Sink may keep until written
+         * @param codec Codec of the Message type
+         */
+        virtual void send( boost::uint32_t route, const Message::Ptr& msg,
+                           const MessageCodec::Codec& codec ) = 0;
+
+    protected:
+        ~Sink() {}
+    };
+
+    /**
+     * @brief Constructor of the RemoteSlot of a route
+     *
+     * @param sink Transport writing the Message
+     * @param route Route of the remote Slot in the transport
+     * @param remoteName Name of the Slot in the remote process
+     */
+    RemoteSlot( Sink& sink, boost::uint32_t route, const std::string& remoteName );
+
+    /**
+     * @brief Return the route of the remote Slot
+     *
+     * @return the route id
+     */
+    boost::uint32_t route() const { return m_route; }
+
+    /**
+     * @brief Return the name of the Slot in the remote process
+     *
+     * @return the remote Slot name
+     */
+    const std::string& remoteName() const { return m_remoteName; }
+
+private:
+    /// Thunk sending the Message to the Sink
+    static void forward( void* slot, Message::Ptr& msg, Link* link );
+
+    Sink& m_sink;                          ///< Transport of the Message
+    boost::uint32_t m_route;               ///< Route of the remote Slot
+    std::string m_remoteName;              ///< Name of the remote Slot
+    const TypeDef* m_lastType;             ///< Type of the last Message
+    const MessageCodec::Codec* m_lastCodec; ///< Codec of m_lastType
+};
+
+} // namespace MPO
+
+#endif // REMOTESLOT_HPP
@@ -0,0 +1,153 @@
+#ifndef RINGBUFFER_HPP
+#define RINGBUFFER_HPP
+
+#include <vector>
+#include <cstddef>
+
+namespace MPO
+{
+
+/**
+    @brief Growable FIFO ring buffer stored in a contiguous array
+
+    The RingBuffer keeps its elements in a single std::vector whose size is
+    always a power of two. Elements are addressed by an absolute sequence
+    number masked with the capacity, so pushing and popping never allocate
+    once the buffer reached the size required by the application. The
+    capacity is only doubled when a new element is pushed on a full buffer
+    and is never shrunk, so it is reused across bursts.
+
+    Popped slots are reset to a default constructed element so that the
+    resources held by the element (i.e. a Message shared_ptr) are released
+    when the element leaves the queue.
+*/
+template <class T>
+class RingBuffer
+{
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param capacity Initial capacity rounded up to a power of two
+     */
+    explicit RingBuffer( size_t capacity = 16 ) : m_head(0), m_tail(0)
+    {
+        size_t n = 1;
+        while( n < capacity )
+            n <<= 1;
+        m_buffer.resize( n );
+        m_mask = n - 1;
+    }
+
+    /**
+     * @brief Return true if the buffer is empty
+     *
+     * @return true if the buffer is empty
+     */
+    bool empty() const { return m_head == m_tail; }
+
+    /**
+     * @brief Return the number of elements in the buffer
+     *
+     * @return the number of elements in the buffer
+     */
+    size_t size() const { return m_tail - m_head; }
+
+    /**
+     * @brief Return the number of elements the buffer may hold without growing
+     *
+     * @return the capacity of the buffer
+     */
+    size_t capacity() const { return m_buffer.size(); }
+
+    /**
+     * @brief Return the sequence number of the front element
+     *
+     * Each pushed element gets the sequence number following the one of
+     * the previously pushed element, so that elements pushed before a given
+     * tail() are all popped once head() reached it.
+     *
+     * @return the sequence number of the front element
+     */
+    size_t head() const { return m_head; }
+
+    /**
+     * @brief Return the sequence number the next pushed element will get
+     *
+     * @return the sequence number past the back element
+     */
+    size_t tail() const { return m_tail; }
+
+    /**
+     * @brief Append a copy of value at the back of the buffer
+     *
+     * @param value Element to append
+     */
+    void push_back( const T& value )
+    {
+        if( size() == capacity() )
+            grow();
+        m_buffer[m_tail++ & m_mask] = value;
+    }
+
+    /**
+     * @brief Return a reference on the element at the front of the buffer
+     *
+     * The buffer must not be empty.
+     *
+     * @return a reference on the front element
+     */
+    T& front() { return m_buffer[m_head & m_mask]; }
+
+    /// Remove the front element by resetting it to a default value
+    void pop_front() { m_buffer[m_head++ & m_mask] = T(); }
+
+    /**
+     * @brief Return a reference on the i-th element counted from the front
+     *
+     * @param i Index of the element, must be smaller than size()
+     * @return a reference on the element
+     */
+    T& operator[]( size_t i ) { return m_buffer[(m_head + i) & m_mask]; }
+
+    /**
+     * @brief Return a const reference on the i-th element counted from the front
+     *
+     * @param i Index of the element, must be smaller than size()
+     * @return a const reference on the element
+     */
+    const T& operator[]( size_t i ) const
+        { return m_buffer[(m_head + i) & m_mask]; }
+
+    /**
+     * @brief Grow the buffer so that it may hold n elements without growing
+     *
+     * @param n Number of elements the buffer must be able to hold
+     */
+    void reserve( size_t n )
+    {
+        while( capacity() < n )
+            grow();
+    }
+
+private:
+    /// Double the capacity preserving the sequence number of the elements
+    void grow()
+    {
+        std::vector<T> buffer( m_buffer.size() * 2 );
+        size_t mask = buffer.size() - 1;
+        for( size_t seq = m_head; seq != m_tail; ++seq )
+            buffer[seq & mask] = m_buffer[seq & m_mask];
+        m_buffer.swap( buffer );
+        m_mask = mask;
+    }
+
+    std::vector<T> m_buffer; ///< Element storage with power of two size
+    size_t m_mask;           ///< Capacity minus one
+    size_t m_head;           ///< Sequence number of the front element
+    size_t m_tail;           ///< Sequence number past the back element
+};
+
+} // namespace MPO
+
+#endif // RINGBUFFER_HPP
@@ -0,0 +1,166 @@
+#include <boost/bind.hpp>
+
+#include "Scheduler.hpp"
+#include "Action.hpp"
+
+namespace MPO
+{
+    // Constructor of a stopped Scheduler
+    Scheduler::Scheduler( size_t nbrWorkers, size_t batchSize ) :
+        m_batchSize(batchSize), m_nbrActive(0), m_nbrQueued(0),
+        m_nbrSleeping(0), m_nextWorker(0), m_stop(true),
+        m_current(&Scheduler::keepWorker)
+    {
+        for( size_t i = 0; i < nbrWorkers; ++i )
+            m_workers.push_back( new Worker() );
+    }
+
+    // Destructor stopping the workers and deleting the owned Domains once
+    // their Actions moved to the main Domain. The Message emitted while the
+    // owned Domains are drained are queued in the main Domain
+    Scheduler::~Scheduler()
+    {
+        stop();
+        for( size_t i = 0; i < m_actions.size(); ++i )
+            if( Action::Ptr action = m_actions[i].lock() )
+                action->setDomain( Domain::main() );
+        for( size_t i = 0; i < m_domains.size(); ++i )
+        {
+            m_domains[i]->setMessageNotifier( 0 );
+            while( m_domains[i]->processNext() ) {}
+        }
+        for( size_t i = 0; i < m_units.size(); ++i )
+        {
+            m_units[i]->domain->setMessageNotifier( 0 );
+            delete m_units[i];
+        }
+        for( size_t i = 0; i < m_domains.size(); ++i )
+            delete m_domains[i];
+        for( size_t i = 0; i < m_workers.size(); ++i )
+            delete m_workers[i];
+    }
+
+    // Add a Domain whose notifier schedules it
+    void Scheduler::add( Domain& domain )
+    {
+        Unit* unit = new Unit( domain );
+        m_units.push_back( unit );
+        domain.setMessageNotifier( boost::bind( &Scheduler::schedule, this, unit ) );
+        if( !domain.empty() )
+            schedule( unit );
+    }
+
+    // Assign the action to a new Domain processed by the Scheduler
+    void Scheduler::add( Action& action )
+    {
+        Domain* domain = new Domain();
+        m_domains.push_back( domain );
+        m_actions.push_back( action.getPtr() );
+        action.setDomain( *domain );
+        add( *domain );
+    }
+
+    // Start the worker threads
+    void Scheduler::start()
+    {
+        if( !m_stop )
+            return;
+        m_stop = false;
+        for( size_t i = 0; i < m_workers.size(); ++i )
+            m_threads.create_thread( boost::bind( &Scheduler::run, this, i ) );
+    }
+
+    // Stop the worker threads
+    void Scheduler::stop()
+    {
+        {
+            boost::lock_guard<boost::mutex> lock( m_sleepMutex );
+            m_stop = true;
+        }
+        m_wakeUp.notify_all();
+        m_threads.join_all();
+    }
+
+    // Wait until no Unit is queued or running
+    void Scheduler::waitIdle() const
+    {
+        while( m_nbrActive.load() != 0 )
+            boost::this_thread::yield();
+    }
+
+    // Queue the unit in the current worker deque or in the next worker deque
+    void Scheduler::schedule( Unit* unit )
+    {
+        // Order the Message queuing before the test of the flag
+        boost::atomic_thread_fence( boost::memory_order_seq_cst );
+        if( unit->scheduled.exchange( true ) )
+            return;
+        ++m_nbrActive;
+        Worker* worker = m_current.get();
+        if( !worker )
+            worker = m_workers[m_nextWorker++ % m_workers.size()];
+        {
+            boost::lock_guard<boost::mutex> lock( worker->mutex );
+            worker->deque.push_back( unit );
+        }
+        ++m_nbrQueued;
+        if( m_nbrSleeping.load() != 0 )
+        {
+            boost::lock_guard<boost::mutex> lock( m_sleepMutex );
+            m_wakeUp.notify_one();
+        }
+    }
+
+    // Pop from the back of the own deque or steal from the front of another
+    Scheduler::Unit* Scheduler::next( size_t i )
+    {
+        for( size_t n = 0; n < m_workers.size(); ++n )
+        {
+            Worker* worker = m_workers[(i + n) % m_workers.size()];
+            boost::lock_guard<boost::mutex> lock( worker->mutex );
+            if( worker->deque.empty() )
+                continue;
+            Unit* unit;
+            if( n == 0 )
+            {
+                unit = worker->deque.back();
+                worker->deque.pop_back();
+            }
+            else
+            {
+                unit = worker->deque.front();
+                worker->deque.pop_front();
+            }
+            --m_nbrQueued;
+            return unit;
+        }
+        return nullptr;
+    }
+
+    // Process scheduled units until stopped
+    void Scheduler::run( size_t i )
+    {
+        m_current.reset( m_workers[i] );
+        while( !m_stop.load() )
+        {
+            Unit* unit = next( i );
+            if( !unit )
+            {
+                boost::unique_lock<boost::mutex> lock( m_sleepMutex );
+                ++m_nbrSleeping;
+                while( m_nbrQueued.load() == 0 && !m_stop.load() )
+                    m_wakeUp.wait( lock );
+                --m_nbrSleeping;
+                continue;
+            }
+            unit->domain->processBatch( m_batchSize );
+            // Clear the flag before checking for Message queued in between
+            unit->scheduled.store( false );
+            boost::atomic_thread_fence( boost::memory_order_seq_cst );
+            if( !unit->domain->empty() )
+                schedule( unit );
+            --m_nbrActive;
+        }
+        m_current.release();
+    }
+}
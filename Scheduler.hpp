@@ -0,0 +1,154 @@
+#ifndef SCHEDULER_HPP
+#define SCHEDULER_HPP
+
+#include <deque>
+#include <vector>
+#include <boost/atomic.hpp>
+#include <boost/thread.hpp>
+#include <boost/weak_ptr.hpp>
+
+#include "Domain.hpp"
+
+namespace MPO
+{
+
+class Action;
+
+/**
+    @brief Work stealing scheduler processing Domains on a pool of threads
+
+    The Scheduler runs the Message queue of the Domains added to it on a
+    pool of worker threads. A Domain is never processed by two threads at
+    the same time, so that the Slot methods of the Signals and Slots
+    belonging to a Domain are never executed concurrently. Adding an Action
+    to the Scheduler assigns it to its own Domain, which preserves the
+    single threaded semantic of the Action code while independent Actions
+    are processed in parallel.
+
+    A Domain is scheduled when a Message is queued in it. It is then pushed
+    in the deque of the worker thread that queued the Message, or in the
+    deque of a worker selected in turn when queued by another thread. Each
+    worker processes up to batchSize Message of the Domain it pops from the
+    back of its deque, and reschedules the Domain if Message are still
+    pending. An idle worker steals Domains from the front of the deques of
+    the other workers, and sleeps when there is no work left.
+
+    @code
+        Scheduler scheduler( 4 );
+        scheduler.add( *ping );
+        scheduler.add( *pong );
+        scheduler.start();
+
+        // Message emitted by Signals of the main Domain go through channels
+        start.emit( ball );
+        scheduler.waitIdle();
+    @endcode
+
+    The Domain rules apply to the scheduled Domains. In addition, Domains
+    and Actions may only be added while the Scheduler is stopped, and the
+    message notifier of a scheduled Domain is owned by the Scheduler.
+
+    Destroying the Scheduler assigns the Actions it added, which are still
+    alive, back to the main Domain before deleting their Domains. It must
+    thus be destroyed by the thread processing the main Domain. Only these
+    Actions may belong to the Domains owned by the Scheduler.
+*/
+class Scheduler
+{
+public:
+    /**
+     * @brief Constructor of a stopped Scheduler
+     *
+     * @param nbrWorkers Number of worker threads
+     * @param batchSize Number of Message processed each time a Domain runs
+     */
+    explicit Scheduler( size_t nbrWorkers, size_t batchSize = 64 );
+
+    /**
+     * @brief Destructor stopping the worker threads and deleting the owned
+     *        Domains
+     *
+     * The added Actions are assigned to the main Domain, then the Message
+     * pending in their previous Domains are processed by the calling thread,
+     * so that no Signal, Slot or Link refers to a deleted Domain.
+     */
+    ~Scheduler();
+
+    /**
+     * @brief Add a Domain to be processed by the Scheduler
+     *
+     * @param domain Domain to process
+     */
+    void add( Domain& domain );
+
+    /**
+     * @brief Assign the Action to a new Domain processed by the Scheduler
+     *
+     * The Domain is owned by the Scheduler, which assigns the Action back
+     * to the main Domain when destroyed.
+     *
+     * @param action Action whose Slot methods are executed by the workers
+     */
+    void add( Action& action );
+
+    /// Start the worker threads
+    void start();
+
+    /// Stop the worker threads once they completed their current run
+    void stop();
+
+    /// Wait until no scheduled Domain has pending Message
+    void waitIdle() const;
+
+private:
+    /// Scheduling state of a Domain
+    struct Unit
+    {
+        explicit Unit( Domain& domain ) : domain( &domain ), scheduled( false ) {}
+
+        Domain* domain;               ///< Domain to process
+        boost::atomic<bool> scheduled; ///< True while queued or running
+    };
+
+    /// Worker thread and its deque of scheduled Units
+    struct Worker
+    {
+        boost::mutex mutex;     ///< Mutex protecting the deque
+        std::deque<Unit*> deque; ///< Units scheduled on the worker
+    };
+
+    /// Cleanup function of m_current which doesn't own the Worker
+    static void keepWorker( Worker* ) {}
+
+    /// Queue the unit in a deque if it is not already scheduled
+    void schedule( Unit* unit );
+
+    /// Pop a Unit from the deque of worker i or steal one from another worker
+    Unit* next( size_t i );
+
+    /// Process scheduled Units until the Scheduler is stopped
+    void run( size_t i );
+
+    // Non copyable
+    Scheduler( const Scheduler& );
+    Scheduler& operator=( const Scheduler& );
+
+    size_t m_batchSize;                ///< Message processed per run
+    std::vector<Worker*> m_workers;    ///< Workers and their deques
+    std::vector<Unit*> m_units;        ///< Scheduled Domains
+    std::vector<Domain*> m_domains;    ///< Domains owned by the Scheduler
+    std::vector< boost::weak_ptr<Action> > m_actions; ///< Actions of m_domains
+    boost::thread_group m_threads;     ///< Worker threads
+    boost::atomic<size_t> m_nbrActive; ///< Units queued or running
+    boost::atomic<size_t> m_nbrQueued; ///< Units queued in a deque
+    boost::atomic<size_t> m_nbrSleeping; ///< Workers waiting for work
+    boost::atomic<size_t> m_nextWorker; ///< Worker for external schedules
+    boost::atomic<bool> m_stop;        ///< True when workers must stop
+    boost::mutex m_sleepMutex;         ///< Mutex of the sleep condition
+    boost::condition_variable m_wakeUp; ///< Condition waking up workers
+    boost::thread_specific_ptr<Worker> m_current; ///< Worker of the thread
+};
+
+} // namespace MPO
+
+#endif // SCHEDULER_HPP
@@ -0,0 +1,215 @@
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define MPO_HAS_SHM
+#endif
+
+#include "ShmRing.hpp"
+
+namespace MPO
+{
+    // Header of the segment, the positions on their own cache lines
+    struct ShmRing::Header
+    {
+        char magic[8];                          ///< "MPOSHMR1" once built
+        boost::uint64_t capacity;               ///< Size of the ring
+        char pad0[48];
+        boost::atomic<boost::uint64_t> written; ///< Producer position
+        char pad1[56];
+        boost::atomic<boost::uint64_t> read;    ///< Consumer position
+        char pad2[56];
+    };
+
+    const boost::uint32_t ShmRing::PaddingRoute;
+
+    namespace
+    {
+        const char magic[8] = { 'M', 'P', 'O', 'S', 'H', 'M', 'R', '1' };
+
+        // Size of a record, its payload padded to 16 bytes
+        size_t recordSize( size_t size )
+        {
+            return sizeof(ShmRing::Record) + ( ( size + 15 ) & ~size_t(15) );
+        }
+    }
+
+    // Create the segment and build its header, the magic written last
+    ShmRing::ShmRing( const std::string& name, size_t capacity ) :
+        m_name( name ), m_owner( true ), m_header( nullptr ), m_data( nullptr ),
+        m_size( 0 ), m_capacity( 64 ), m_position( 0 ), m_reserved( 0 ),
+        m_limit( 0 )
+    {
+        while( m_capacity < capacity )
+            m_capacity <<= 1;
+#ifdef MPO_HAS_SHM
+        shm_unlink( name.c_str() );
+        int fd = shm_open( name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600 );
+        if( fd < 0 )
+            throw std::runtime_error( "ShmRing can't create " + name );
+        if( ftruncate( fd, off_t( sizeof(Header) + m_capacity ) ) != 0 )
+        {
+            close( fd );
+            shm_unlink( name.c_str() );
+            throw std::runtime_error( "ShmRing can't size " + name );
+        }
+        map( fd, sizeof(Header) + m_capacity );
+        new( m_header ) Header();
+        m_header->capacity = m_capacity;
+        m_header->written.store( 0, boost::memory_order_relaxed );
+        m_header->read.store( 0, boost::memory_order_relaxed );
+        boost::atomic_thread_fence( boost::memory_order_release );
+        std::memcpy( m_header->magic, magic, sizeof(magic) );
+#else
+        throw std::runtime_error( "ShmRing requires POSIX shared memory" );
+#endif
+    }
+
+    // Open the segment and check its header
+    ShmRing::ShmRing( const std::string& name ) :
+        m_name( name ), m_owner( false ), m_header( nullptr ), m_data( nullptr ),
+        m_size( 0 ), m_capacity( 0 ), m_position( 0 ), m_reserved( 0 ),
+        m_limit( 0 )
+    {
+#ifdef MPO_HAS_SHM
+        int fd = shm_open( name.c_str(), O_RDWR, 0600 );
+        if( fd < 0 )
+            throw std::runtime_error( "ShmRing can't open " + name );
+        struct stat st;
+        if( fstat( fd, &st ) != 0 || size_t( st.st_size ) <= sizeof(Header) )
+        {
+            close( fd );
+            throw std::runtime_error( "ShmRing invalid segment " + name );
+        }
+        map( fd, size_t( st.st_size ) );
+        bool valid = std::memcmp( m_header->magic, magic, sizeof(magic) ) == 0;
+        boost::atomic_thread_fence( boost::memory_order_acquire );
+        m_capacity = size_t( m_header->capacity );
+        if( !valid || sizeof(Header) + m_capacity != m_size )
+        {
+            munmap( m_header, m_size );
+            throw std::runtime_error( "ShmRing invalid segment " + name );
+        }
+        m_position = m_header->read.load( boost::memory_order_relaxed );
+        m_limit = m_header->written.load( boost::memory_order_acquire );
+#else
+        throw std::runtime_error( "ShmRing requires POSIX shared memory" );
+#endif
+    }
+
+    ShmRing::~ShmRing()
+    {
+#ifdef MPO_HAS_SHM
+        munmap( m_header, m_size );
+        if( m_owner )
+            shm_unlink( m_name.c_str() );
+#endif
+    }
+
+    // Map the segment shared, the atomics must be address free
+    void ShmRing::map( int fd, size_t size )
+    {
+#ifdef MPO_HAS_SHM
+        void* p = mmap( nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+        close( fd );
+        if( p == MAP_FAILED )
+        {
+            if( m_owner )
+                shm_unlink( m_name.c_str() );
+            throw std::runtime_error( "ShmRing can't map " + m_name );
+        }
+        m_header = static_cast<Header*>( p );
+        m_data = static_cast<char*>( p ) + sizeof(Header);
+        m_size = size;
+        if( !m_header->written.is_lock_free() )
+        {
+            munmap( p, size );
+            if( m_owner )
+                shm_unlink( m_name.c_str() );
+            throw std::runtime_error( "ShmRing requires lock-free 64 bit atomics" );
+        }
+#else
+        (void)fd;
+        (void)size;
+#endif
+    }
+
+    ShmRing::Record* ShmRing::at( boost::uint64_t position ) const
+    {
+        return reinterpret_cast<Record*>( m_data + ( position & ( m_capacity - 1 ) ) );
+    }
+
+    // Return true if n bytes are free at the write position
+    bool ShmRing::writable( size_t n )
+    {
+        if( m_position + n - m_limit <= m_capacity )
+            return true;
+        m_limit = m_header->read.load( boost::memory_order_acquire );
+        return m_position + n - m_limit <= m_capacity;
+    }
+
+    // Publish a padding record at the end of the ring if the record
+    // doesn't fit before it, the record then starts the ring
+    void* ShmRing::reserve( size_t size )
+    {
+        if( size > maxPayload() )
+            throw std::runtime_error( "ShmRing record too large for " + m_name );
+        size_t need = recordSize( size );
+        size_t room = m_capacity - size_t( m_position & ( m_capacity - 1 ) );
+        if( need > room )
+        {
+            if( !writable( room ) )
+                return nullptr;
+            Record* padding = at( m_position );
+            padding->size = boost::uint32_t( room - sizeof(Record) );
+            padding->route = PaddingRoute;
+            padding->type = 0;
+            m_position += room;
+            m_header->written.store( m_position, boost::memory_order_release );
+        }
+        if( !writable( need ) )
+            return nullptr;
+        m_reserved = m_position;
+        return at( m_reserved ) + 1;
+    }
+
+    void ShmRing::commit( boost::uint32_t route, boost::uint64_t type, size_t size )
+    {
+        Record* record = at( m_reserved );
+        record->size = boost::uint32_t( size );
+        record->route = route;
+        record->type = type;
+        m_position = m_reserved + recordSize( size );
+        m_header->written.store( m_position, boost::memory_order_release );
+    }
+
+    // Skip the padding records
+    const ShmRing::Record* ShmRing::peek()
+    {
+        for( ;; )
+        {
+            if( m_position == m_limit )
+            {
+                m_limit = m_header->written.load( boost::memory_order_acquire );
+                if( m_position == m_limit )
+                    return nullptr;
+            }
+            const Record* record = at( m_position );
+            if( record->route != PaddingRoute )
+                return record;
+            m_position += recordSize( record->size );
+            m_header->read.store( m_position, boost::memory_order_release );
+        }
+    }
+
+    void ShmRing::release()
+    {
+        m_position += recordSize( at( m_position )->size );
+        m_header->read.store( m_position, boost::memory_order_release );
+    }
+}
@@ -0,0 +1,144 @@
+#ifndef SHMRING_HPP
+#define SHMRING_HPP
+
+#include <string>
+#include <boost/cstdint.hpp>
+#include <boost/atomic.hpp>
+
+#include "Type.hpp"
+
+namespace MPO
+{
+
+/**
+    @brief Lock-free single producer single consumer ring of records in a
+           POSIX shared memory segment
+
+    The producer process creates the named segment, the consumer process
+    opens it. A record is a 16 byte header followed by its payload, padded
+    to 16 bytes. The write and read positions are 64 bit atomic counters in
+    the segment, so that neither side makes a system call per record: the
+    consumer polls the ring.
+
+    The producer reserves the space of a record, writes its payload in
+    place and commits it. A record that doesn't fit before the end of the
+    ring is preceded by a padding record and written at its start, so that
+    the payloads are contiguous.
+*/
+class ShmRing
+{
+public:
+    /// Header of a record
+    struct Record
+    {
+        boost::uint32_t size;  ///< Size of the payload
+        boost::uint32_t route; ///< Route of the record
+        boost::uint64_t type;  ///< Wire id of the payload type
+
+        /// Return the payload following the header
+        const void* payload() const { return this + 1; }
+    };
+
+    /// Route of the padding records, skipped by peek()
+    static const boost::uint32_t PaddingRoute = 0xffffffff;
+
+    /**
+     * @brief Constructor creating the segment, replacing an existing one
+     *
+     * @param name Name of the segment, starting with a '/'
+     * @param capacity Size of the ring in bytes, rounded up to a power of 2
+     * @throw std::runtime_error if the segment can't be created
+     */
+    ShmRing( const std::string& name, size_t capacity );
+
+    /**
+     * @brief Constructor opening the segment created by the producer
+     *
+     * @param name Name of the segment
+     * @throw std::runtime_error if the segment doesn't exist or is invalid
+     */
+    explicit ShmRing( const std::string& name );
+
+    /// Destructor unmapping the segment, removed by its creator
+    ~ShmRing();
+
+    /**
+     * @brief Reserve the space of a record, called by the producer
+     *
+     * @param size Size of the payload
+     * @return the payload of the record or nullptr if the ring is full
+     * @throw std::runtime_error if the record exceeds maxPayload()
+     */
+    void* reserve( size_t size );
+
+    /**
+     * @brief Publish the reserved record, called by the producer
+     *
+     * @param route Route of the record
+     * @param type Wire id of the payload type
+     * @param size Size of the payload, at most the reserved size
+     */
+    void commit( boost::uint32_t route, boost::uint64_t type, size_t size );
+
+    /**
+     * @brief Return the oldest record, called by the consumer
+     *
+     * @return the record or nullptr if the ring is empty
+     */
+    const Record* peek();
+
+    /// Release the record returned by peek(), called by the consumer
+    void release();
+
+    /**
+     * @brief Return the size of the ring
+     *
+     * @return the capacity in bytes
+     */
+    size_t capacity() const { return m_capacity; }
+
+    /**
+     * @brief Return the largest payload of a record
+     *
+     * @return the maximum payload size, half the capacity minus a header
+     */
+    size_t maxPayload() const { return m_capacity / 2 - sizeof(Record); }
+
+    /**
+     * @brief Return the name of the segment
+     *
+     * @return the segment name
+     */
+    const std::string& name() const { return m_name; }
+
+    /// Header of the segment, defined in ShmRing.cpp
+    struct Header;
+
+private:
+    /// Return the record at position
+    Record* at( boost::uint64_t position ) const;
+
+    /// Return true if n bytes are free at the write position
+    bool writable( size_t n );
+
+    /// Map the segment of fd, of size bytes
+    void map( int fd, size_t size );
+
+    // Non copyable
+    ShmRing( const ShmRing& );
+    ShmRing& operator=( const ShmRing& );
+
+    std::string m_name;         ///< Name of the segment
+    bool m_owner;               ///< True if the segment was created
+    Header* m_header;           ///< Mapped segment
+    char* m_data;               ///< First byte of the ring
+    size_t m_size;              ///< Size of the mapping
+    size_t m_capacity;          ///< Size of the ring
+    boost::uint64_t m_position; ///< Write or read position of this side
+    boost::uint64_t m_reserved; ///< Position of the reserved record
+    boost::uint64_t m_limit;    ///< Last read position of the other side
+};
+
+} // namespace MPO
+
+#endif // SHMRING_HPP
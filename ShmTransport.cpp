@@ -0,0 +1,132 @@
+#include <cstring>
+#include <boost/thread/thread.hpp>
+
+#include "ShmTransport.hpp"
+#include "Link.hpp"
+
+namespace MPO
+{
+    const boost::uint32_t ShmSender::ControlRoute;
+
+    ShmSender::ShmSender( const std::string& name, size_t capacity ) :
+        m_ring( name, capacity ), m_nbrStalls( 0 ) {}
+
+    ShmSender::~ShmSender()
+    {
+        for( size_t i = 0; i < m_slots.size(); ++i )
+            delete m_slots[i];
+    }
+
+    // Create the route of the remote Slot on first use and announce it
+    bool ShmSender::bridge( AnySignal* signal, const std::string& slotName )
+    {
+        if( !signal )
+            return false;
+        RemoteSlot*& slot = m_routes[slotName];
+        if( !slot )
+        {
+            boost::uint32_t route = boost::uint32_t( m_slots.size() );
+            slot = new RemoteSlot( *this, route, slotName );
+            m_slots.push_back( slot );
+            size_t size = sizeof(route) + slotName.size();
+            char* data = static_cast<char*>( reserve( size ) );
+            std::memcpy( data, &route, sizeof(route) );
+            std::memcpy( data + sizeof(route), slotName.data(), slotName.size() );
+            m_ring.commit( ControlRoute, 0, size );
+        }
+        return Link::connect( signal, slot );
+    }
+
+    // The encoder gives the size of the record before writing it
+    void ShmSender::send( boost::uint32_t route, const Message::Ptr& msg,
+                          const MessageCodec::Codec& codec )
+    {
+        size_t size = codec.encode( *msg, nullptr, 0 );
+        void* data = reserve( size );
+        codec.encode( *msg, data, size );
+        m_ring.commit( route, codec.id, size );
+    }
+
+    void* ShmSender::reserve( size_t size )
+    {
+        void* data = m_ring.reserve( size );
+        while( !data )
+        {
+            ++m_nbrStalls;
+            boost::this_thread::yield();
+            data = m_ring.reserve( size );
+        }
+        return data;
+    }
+
+
+    ShmReceiver::ShmReceiver( const std::string& name, Domain& domain ) :
+        m_ring( name ), m_domain( domain ), m_nbrDropped( 0 ) {}
+
+    ShmReceiver::~ShmReceiver()
+    {
+        for( size_t i = 0; i < m_signals.size(); ++i )
+            delete m_signals[i];
+    }
+
+    // The record is released before emitting its decoded Message
+    size_t ShmReceiver::poll( size_t max )
+    {
+        size_t n = 0;
+        while( n < max )
+        {
+            const ShmRing::Record* record = m_ring.peek();
+            if( !record )
+                break;
+            if( record->route == ShmSender::ControlRoute )
+            {
+                addRoute( *record );
+                m_ring.release();
+                continue;
+            }
+            const MessageCodec::Codec* codec = MessageCodec::find( record->type );
+            Signal<Message>* signal = record->route < m_signals.size() ?
+                m_signals[record->route] : nullptr;
+            if( !codec || !signal )
+            {
+                ++m_nbrDropped;
+                m_ring.release();
+                continue;
+            }
+            Message::Ptr msg;
+            try
+            {
+                msg = codec->decode( record->payload(), record->size );
+            }
+            catch( ... )
+            {
+                m_ring.release();
+                throw;
+            }
+            m_ring.release();
+            signal->emit( msg );
+            ++n;
+        }
+        return n;
+    }
+
+    // A route of a Slot unknown in this process stays null
+    void ShmReceiver::addRoute( const ShmRing::Record& record )
+    {
+        boost::uint32_t route;
+        if( record.size < sizeof(route) )
+            return;
+        const char* data = static_cast<const char*>( record.payload() );
+        std::memcpy( &route, data, sizeof(route) );
+        std::string slotName( data + sizeof(route), record.size - sizeof(route) );
+        if( route >= m_signals.size() )
+            m_signals.resize( route + 1, nullptr );
+        AnySlot* slot = AnySlot::get( slotName );
+        if( !slot || m_signals[route] )
+            return;
+        Signal<Message>* signal = new Signal<Message>();
+        signal->setDomain( m_domain );
+        Link::connect( signal, slot );
+        m_signals[route] = signal;
+    }
+}
@@ -0,0 +1,159 @@
+#ifndef SHMTRANSPORT_HPP
+#define SHMTRANSPORT_HPP
+
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/cstdint.hpp>
+
+#include "ShmRing.hpp"
+#include "RemoteSlot.hpp"
+#include "Signal.hpp"
+#include "Domain.hpp"
+
+namespace MPO
+{
+
+/**
+    @brief Transport writing the Message of local Signals in a ShmRing
+
+    The sender bridges named Signals of its process to named Slots of the
+    process of the ShmReceiver opening the same ring. Each remote Slot has
+    a route and a RemoteSlot, connected to the bridged Signals by regular
+    Links, which encodes the Message in place in the ring with the codec of
+    their type. The route is announced to the receiver by a control record
+    holding the remote Slot name.
+
+    @code
+        // Process A
+        ShmSender sender( "/mpo-ab" );
+        sender.bridge( "Ping::output", "Pong::input" );
+
+        // Process B
+        ShmReceiver receiver( "/mpo-ab" );
+        while( ... )
+            receiver.poll();
+    @endcode
+
+    A RemoteSlot waits while the ring is full, it then yields the thread
+    until the receiver made room. The Signals must belong to a single
+    Domain, since the ring has a single producer.
+*/
+class ShmSender : private RemoteSlot::Sink
+{
+public:
+    /// Route of the control records announcing a route
+    static const boost::uint32_t ControlRoute = 0xfffffffe;
+
+    /**
+     * @brief Constructor creating the ring
+     *
+     * @param name Name of the shared memory segment, starting with a '/'
+     * @param capacity Size of the ring in bytes
+     * @throw std::runtime_error if the ring can't be created
+     */
+    ShmSender( const std::string& name, size_t capacity = 1 << 20 );
+
+    /// Destructor disconnecting the bridged Signals and removing the ring
+    ~ShmSender();
+
+    /**
+     * @brief Bridge a local Signal to a Slot of the receiver process
+     *
+     * @param signal Local Signal
+     * @param slotName Name of the Slot in the receiver process
+     * @return false if signal is nullptr
+     */
+    bool bridge( AnySignal* signal, const std::string& slotName );
+
+    /**
+     * @brief Bridge a named local Signal to a Slot of the receiver process
+     *
+     * @param signalName Name of the local Signal
+     * @param slotName Name of the Slot in the receiver process
+     * @return false if no Signal has the name signalName
+     */
+    bool bridge( const std::string& signalName, const std::string& slotName )
+        { return bridge( AnySignal::get( signalName ), slotName ); }
+
+    /**
+     * @brief Return the number of times the Slots waited for the receiver
+     *
+     * @return the number of full ring waits
+     */
+    size_t nbrStalls() const { return m_nbrStalls; }
+
+    /**
+     * @brief Return the ring of the sender
+     *
+     * @return the ring
+     */
+    ShmRing& ring() { return m_ring; }
+
+private:
+    /// Encode the Message in place in the ring
+    virtual void send( boost::uint32_t route, const Message::Ptr& msg,
+                       const MessageCodec::Codec& codec );
+
+    /// Wait for the space of a record
+    void* reserve( size_t size );
+
+    ShmRing m_ring;                              ///< Ring written by the sender
+    std::vector<RemoteSlot*> m_slots;            ///< RemoteSlots by route
+    std::map<std::string, RemoteSlot*> m_routes; ///< RemoteSlots by name
+    size_t m_nbrStalls;                          ///< Number of full ring waits
+};
+
+
+/**
+    @brief Transport emitting the Message read in a ShmRing
+
+    The receiver opens the ring created by a ShmSender and connects a Signal
+    to the named local Slot of each announced route. The poll() method
+    decodes the records with the codecs of their type and emits them, it is
+    called by the thread processing the Domain of the receiver Signals.
+    Records of an unknown type or route are dropped and counted.
+*/
+class ShmReceiver
+{
+public:
+    /**
+     * @brief Constructor opening the ring
+     *
+     * @param name Name of the shared memory segment
+     * @param domain Domain of the Signals emitting the received Message
+     * @throw std::runtime_error if the ring doesn't exist or is invalid
+     */
+    ShmReceiver( const std::string& name, Domain& domain = Domain::main() );
+
+    /// Destructor disconnecting the Signals
+    ~ShmReceiver();
+
+    /**
+     * @brief Emit the Message of the records written in the ring
+     *
+     * @param max Maximum number of Message to emit
+     * @return the number of emitted Message
+     */
+    size_t poll( size_t max = size_t(-1) );
+
+    /**
+     * @brief Return the number of dropped records
+     *
+     * @return the number of records of unknown types or routes
+     */
+    size_t nbrDropped() const { return m_nbrDropped; }
+
+private:
+    /// Connect the Signal of a route announced by a control record
+    void addRoute( const ShmRing::Record& record );
+
+    ShmRing m_ring;                          ///< Ring read by the receiver
+    Domain& m_domain;                        ///< Domain of the Signals
+    std::vector<Signal<Message>*> m_signals; ///< Signals by route
+    size_t m_nbrDropped;                     ///< Number of dropped records
+};
+
+} // namespace MPO
+
+#endif // SHMTRANSPORT_HPP
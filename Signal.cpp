@@ -1,25 +1,181 @@
+#include <stdexcept>
+
 #include "Signal.hpp"
 #include "Link.hpp"
+#include "Domain.hpp"
+#include "Trace.hpp"
 
 namespace MPO
 {
-    // Disconnect all links
+    // Constructor of a Signal belonging to the main Domain
+    AnySignal::AnySignal( const TypeDef& type ) :
+        m_planned(true), m_frozen(false), m_msgType(type),
+        m_domain(&Domain::main()), m_priority(Message::NormalPriority), m_coalescing(false) {}
+
+    // Unfreeze the Signal so that its links may disconnect
     AnySignal::~AnySignal()
     {
+        m_frozen = false;
         while( !m_links.empty() )
-            delete m_links.begin()->second;
+            m_links.back()->disconnect();
         unregisterName();
     }
 
-    // Emit the message msg through all link connected to signal
+    // Emit the message msg through the runs of the dispatch plan
     void AnySignal::emit( Message::Ptr msg )
     {
-        Message::Emitted::Entry entry( msg, nullptr );
-        for( LinkMap::const_iterator it = m_links.begin();
-                it != m_links.end(); ++it )
+        const bool traced = Trace::isEnabled() && msg;
+        Message::Emitted::Entry entry;
+        for( size_t i = 0; ; ++i )
+        {
+            // A direct Slot may rewire the Signal or emit again through it,
+            // the runs left are then read from the new plan by index
+            if( !m_planned )
+                plan();
+            if( i >= m_plan.size() )
+                break;
+            const Run run = m_plan[i];
+            const bool last = i + 1 == m_plan.size();
+            // The Slots called at once only record their dispatch events
+            if( traced && ( !run.direct || !run.queue->callsDirectly() ) )
+                Trace::recordEmit( run.links, run.nbrLinks, msg->type() );
+            if( !run.channel && !run.coalesce && !run.direct )
+                run.queue->add( msg, run.links, run.nbrLinks, last,
+                                run.priority );
+            else
+            {
+                // The last entry takes over msg, the queues swap entries in
+                entry.link = run.links[0];
+                if( last )
+                    entry.msg.swap( msg );
+                else
+                    entry.msg = msg;
+                if( run.channel )
+                    run.queue->send( *run.channel, entry );
+                else if( run.direct )
+                    run.queue->call( entry, run.priority );
+                else
+                {
+                    run.queue->coalesce( entry );
+                    entry.msg.reset();
+                }
+            }
+            if( last )
+                break;
+        }
+    }
+
+    // Emit msg if every queue has room for the entries queued in it, the
+    // direct Links called at once need none
+    bool AnySignal::tryEmit( Message::Ptr msg )
+    {
+        if( !m_planned )
+            plan();
+        const size_t n = m_plan.size();
+        for( size_t i = 0, end; i < n; i = end )
+        {
+            Message::Emitted* queue = m_plan[i].queue;
+            size_t nbrEntries = 0;
+            for( end = i; end < n && m_plan[end].queue == queue; ++end )
+                if( !m_plan[end].direct || !queue->callsDirectly() )
+                    nbrEntries += m_plan[end].nbrLinks;
+            if( nbrEntries && !queue->canAdd( nbrEntries ) )
+                return false;
+        }
+        emit( msg );
+        return true;
+    }
+
+    // Append the link and index it with its slot
+    void AnySignal::connect( AnySlot& slot, Link& link )
+    {
+        link.m_signalIndex = m_links.size();
+        m_links.push_back( &link );
+        m_index[&slot] = &link;
+        replan();
+    }
+
+    // Remove the link to slot, moving the last link in its place
+    bool AnySignal::disconnect( AnySlot& slot )
+    {
+        LinkMap::iterator it = m_index.find( &slot );
+        if( it == m_index.end() )
+            return false;
+        size_t i = it->second->m_signalIndex;
+        m_links[i] = m_links.back();
+        m_links[i]->m_signalIndex = i;
+        m_links.pop_back();
+        m_index.erase( it );
+        replan();
+        return true;
+    }
+
+    // Assign the signal to a Domain and update the links accordingly
+    void AnySignal::setDomain( Domain& domain )
+    {
+        m_domain = &domain;
+        for( size_t i = 0; i < m_links.size(); ++i )
+            m_links[i]->updateDomains();
+    }
+
+    // Set the priority of the current and future links
+    void AnySignal::setPriority( Message::Priority priority )
+    {
+        m_priority = priority;
+        for( size_t i = 0; i < m_links.size(); ++i )
+            m_links[i]->m_priority = priority;
+        replan();
+    }
+
+    // Set the coalescing mode of the current and future links
+    void AnySignal::setCoalescing( bool coalescing )
+    {
+        m_coalescing = coalescing;
+        for( size_t i = 0; i < m_links.size(); ++i )
+            m_links[i]->m_coalesce = coalescing;
+        replan();
+    }
+
+    void AnySignal::freeze()
+    {
+        m_frozen = true;
+        plan();
+    }
+
+    void AnySignal::unfreeze()
+    {
+        m_frozen = false;
+    }
+
+    void AnySignal::checkUnfrozen() const
+    {
+        if( m_frozen )
+            throw std::runtime_error( "Rewiring the frozen Signal '" +
+                                      m_name + "'" );
+    }
+
+    // Group the consecutive Links queuing in the same lane in a run, the
+    // direct Links and the Links sent through a channel or coalesced are
+    // alone
+    void AnySignal::plan()
+    {
+        m_plan.clear();
+        m_planned = true;
+        const size_t n = m_links.size();
+        for( size_t i = 0, end; i < n; i = end )
         {
-            entry.link = it->second;
-            Message::emitted.add( entry );
+            const Link* link = m_links[i];
+            end = i + 1;
+            const bool direct = link->m_direct && !link->m_channel;
+            if( !link->m_channel && !link->m_coalesce && !direct )
+                while( end < n && !m_links[end]->m_channel &&
+                       !m_links[end]->m_coalesce && !m_links[end]->m_direct &&
+                       m_links[end]->m_queue == link->m_queue &&
+                       m_links[end]->m_priority == link->m_priority )
+                    ++end;
+            Run run = { &m_links[i], end - i, link->m_queue, link->m_channel,
+                        link->m_priority, link->m_coalesce, direct };
+            m_plan.push_back( run );
         }
     }
 
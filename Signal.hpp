@@ -3,6 +3,8 @@
 
 #include <set>
 #include <map>
+#include <vector>
+#include <boost/unordered_map.hpp>
 
 #include "Message.hpp"
 
@@ -13,12 +15,13 @@ namespace MPO
 class Link;
 class AnySignal;
 class AnySlot;
+class Domain;
 
-/// Link map definition
+/// Link index definition
 typedef std::map<AnySlot*,Link*> LinkMap;
 
-/// Signal directory definition
-typedef std::map<std::string, AnySignal*> SignalMap;
+/// Signal directory definition, hashed for linear network build up
+typedef boost::unordered_map<std::string, AnySignal*> SignalMap;
 
 /// Name set definition
 typedef std::set<std::string> NameSet;
@@ -31,6 +34,8 @@ typedef std::set<std::string> NameSet;
 class AnySignal
 {
     friend class Link;
+    friend class Topology; // Topology reserves the links of its connections
+    friend class GraphArena; // GraphArena connects and detaches its links
 public:
     /// Disconnects all Link connections
     virtual ~AnySignal();
@@ -43,11 +48,12 @@ public:
     const TypeDef& messageType() const { return m_msgType; }
 
     /**
-     * @brief Returns a reference on the set of Link connected to this Signal
+     * @brief Returns a reference on the map of Link connected to this Signal
+     *        indexed by their Slot
      *
-     * @return a reference on the set of Link connected to this Signal
+     * @return a reference on the map of Link connected to this Signal
      */
-    const LinkMap& links() const { return m_links; }
+    const LinkMap& links() const { return m_index; }
 
     /**
      * @brief Assign a new name to the Signal or unregister if name is ""
@@ -75,6 +81,87 @@ public:
      */
     const std::string& name() const { return m_name; }
 
+    /**
+     * @brief Return the dispatch Domain of the Signal
+     *
+     * @return the Domain the Signal belongs to
+     */
+    Domain& domain() const { return *m_domain; }
+
+    /**
+     * @brief Assign the Signal to a dispatch Domain
+     *
+     * The Signal must then only emit Message from the thread processing
+     * the Domain.
+     *
+     * @param domain Domain the Signal belongs to
+     */
+    void setDomain( Domain& domain );
+
+    /**
+     * @brief Return the priority class given to the Links of the Signal
+     *
+     * @return the priority of the Links connected from the Signal
+     */
+    Message::Priority priority() const { return m_priority; }
+
+    /**
+     * @brief Set the priority class of the Links of the Signal
+     *
+     * The priority is applied to the connected Links and to the Links
+     * connected later. The priority of a single Link may then be changed
+     * with Link::setPriority(). A Message emitted by a Signal is queued in
+     * the lane of its Link priority, so that control Message are processed
+     * before the bulk ones queued earlier.
+     *
+     * @param priority Priority of the Links connected from the Signal
+     */
+    void setPriority( Message::Priority priority );
+
+    /**
+     * @brief Return true if the Links of the Signal coalesce their Message
+     *
+     * @return true if new Links are in coalescing mode
+     */
+    bool isCoalescing() const { return m_coalescing; }
+
+    /**
+     * @brief Set the coalescing mode of the Links of the Signal
+     *
+     * The mode is applied to the connected Links and to the Links connected
+     * later. It suits Signals emitting state updates of which only the
+     * latest matters.
+     *
+     * @see Link::setCoalescing()
+     * @param coalescing true if the Links must coalesce their Message
+     */
+    void setCoalescing( bool coalescing );
+
+    /**
+     * @brief Compile the Links into their dispatch plan and forbid rewiring
+     *
+     * emit() always reads the dispatch plan of the Signal, an array of runs
+     * of consecutive Links sharing their queue, channel, priority and
+     * coalescing mode, compiled again by the next emit() once the Links
+     * changed. Freezing compiles the plan at once and keeps it, as the
+     * Signal may then not be connected nor disconnected with
+     * Link::connect(), Link::disconnect(), a Topology or a GraphArena,
+     * which throw a runtime_error. Changing the Domains, priorities or
+     * coalescing modes of the Links, destroying a connected Slot or tearing
+     * down a GraphArena still updates the plan.
+     */
+    void freeze();
+
+    /// Permit rewiring the Signal again
+    void unfreeze();
+
+    /**
+     * @brief Return true if the Signal may not be rewired
+     *
+     * @return true if the Signal is frozen
+     */
+    bool isFrozen() const { return m_frozen; }
+
     /**
      * @brief Returns the Signal associated to a name or nullptr if not found
      *
@@ -96,32 +183,49 @@ protected:
      *
      * @param type the Message type the Signal may emit
      */
-    AnySignal(const TypeDef& type ) : m_msgType(type) {}
+    AnySignal( const TypeDef& type );
 
     /**
      * @brief Send the given Message through all Link connections
      *
+     * The argument is copied in the entries queued for all Links but the
+     * last one, which takes over the argument itself.
+     * A direct Slot may emit through the Signal again or rewire it, the
+     * Links left are then those of the new plan.
+     *
      * @param msg the Message to sent through all Link connections
      */
     void emit( Message::Ptr msg );
 
     /**
-     * @brief Insert Link in LinkMap (called by link himself)
+     * @brief Send the given Message through all Link connections if none
+     *        of their queues is full
+     *
+     * As in emit(), the direct Links call their Slot at once and need no
+     * room in the queue, unless the Slot Domain would queue their entries.
      *
-     * @param link to add to the LinkSet
+     * @param msg the Message to sent through all Link connections
+     * @return false if a queue is full, the Message is then not sent
      */
-    void connect( AnySlot& slot, Link& link )
-    {
-        m_links[&slot] = &link;
-    }
+    bool tryEmit( Message::Ptr msg );
+
+    /**
+     * @brief Append Link to the links and index it (called by link himself)
+     *
+     * @param slot Slot the Link is connected to
+     * @param link to add to the links
+     */
+    void connect( AnySlot& slot, Link& link );
 
     /**
-     * @brief Remove connection to slot from map (called by link himself)
+     * @brief Remove connection to slot (called by link himself)
+     *
+     * The last Link takes the place of the removed one in the vector.
      *
-     * @param slot Connection to remove from the LinkMap
+     * @param slot Connection to remove from the links
      * @return true if a connection was disconnected
      */
-    bool disconnect( AnySlot &slot) { return m_links.erase( &slot ) == 1; }
+    bool disconnect( AnySlot &slot );
 
     /**
      * @brief Return true if connected to the given Slot
@@ -130,11 +234,56 @@ protected:
      * @return true if connected to the given Slot
      */
     bool isConnected( AnySlot &slot )
-        { return m_links.find( &slot ) != m_links.end(); }
+        { return m_index.find( &slot ) != m_index.end(); }
 
-    LinkMap m_links;              ///< Map of connected links
+    /**
+     * @brief Return the Link connected to the given Slot or nullptr
+     *
+     * @param slot Slot to look for
+     * @return the Link connected to slot or nullptr if none
+     */
+    Link* findLink( AnySlot& slot ) const
+    {
+        LinkMap::const_iterator it = m_index.find( &slot );
+        return it == m_index.end() ? nullptr : it->second;
+    }
+
+    /**
+     * @brief Throw a runtime_error if the Signal is frozen
+     *
+     * @throws runtime_error if the Signal may not be rewired
+     */
+    void checkUnfrozen() const;
+
+    /// Run of the dispatch plan, consecutive Links queued at once or a
+    /// single Link sent through a channel, coalesced or called directly
+    struct Run
+    {
+        Link* const* links;                 ///< First Link of the run in m_links
+        size_t nbrLinks;                    ///< Number of Links
+        Message::Emitted* queue;            ///< Queue of the Slot Domain
+        Message::Emitted::Channel* channel; ///< Channel between Domains or nullptr
+        Message::Priority priority;         ///< Lane of the entries
+        bool coalesce;                      ///< True if the Link coalesces
+        bool direct;                        ///< True if the Slot is called
+    };
+
+    /// Compile m_links into m_plan
+    void plan();
+
+    /// Compile m_links again at the next emit(), called once the Links changed
+    void replan() { m_planned = false; }
+
+    LinkVector m_links;           ///< Connected links iterated by emit
+    std::vector<Run> m_plan;      ///< Dispatch plan read by emit
+    bool m_planned;               ///< True if m_plan matches m_links
+    bool m_frozen;                ///< True if the Signal may not be rewired
+    LinkMap m_index;              ///< Connected links indexed by Slot
     const TypeDef& m_msgType;     ///< Class of Message emitted by the Signal
     std::string m_name;           ///< Name assigned to the Signal
+    Domain* m_domain;             ///< Dispatch Domain of the Signal
+    Message::Priority m_priority; ///< Priority of the Links of the Signal
+    bool m_coalescing;            ///< Coalescing mode of the Links
     static SignalMap m_signalMap; ///< Global Signal map
 };
 
@@ -189,7 +338,19 @@ public:
      *
      * @param msg is shared_ptr on Message to emit
      */
-    void emit( typename TMsg::Ptr msg ) { AnySignal::emit( msg ); }
+    void emit( const typename TMsg::Ptr& msg ) { AnySignal::emit( msg ); }
+
+    /**
+     * @brief Emit the message msg through all links if none of their
+     *        queues is full
+     *
+     * When false is returned, the writable notifier of the full queue is
+     * called once it drained, so that the producer may emit again.
+     *
+     * @param msg is shared_ptr on Message to emit
+     * @return false if the Message was not emitted
+     */
+    bool tryEmit( const typename TMsg::Ptr& msg ) { return AnySignal::tryEmit( msg ); }
 };
 
 } // namespace MPO
@@ -1,14 +1,43 @@
 #include "Slot.hpp"
 #include "Link.hpp"
+#include "Domain.hpp"
 
 namespace MPO
 {
 
+    // Constructor of a Slot belonging to the main Domain
+    AnySlot::AnySlot( const TypeDef& type ) :
+        m_msgType(type), m_domain(&Domain::main()), m_batchSize(0) {}
+
     // Disconnect all links to the slot
     AnySlot::~AnySlot()
     {
         while( !m_links.empty() )
-            delete *m_links.begin();
+            m_links.back()->disconnect();
+    }
+
+    // Append the link
+    void AnySlot::connect( Link& link )
+    {
+        link.m_slotIndex = m_links.size();
+        m_links.push_back( &link );
+    }
+
+    // Remove the link, moving the last link in its place
+    void AnySlot::disconnect( Link& link )
+    {
+        size_t i = link.m_slotIndex;
+        m_links[i] = m_links.back();
+        m_links[i]->m_slotIndex = i;
+        m_links.pop_back();
+    }
+
+    // Assign the slot to a Domain and update the links accordingly
+    void AnySlot::setDomain( Domain& domain )
+    {
+        m_domain = &domain;
+        for( size_t i = 0; i < m_links.size(); ++i )
+            m_links[i]->updateDomains();
     }
 
     // Global Slot map
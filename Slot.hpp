@@ -3,9 +3,9 @@
 
 #include <set>
 #include <map>
-#include <boost/function.hpp>
-#include <boost/bind.hpp>
+#include <boost/unordered_map.hpp>
 #include <stdexcept>
+#include <utility>
 
 #include "Message.hpp"
 
@@ -14,12 +14,10 @@ namespace MPO
 {
 class Link;
 class AnySlot;
+class Domain;
 
-/// Link set definition
-typedef std::set<Link*> LinkSet;
-
-/// Slot directory definition
-typedef std::map<std::string, AnySlot*> SlotMap;
+/// Slot directory definition, hashed for linear network build up
+typedef boost::unordered_map<std::string, AnySlot*> SlotMap;
 
 
 /*! The class AnySlot is the base class of all Slot classes
@@ -27,14 +25,87 @@ typedef std::map<std::string, AnySlot*> SlotMap;
     The class AnySlot may not be instantiated. The purpose of this class is
     to make it possible to define a generic pointer type to any type of Slot.
 */
-class AnySlot
+class AnySlot : private Instrumentation::SlotStats
 {
     friend class Link;
+    friend class Topology; // Topology reserves the links of its connections
+    friend class GraphArena; // GraphArena connects and detaches its links
+    friend class Trace; // Trace writes the names of the Slots
 
 public:
 
-    /// Pointer to a generic Message processing Function
-    typedef boost::function<void ( Message::Ptr, Link* )> Function;
+    /**
+        @brief Generic Message processing Function
+
+        The Function is a pointer on a static thunk generated by the Slot
+        template class and the pointer on the object owning the Slot
+        method. The thunk knows the method to call at compile time, so that
+        calling a Function is a single indirect call in which the method
+        call may be inlined.
+
+        The thunk borrows the Message by reference and may move it in the
+        argument of the Slot method, so that forwarding a queued Message
+        doesn't modify its reference count.
+
+        The Function of a BatchSlot also has a batch thunk delivering a
+        range of Message in a single call.
+    */
+    struct Function
+    {
+        /// Thunk calling the Slot method or function, may move msg out
+        typedef void (*Thunk)( void* obj, Message::Ptr& msg, Link* link );
+
+        /// Thunk calling the Slot method with n Message, may move them out
+        typedef void (*BatchThunk)( void* obj, Message::Ptr* msgs, size_t n,
+                                    Link* link );
+
+        /// Default constructor of an unset Function
+        Function() : thunk(nullptr), obj(nullptr), batch(nullptr) {}
+
+        /**
+         * @brief Constructor
+         *
+         * @param thunk Thunk calling the Slot method or function
+         * @param obj Pointer on the object owning the Slot method or nullptr
+         * @param batch Thunk calling the Slot method with a range of Message
+         *              or nullptr if the Slot processes them one by one
+         */
+        Function( Thunk thunk, void* obj, BatchThunk batch = nullptr ) :
+            thunk(thunk), obj(obj), batch(batch) {}
+
+        /**
+         * @brief Call the Slot method or function
+         *
+         * @param msg The Message to pass as argument
+         * @param link Link traversed by the Message or nullptr
+         */
+        void operator()( Message::Ptr msg, Link* link ) const
+            { thunk( obj, msg, link ); }
+
+        /**
+         * @brief Call the Slot method or function with a Message it may
+         *        take over
+         *
+         * @param msg The Message to pass as argument, may be left empty
+         * @param link Link traversed by the Message or nullptr
+         */
+        void consume( Message::Ptr& msg, Link* link ) const
+            { thunk( obj, msg, link ); }
+
+        /**
+         * @brief Call the Slot method with n Message it may take over
+         *
+         * @param msgs Array of the Message to pass, may be left empty
+         * @param n Number of Message
+         * @param link Link traversed by the Message
+         */
+        void consumeBatch( Message::Ptr* msgs, size_t n, Link* link ) const
+            { batch( obj, msgs, n, link ); }
+
+        Thunk thunk;      ///< Thunk calling the Slot method or function
+        void* obj;        ///< Object owning the Slot method or nullptr
+        BatchThunk batch; ///< Thunk delivering a range or nullptr
+    };
 
     /// Destructor disconnecting all Link
     ~AnySlot();
@@ -69,11 +140,25 @@ public:
         { m_dynamicCastFunction( msg, nullptr ); }
 
     /**
-     * @brief Return a const reference on the link set connected to the slot
+     * @brief Return a const reference on the links connected to the slot
+     *
+     * @return a const reference on the links connected to the slot
+     */
+    const LinkVector& links() const { return m_links; }
+
+    /**
+     * @brief Return the maximum number of Message delivered in one call
+     *
+     * @return the batch size of a BatchSlot, 0 for the other Slots
+     */
+    size_t batchSize() const { return m_batchSize; }
+
+    /**
+     * @brief Return the statistics of the Slot
      *
-     * @return a const reference on the link set connected to the slot
+     * @return the statistics recorded by the Instrumentation policy
      */
-    const LinkSet& links() const { return m_links; }
+    const Instrumentation::SlotStats& stats() const { return *this; }
 
     /**
      * @brief Assign a new name to the Slot or unregister if name is ""
@@ -101,6 +186,23 @@ public:
      */
     const std::string& name() const { return m_name; }
 
+    /**
+     * @brief Return the dispatch Domain of the Slot
+     *
+     * @return the Domain the Slot belongs to
+     */
+    Domain& domain() const { return *m_domain; }
+
+    /**
+     * @brief Assign the Slot to a dispatch Domain
+     *
+     * The Message received by the Slot will then be queued in the Domain
+     * and the Slot method called by the thread processing it.
+     *
+     * @param domain Domain the Slot belongs to
+     */
+    void setDomain( Domain& domain );
+
     /**
      * @brief Returns the Slot associated to a name or nullptr if not found
      *
@@ -115,6 +217,35 @@ public:
 
 protected:
 
+    /**
+     * @brief Return true if msg is an instance of TMsg or of a subclass
+     *
+     * The check uses the TypeDef of the Message instead of RTTI, so that
+     * each Message class must override type().
+     *
+     * @param msg Message to check
+     * @return true if msg may be static cast to TMsg
+     */
+    template <class TMsg>
+    static bool isa( const Message::Ptr& msg )
+        { return msg && msg->type().isSameOrSubtypeOf( &TMsg::Type() ); }
+
+    /**
+     * @brief Return msg cast to a TMsg pointer, moving it if supported
+     *
+     * @param msg Message to cast, left empty when moved
+     * @return shared_ptr on the Message as a TMsg
+     */
+    template <class TMsg>
+    static typename TMsg::Ptr staticCast( Message::Ptr& msg )
+    {
+#ifndef BOOST_NO_CXX11_RVALUE_REFERENCES
+        return boost::static_pointer_cast<TMsg>( std::move( msg ) );
+#else
+        return boost::static_pointer_cast<TMsg>( msg );
+#endif
+    }
+
     /**
      * @brief Constructor
      *
@@ -123,27 +254,30 @@ protected:
      *
      * @param type the Message type the Slot may accept
      */
-    AnySlot( const TypeDef& type ) : m_msgType(type) {}
+    AnySlot( const TypeDef& type );
 
     /**
-     * @brief Insert Link in LinkSet (called by link himself)
+     * @brief Append Link to the links (called by link himself)
      *
-     * @param link to add to the LinkSet
+     * @param link to add to the links
      */
-    void connect( Link& link ) { m_links.insert( &link ); }
+    void connect( Link& link );
 
     /**
-     * @brief Remove link from set (called by link himself)
+     * @brief Remove link, moving the last link in its place (called by link
+     *        himself)
      *
-     * @param link to remove from the LinkSet
+     * @param link to remove from the links
      */
-    void disconnect( Link& link ) { m_links.erase( &link ); }
+    void disconnect( Link& link );
 
     const TypeDef& m_msgType;       ///< Class of Message accepted by Slot
     Function m_dynamicCastFunction; ///< Slot method with dynamic cast of Message
     Function m_staticCastFunction;  ///< Slot method with static cast of Message
-    LinkSet m_links;                ///< Set of connected links
+    LinkVector m_links;             ///< Connected links
     std::string m_name;             ///< Name assigned to the Slot
+    Domain* m_domain;               ///< Dispatch Domain of the Slot
+    size_t m_batchSize;             ///< Message delivered per call or 0
     static SlotMap m_slotMap;       ///< Global Slot map
 };
 
@@ -187,13 +321,14 @@ template <class TMsg, class TObj, void (TObj::*TMethod)(typename TMsg::Ptr, Link
 
     A static cast will be performed on the Message if the statically defined
     Message type emitted by the connected Signal matches the polymorphic rule.
-    Otherwise a dynamic cast is performed. The slot method will not be called
-    if the dynamic cast on the Message returns a nullptr.
+    Otherwise the TypeDef of each Message is checked before the static cast.
+    The slot method will not be called if the Message is not an instance of
+    the accepted class or of a sub class.
 
     It is possible to establish a connection Link that will always perform a
     static cast. This should be only done if the user can ensure that the
     Message types will always match the expected type of the slot method. This
-    avoids the dynamic cast and resulting performance penalty.
+    avoids the type check and resulting performance penalty.
 
 */
 class Slot : public AnySlot
@@ -210,10 +345,8 @@ public:
      */
     Slot( TObj* obj ) : AnySlot( TMsg::Type() )
     {
-        m_dynamicCastFunction =
-                boost::bind( &MyType::dynamicCastFunction, obj, ::_1, ::_2 );
-        m_staticCastFunction =
-                boost::bind( &MyType::staticCastFunction, obj, ::_1, ::_2 );
+        m_dynamicCastFunction = Function( &MyType::dynamicCastFunction, obj );
+        m_staticCastFunction = Function( &MyType::staticCastFunction, obj );
     }
 
 private:
@@ -222,29 +355,28 @@ private:
      * @brief Wrapper of Slot method call with dynamic cast of Message argument
      *
      * @param obj Pointer on the object owning the Slot
-     * @param msg shared_ptr on the Message to pass as Slot method argument
+     * @param msg shared_ptr on the Message to move in the Slot method argument
      * @param link pointer on Link through which the Message was sent or
      *             nullptr if unspecified or none
      */
-    static void dynamicCastFunction( TObj* obj, typename Message::Ptr msg, Link* link )
+    static void dynamicCastFunction( void* obj, Message::Ptr& msg, Link* link )
     {
-        typename TMsg::Ptr m = boost::dynamic_pointer_cast<TMsg>(msg);
-        if( m && obj )
-            (obj->*TMethod)(m, link);
+        if( obj && isa<TMsg>( msg ) )
+            (static_cast<TObj*>(obj)->*TMethod)(staticCast<TMsg>(msg), link);
     }
 
     /**
      * @brief Wrapper of Slot method call with static cast of Message argument
      *
      * @param obj Pointer on the object owning the Slot
-     * @param msg shared_ptr on the Message to pass as Slot method argument
+     * @param msg shared_ptr on the Message to move in the Slot method argument
      * @param link pointer on Link through which the Message was sent or
      *             nullptr if unspecified or none
      */
-    static void staticCastFunction( TObj* obj, typename Message::Ptr msg, Link* link )
+    static void staticCastFunction( void* obj, Message::Ptr& msg, Link* link )
     {
         if( msg && obj )
-            (obj->*TMethod)(boost::static_pointer_cast<TMsg>(msg), link);
+            (static_cast<TObj*>(obj)->*TMethod)(staticCast<TMsg>(msg), link);
     }
 };
 
@@ -278,13 +410,14 @@ template <class TMsg, void (*TFunction)(typename TMsg::Ptr, Link*)>
 
     A static cast will be performed on the Message if the statically defined
     Message type emitted by the connected Signal matches the polymorphic rule.
-    Otherwise a dynamic cast is performed. The slot function will not be called
-    if the dynamic cast on the Message returns a nullptr.
+    Otherwise the TypeDef of each Message is checked before the static cast.
+    The slot function will not be called if the Message is not an instance
+    of the accepted class or of a sub class.
 
     It is possible to establish a connection Link that will always perform a
     static cast. This should be only done if the user can ensure that the
     Message types will always match the expected type of the slot function.
-    This avoids the dynamic cast and resulting performance penalty.
+    This avoids the type check and resulting performance penalty.
 */
 class SlotFunction : public AnySlot
 {
@@ -300,8 +433,8 @@ public:
      */
     SlotFunction() : AnySlot( TMsg::Type() )
     {
-        m_dynamicCastFunction = &MyType::dynamicCastFunction;
-        m_staticCastFunction = &MyType::staticCastFunction;
+        m_dynamicCastFunction = Function( &MyType::dynamicCastFunction, nullptr );
+        m_staticCastFunction = Function( &MyType::staticCastFunction, nullptr );
     }
 
 private:
@@ -310,32 +443,317 @@ private:
      * @brief Wrapper of Slot method call with dynamic cast of Message argument
      *
      * @param obj Pointer on the object owning the Slot
-     * @param msg shared_ptr on the Message to pass as Slot method argument
+     * @param msg shared_ptr on the Message to move in the Slot method argument
      * @param link pointer on Link through which the Message was sent or
      *             nullptr if unspecified or none
      */
-    static void dynamicCastFunction( typename Message::Ptr msg, Link* link )
+    static void dynamicCastFunction( void*, Message::Ptr& msg, Link* link )
     {
-        typename TMsg::Ptr m = boost::dynamic_pointer_cast<TMsg>(msg);
-        if( m )
-            (*TFunction)( m, link );
+        if( isa<TMsg>( msg ) )
+            (*TFunction)( staticCast<TMsg>(msg), link );
     }
 
     /**
      * @brief Wrapper of Slot method call with static cast of Message argument
      *
      * @param obj Pointer on the object owning the Slot
-     * @param msg shared_ptr on the Message to pass as Slot method argument
+     * @param msg shared_ptr on the Message to move in the Slot method argument
      * @param link pointer on Link through which the Message was sent or
      *             nullptr if unspecified or none
      */
-    static void staticCastFunction( typename Message::Ptr msg, Link* link )
+    static void staticCastFunction( void*, Message::Ptr& msg, Link* link )
     {
         if( msg )
-            (*TFunction)( boost::static_pointer_cast<TMsg>(msg), link );
+            (*TFunction)( staticCast<TMsg>(msg), link );
     }
 };
 
+template <class TMsg, class TObj, void (TObj::*TMethod)(const TMsg&, Link*)>
+/*! @class RefSlot  Slots bound to a class method receiving a Message reference.
+
+    A RefSlot is a Slot whose method receives a const reference on the
+    Message instead of a shared_ptr. The Message is borrowed from the queue
+    for the duration of the call, so that no reference count is modified to
+    deliver it. It must only be used by methods that don't keep the Message
+    after returning.
+
+    @code
+        class MyClass ...
+        {
+        public:
+            MyClass( ... ) : ..., m_slot(this), ... { ... }
+            RefSlot<MyMessage, MyClass, &MyClass::mySlotMethod> m_slot;
+        protected:
+            void mySlotMethod( const MyMessage& m, Link * l ) { ... }
+        };
+    @endcode
+
+    The cast rules are those of the Slot class.
+*/
+class RefSlot : public AnySlot
+{
+public:
+
+    /// Type of the current class
+    typedef RefSlot<TMsg,TObj,TMethod> MyType;
+
+    /**
+     * @brief Constructor initializing the Slot
+     *
+     * @param obj Pointer on the object owning the Slot (this)
+     */
+    RefSlot( TObj* obj ) : AnySlot( TMsg::Type() )
+    {
+        m_dynamicCastFunction = Function( &MyType::dynamicCastFunction, obj );
+        m_staticCastFunction = Function( &MyType::staticCastFunction, obj );
+    }
+
+private:
+
+    /**
+     * @brief Wrapper of Slot method call with dynamic cast of Message argument
+     *
+     * @param obj Pointer on the object owning the Slot
+     * @param msg shared_ptr on the Message to pass by reference
+     * @param link pointer on Link through which the Message was sent or
+     *             nullptr if unspecified or none
+     */
+    static void dynamicCastFunction( void* obj, Message::Ptr& msg, Link* link )
+    {
+        if( obj && isa<TMsg>( msg ) )
+            (static_cast<TObj*>(obj)->*TMethod)(static_cast<const TMsg&>(*msg), link);
+    }
+
+    /**
+     * @brief Wrapper of Slot method call with static cast of Message argument
+     *
+     * @param obj Pointer on the object owning the Slot
+     * @param msg shared_ptr on the Message to pass by reference
+     * @param link pointer on Link through which the Message was sent or
+     *             nullptr if unspecified or none
+     */
+    static void staticCastFunction( void* obj, Message::Ptr& msg, Link* link )
+    {
+        if( msg && obj )
+            (static_cast<TObj*>(obj)->*TMethod)(static_cast<const TMsg&>(*msg), link);
+    }
+};
+
+template <class TMsg, void (*TFunction)(const TMsg&, Link*)>
+/*! @class RefSlotFunction  Slots bound to a free function receiving a
+    Message reference.
+
+    A RefSlotFunction is a SlotFunction whose function receives a const
+    reference on the Message borrowed from the queue. It must only be used
+    by functions that don't keep the Message after returning.
+
+    @code
+        void mySlotFunction( const MyMessage& m, Link * l ) { ... }
+        RefSlotFunction<MyMessage, &mySlotFunction> slot;
+    @endcode
+*/
+class RefSlotFunction : public AnySlot
+{
+public:
+
+    /// Type of the current class
+    typedef RefSlotFunction<TMsg,TFunction> MyType;
+
+    /// Constructor initializing the Slot
+    RefSlotFunction() : AnySlot( TMsg::Type() )
+    {
+        m_dynamicCastFunction = Function( &MyType::dynamicCastFunction, nullptr );
+        m_staticCastFunction = Function( &MyType::staticCastFunction, nullptr );
+    }
+
+private:
+
+    /**
+     * @brief Wrapper of Slot function call with dynamic cast of Message argument
+     *
+     * @param msg shared_ptr on the Message to pass by reference
+     * @param link pointer on Link through which the Message was sent or
+     *             nullptr if unspecified or none
+     */
+    static void dynamicCastFunction( void*, Message::Ptr& msg, Link* link )
+    {
+        if( isa<TMsg>( msg ) )
+            (*TFunction)( static_cast<const TMsg&>(*msg), link );
+    }
+
+    /**
+     * @brief Wrapper of Slot function call with static cast of Message argument
+     *
+     * @param msg shared_ptr on the Message to pass by reference
+     * @param link pointer on Link through which the Message was sent or
+     *             nullptr if unspecified or none
+     */
+    static void staticCastFunction( void*, Message::Ptr& msg, Link* link )
+    {
+        if( msg )
+            (*TFunction)( static_cast<const TMsg&>(*msg), link );
+    }
+};
+
+template <class TMsg, class TObj,
+          void (TObj::*TMethod)(const typename TMsg::Ptr*, size_t, Link*)>
+/*! @class BatchSlot  Slots bound to a class method receiving ranges of
+    Message.
+
+    A BatchSlot is a Slot whose method receives a contiguous range of
+    Message. When the dispatcher processes an entry of a Link to a
+    BatchSlot, it gathers the entries of the same Link that follow it in
+    the queue, up to the batch size, and delivers them in one call. The
+    dispatcher doesn't wait for more Message, so that batching adds no
+    latency: a Message arriving alone is delivered in a range of one.
+
+    @code
+        class Writer ...
+        {
+        public:
+            Writer( ... ) : ..., m_input(this), ... { ... }
+            BatchSlot<Record, Writer, &Writer::write> m_input;
+        protected:
+            void write( const Record::Ptr* records, size_t n, Link * l )
+                { ... }
+        };
+    @endcode
+
+    The range is only valid during the call, the method may copy the
+    shared_ptr it keeps. The cast rules are those of the Slot class, the
+    Message not matching the accepted type are removed from the range.
+*/
+class BatchSlot : public AnySlot
+{
+public:
+
+    /// Type of the current class
+    typedef BatchSlot<TMsg,TObj,TMethod> MyType;
+
+    /**
+     * @brief Constructor initializing the Slot
+     *
+     * @param obj Pointer on the object owning the Slot (this)
+     * @param batchSize Maximum number of Message delivered in one call
+     */
+    BatchSlot( TObj* obj, size_t batchSize = 64 ) :
+        AnySlot( TMsg::Type() ), m_obj(obj)
+    {
+        m_batchSize = batchSize ? batchSize : 1;
+        m_dynamicCastFunction = Function( &MyType::dynamicCastFunction, this,
+                                          &MyType::dynamicCastBatch );
+        m_staticCastFunction = Function( &MyType::staticCastFunction, this,
+                                         &MyType::staticCastBatch );
+    }
+
+    /**
+     * @brief Set the maximum number of Message delivered in one call
+     *
+     * @param batchSize Maximum number of Message per call, at least 1
+     */
+    void setBatchSize( size_t batchSize ) { m_batchSize = batchSize ? batchSize : 1; }
+
+private:
+
+    /**
+     * @brief Wrapper of Slot method call with a single Message checked
+     *        with a dynamic cast
+     *
+     * @param slot Pointer on the BatchSlot
+     * @param msg shared_ptr on the Message to move in the range
+     * @param link pointer on Link through which the Message was sent or
+     *             nullptr if unspecified or none
+     */
+    static void dynamicCastFunction( void* slot, Message::Ptr& msg, Link* link )
+    {
+        if( isa<TMsg>( msg ) )
+            staticCastFunction( slot, msg, link );
+    }
+
+    /**
+     * @brief Wrapper of Slot method call with a single Message static cast
+     *
+     * @param slot Pointer on the BatchSlot
+     * @param msg shared_ptr on the Message to move in the range
+     * @param link pointer on Link through which the Message was sent or
+     *             nullptr if unspecified or none
+     */
+    static void staticCastFunction( void* slot, Message::Ptr& msg, Link* link )
+    {
+        MyType* self = static_cast<MyType*>( slot );
+        if( msg && self->m_obj )
+        {
+            typename TMsg::Ptr typed = staticCast<TMsg>( msg );
+            (self->m_obj->*TMethod)( &typed, 1, link );
+        }
+    }
+
+    /**
+     * @brief Wrapper of Slot method call with a range of Message checked
+     *        with a dynamic cast
+     *
+     * @param slot Pointer on the BatchSlot
+     * @param msgs Array of the Message to move in the range
+     * @param n Number of Message
+     * @param link pointer on Link through which the Message were sent
+     */
+    static void dynamicCastBatch( void* slot, Message::Ptr* msgs, size_t n,
+                                  Link* link )
+        { deliver( static_cast<MyType*>( slot ), msgs, n, link, true ); }
+
+    /**
+     * @brief Wrapper of Slot method call with a range of Message static cast
+     *
+     * @param slot Pointer on the BatchSlot
+     * @param msgs Array of the Message to move in the range
+     * @param n Number of Message
+     * @param link pointer on Link through which the Message were sent
+     */
+    static void staticCastBatch( void* slot, Message::Ptr* msgs, size_t n,
+                                 Link* link )
+        { deliver( static_cast<MyType*>( slot ), msgs, n, link, false ); }
+
+    /**
+     * @brief Move the Message in the typed range and call the Slot method
+     *        for each batch size of them
+     *
+     * The range is swapped out of the Slot during the calls, so that a
+     * Slot method processing the queue again gets a range of its own.
+     *
+     * @param self Pointer on the BatchSlot
+     * @param msgs Array of the Message to move in the range
+     * @param n Number of Message
+     * @param link pointer on Link through which the Message were sent
+     * @param check true if the type of each Message must be checked
+     */
+    static void deliver( MyType* self, Message::Ptr* msgs, size_t n,
+                         Link* link, bool check )
+    {
+        if( !self->m_obj )
+            return;
+        std::vector<typename TMsg::Ptr> range;
+        range.swap( self->m_range );
+        for( size_t i = 0; i < n; ++i )
+        {
+            if( !msgs[i] || ( check && !isa<TMsg>( msgs[i] ) ) )
+                continue;
+            range.push_back( staticCast<TMsg>( msgs[i] ) );
+            if( range.size() == self->m_batchSize )
+            {
+                (self->m_obj->*TMethod)( &range[0], range.size(), link );
+                range.clear();
+            }
+        }
+        if( !range.empty() )
+            (self->m_obj->*TMethod)( &range[0], range.size(), link );
+        range.clear();
+        range.swap( self->m_range );
+    }
+
+    TObj* m_obj;                             ///< Object owning the method
+    std::vector<typename TMsg::Ptr> m_range; ///< Range reused across calls
+};
+
 } // namespace MPO
 
 #endif // SLOT_HPP
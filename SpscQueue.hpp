@@ -0,0 +1,120 @@
+#ifndef SPSCQUEUE_HPP
+#define SPSCQUEUE_HPP
+
+#include <boost/atomic.hpp>
+
+#include "Type.hpp"
+
+namespace MPO
+{
+
+/**
+    @brief Lock-free single producer single consumer unbounded FIFO queue
+
+    This is the node based queue described by Dmitry Vyukov. One thread may
+    call push() while another thread calls pop(). Neither operation waits
+    on the other thread.
+
+    The nodes released by the consumer are recycled by the producer, so that
+    the queue doesn't allocate memory once it reached the size required by
+    the application.
+*/
+template <class T>
+class SpscQueue
+{
+public:
+    /// Constructor of an empty queue
+    SpscQueue()
+    {
+        Node* node = new Node();
+        m_tail.store( node, boost::memory_order_relaxed );
+        m_head = m_first = m_tailCopy = node;
+    }
+
+    /// Destructor deleting all nodes, pending elements included
+    ~SpscQueue()
+    {
+        while( m_first )
+        {
+            Node* next = m_first->next.load( boost::memory_order_relaxed );
+            delete m_first;
+            m_first = next;
+        }
+    }
+
+    /**
+     * @brief Append value to the queue, called by the producer
+     *
+     * The element is exchanged with value using its swap() method, which
+     * leaves value default constructed.
+     *
+     * @param value Element to append
+     */
+    void push( T& value )
+    {
+        Node* node = allocNode();
+        node->value.swap( value );
+        node->next.store( nullptr, boost::memory_order_relaxed );
+        m_head->next.store( node, boost::memory_order_release );
+        m_head = node;
+    }
+
+    /**
+     * @brief Extract the front element, called by the consumer
+     *
+     * The element is exchanged with value using its swap() method. The
+     * content of value is thus left in the node until it is recycled.
+     *
+     * @param[out] value Element extracted from the queue
+     * @return false if the queue is empty
+     */
+    bool pop( T& value )
+    {
+        Node* tail = m_tail.load( boost::memory_order_relaxed );
+        Node* next = tail->next.load( boost::memory_order_acquire );
+        if( next == nullptr )
+            return false;
+        value.swap( next->value );
+        m_tail.store( next, boost::memory_order_release );
+        return true;
+    }
+
+private:
+    /// Queue node holding an element
+    struct Node
+    {
+        Node() : next( nullptr ) {}
+
+        boost::atomic<Node*> next; ///< Next node in the queue
+        T value;                   ///< Element held by the node
+    };
+
+    /// Return a node released by the consumer or a new node
+    Node* allocNode()
+    {
+        if( m_first == m_tailCopy )
+        {
+            m_tailCopy = m_tail.load( boost::memory_order_acquire );
+            if( m_first == m_tailCopy )
+                return new Node();
+        }
+        Node* node = m_first;
+        m_first = m_first->next.load( boost::memory_order_relaxed );
+        node->value = T();
+        return node;
+    }
+
+    // Non copyable
+    SpscQueue( const SpscQueue& );
+    SpscQueue& operator=( const SpscQueue& );
+
+    boost::atomic<Node*> m_tail; ///< Stub node, updated by the consumer
+    char m_padding[64];          ///< Keep producer data out of m_tail line
+    Node* m_head;                ///< Last pushed node
+    Node* m_first;               ///< First node that may be recycled
+    Node* m_tailCopy;            ///< Last known m_tail value
+};
+
+} // namespace MPO
+
+#endif // SPSCQUEUE_HPP
@@ -0,0 +1,516 @@
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+#include <stdexcept>
+#include <boost/shared_ptr.hpp>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#define MPO_HAS_SOCKETS
+#endif
+
+#include "TcpTransport.hpp"
+#include "Link.hpp"
+
+namespace MPO
+{
+    namespace
+    {
+        // Header of a record
+        struct WireHeader
+        {
+            boost::uint32_t size;  // Size of the payload
+            boost::uint16_t route; // Route id or ControlRoute
+            boost::uint16_t type;  // Type id or kind of control record
+        };
+
+        // Route of the control records, whose type is their kind
+        const boost::uint16_t ControlRoute = 0xffff;
+        const boost::uint16_t DeclareRoute = 0; // route id and Slot name
+        const boost::uint16_t DeclareType = 1;  // type id and wire id
+
+        // Encodings smaller than this are copied rather than referenced
+        const size_t MinView = 256;
+
+        // Size of the reads of a connection
+        const size_t ReadSize = 64 * 1024;
+
+        // Largest record accepted from a peer
+        const size_t MaxRecord = size_t( 1 ) << 30;
+
+#ifdef MPO_HAS_SOCKETS
+#  ifdef MSG_NOSIGNAL
+        const int SendFlags = MSG_NOSIGNAL;
+#  else
+        const int SendFlags = 0;
+#  endif
+#  ifdef IOV_MAX
+        const size_t MaxSegments = IOV_MAX;
+#  else
+        const size_t MaxSegments = 1024;
+#  endif
+
+        // Set a socket non blocking
+        void setNonBlocking( int fd )
+        {
+            fcntl( fd, F_SETFL, fcntl( fd, F_GETFL, 0 ) | O_NONBLOCK );
+        }
+#endif
+
+        // Split "node/name" in its node and name, the node of a name
+        // without node is empty
+        void splitPath( const std::string& path, std::string& node,
+                        std::string& name )
+        {
+            size_t slash = path.find( '/' );
+            if( slash == std::string::npos )
+            {
+                node.clear();
+                name = path;
+                return;
+            }
+            node = path.substr( 0, slash );
+            name = path.substr( slash + 1 );
+        }
+    }
+
+    // Outgoing connection batching the records of its RemoteSlots
+    struct TcpNode::Peer : public RemoteSlot::Sink
+    {
+        // Range of the staging buffer, or of a held Message if data is set
+        struct Segment
+        {
+            const char* data;
+            size_t offset;
+            size_t size;
+        };
+
+        Peer( TcpNode& node, int fd ) : node( node ), fd( fd ), pending( 0 ) {}
+
+        virtual ~Peer()
+        {
+            for( size_t i = 0; i < slots.size(); ++i )
+                delete slots[i];
+#ifdef MPO_HAS_SOCKETS
+            close( fd );
+#endif
+        }
+
+        // Return the RemoteSlot of a Slot of the peer, announced on first use
+        RemoteSlot* route( const std::string& slotName )
+        {
+            RemoteSlot*& slot = routes[slotName];
+            if( !slot )
+            {
+                if( slots.size() >= ControlRoute )
+                    throw std::runtime_error( "TcpNode too many routes to " + slotName );
+                boost::uint16_t id = boost::uint16_t( slots.size() );
+                slot = new RemoteSlot( *this, id, slotName );
+                slots.push_back( slot );
+                char* data = header( ControlRoute, DeclareRoute,
+                                     sizeof(id) + slotName.size() );
+                std::memcpy( data, &id, sizeof(id) );
+                std::memcpy( data + sizeof(id), slotName.data(), slotName.size() );
+            }
+            return slot;
+        }
+
+        // Return the compact id of a type, announced on first use
+        boost::uint16_t type( const MessageCodec::Codec& codec )
+        {
+            std::map<const MessageCodec::Codec*, boost::uint16_t>::const_iterator
+                it = types.find( &codec );
+            if( it != types.end() )
+                return it->second;
+            if( types.size() >= 0xffff )
+                throw std::runtime_error( "TcpNode too many types" );
+            boost::uint16_t id = boost::uint16_t( types.size() );
+            types[&codec] = id;
+            char* data = header( ControlRoute, DeclareType,
+                                 sizeof(id) + sizeof(codec.id) );
+            std::memcpy( data, &id, sizeof(id) );
+            std::memcpy( data + sizeof(id), &codec.id, sizeof(codec.id) );
+            return id;
+        }
+
+        // Append n bytes to the staging buffer, extending its last segment
+        char* append( size_t n )
+        {
+            size_t offset = staging.size();
+            staging.resize( offset + n );
+            if( segments.empty() || segments.back().data )
+            {
+                Segment s = { nullptr, offset, n };
+                segments.push_back( s );
+            }
+            else
+                segments.back().size += n;
+            pending += n;
+            return &staging[offset];
+        }
+
+        // Append a record header, return the payload if staged
+        char* header( boost::uint16_t route, boost::uint16_t type, size_t size,
+                      bool staged = true )
+        {
+            WireHeader h = { boost::uint32_t( size ), route, type };
+            char* data = append( sizeof(h) + ( staged ? size : 0 ) );
+            std::memcpy( data, &h, sizeof(h) );
+            return data + sizeof(h);
+        }
+
+        // Reference a large view, encode the others in the staging buffer
+        virtual void send( boost::uint32_t route, const Message::Ptr& msg,
+                           const MessageCodec::Codec& codec )
+        {
+            boost::uint16_t id = type( codec );
+            size_t size = 0;
+            const void* view = codec.view ? codec.view( *msg, size ) : nullptr;
+            if( view && size >= MinView )
+            {
+                header( boost::uint16_t( route ), id, size, false );
+                Segment s = { static_cast<const char*>( view ), 0, size };
+                segments.push_back( s );
+                held.push_back( msg );
+                pending += size;
+            }
+            else
+            {
+                size = codec.encode( *msg, nullptr, 0 );
+                codec.encode( *msg, header( boost::uint16_t( route ), id, size ),
+                              size );
+            }
+            if( pending >= node.m_batchSize )
+                flush();
+        }
+
+        // Write the batch with scatter/gather writes of up to MaxSegments
+        void flush()
+        {
+            if( segments.empty() )
+                return;
+#ifdef MPO_HAS_SOCKETS
+            iov.resize( segments.size() );
+            for( size_t i = 0; i < segments.size(); ++i )
+            {
+                const Segment& s = segments[i];
+                iov[i].iov_base = const_cast<char*>( s.data ? s.data
+                                                            : &staging[s.offset] );
+                iov[i].iov_len = s.size;
+            }
+            size_t i = 0;
+            while( i < iov.size() )
+            {
+                msghdr m;
+                std::memset( &m, 0, sizeof(m) );
+                m.msg_iov = &iov[i];
+                m.msg_iovlen = std::min( iov.size() - i, MaxSegments );
+                ssize_t written = sendmsg( fd, &m, SendFlags );
+                if( written < 0 )
+                {
+                    if( errno == EINTR )
+                        continue;
+                    throw std::runtime_error( "TcpNode can't write to a peer" );
+                }
+                ++node.m_nbrWrites;
+                size_t w = size_t( written );
+                while( w && w >= iov[i].iov_len )
+                    w -= iov[i++].iov_len;
+                if( w )
+                {
+                    iov[i].iov_base = static_cast<char*>( iov[i].iov_base ) + w;
+                    iov[i].iov_len -= w;
+                }
+            }
+#endif
+            staging.clear();
+            segments.clear();
+            held.clear();
+            pending = 0;
+        }
+
+        TcpNode& node;                             // Node of the peer
+        int fd;                                    // Connected socket
+        std::vector<char> staging;                 // Headers and copied payloads
+        std::vector<Segment> segments;             // Ranges of the batch
+        std::vector<Message::Ptr> held;            // Message of the referenced views
+        size_t pending;                            // Bytes of the batch
+        std::vector<RemoteSlot*> slots;            // RemoteSlots by route id
+        std::map<std::string, RemoteSlot*> routes; // RemoteSlots by Slot name
+        std::map<const MessageCodec::Codec*, boost::uint16_t> types; // Type ids
+#ifdef MPO_HAS_SOCKETS
+        std::vector<iovec> iov;                    // Segments of a write
+#endif
+    };
+
+    // Incoming connection with the routes and types announced by its peer
+    struct TcpNode::Connection
+    {
+        Connection( int fd ) : fd( fd ), input( ReadSize ), begin( 0 ), end( 0 ) {}
+
+        ~Connection()
+        {
+            for( size_t i = 0; i < signals.size(); ++i )
+                delete signals[i];
+#ifdef MPO_HAS_SOCKETS
+            close( fd );
+#endif
+        }
+
+        int fd;                                       // Accepted socket
+        std::vector<char> input;                      // Received bytes
+        size_t begin;                                 // First unparsed byte
+        size_t end;                                   // End of received bytes
+        std::vector<Signal<Message>*> signals;        // Signals by route id
+        std::vector<const MessageCodec::Codec*> codecs; // Codecs by type id
+    };
+
+    TcpNode::TcpNode( const std::string& name, unsigned short port,
+                      Domain& domain ) :
+        m_name( name ), m_domain( domain ), m_listener( -1 ), m_port( 0 ),
+        m_batchSize( 64 * 1024 ), m_nbrWrites( 0 ), m_nbrDropped( 0 )
+    {
+#ifdef MPO_HAS_SOCKETS
+        m_listener = socket( AF_INET, SOCK_STREAM, 0 );
+        if( m_listener < 0 )
+            throw std::runtime_error( "TcpNode can't create a socket" );
+        int on = 1;
+        setsockopt( m_listener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on) );
+        sockaddr_in address;
+        std::memset( &address, 0, sizeof(address) );
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl( INADDR_ANY );
+        address.sin_port = htons( port );
+        socklen_t length = sizeof(address);
+        if( bind( m_listener, reinterpret_cast<sockaddr*>( &address ),
+                  sizeof(address) ) != 0 ||
+            listen( m_listener, 16 ) != 0 ||
+            getsockname( m_listener, reinterpret_cast<sockaddr*>( &address ),
+                         &length ) != 0 )
+        {
+            close( m_listener );
+            throw std::runtime_error( "TcpNode " + name + " can't listen" );
+        }
+        setNonBlocking( m_listener );
+        m_port = ntohs( address.sin_port );
+#else
+        throw std::runtime_error( "TcpNode requires POSIX sockets" );
+#endif
+    }
+
+    TcpNode::~TcpNode()
+    {
+        for( std::map<std::string, Peer*>::iterator it = m_peers.begin();
+             it != m_peers.end(); ++it )
+            delete it->second;
+        for( size_t i = 0; i < m_connections.size(); ++i )
+            delete m_connections[i];
+#ifdef MPO_HAS_SOCKETS
+        close( m_listener );
+#endif
+    }
+
+    // Try the addresses of host until one connects
+    void TcpNode::addPeer( const std::string& name, const std::string& host,
+                           unsigned short port )
+    {
+#ifdef MPO_HAS_SOCKETS
+        addrinfo hints;
+        std::memset( &hints, 0, sizeof(hints) );
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        char service[8];
+        std::sprintf( service, "%u", unsigned( port ) );
+        addrinfo* addresses = nullptr;
+        if( getaddrinfo( host.c_str(), service, &hints, &addresses ) != 0 )
+            throw std::runtime_error( "TcpNode can't resolve " + host );
+        int fd = -1;
+        for( addrinfo* a = addresses; a && fd < 0; a = a->ai_next )
+        {
+            fd = socket( a->ai_family, a->ai_socktype, a->ai_protocol );
+            if( fd >= 0 && ::connect( fd, a->ai_addr, a->ai_addrlen ) != 0 )
+            {
+                close( fd );
+                fd = -1;
+            }
+        }
+        freeaddrinfo( addresses );
+        if( fd < 0 )
+            throw std::runtime_error( "TcpNode can't connect to " + name );
+        // The batches are the unit of transmission
+        int on = 1;
+        setsockopt( fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on) );
+        Peer*& peer = m_peers[name];
+        delete peer;
+        peer = new Peer( *this, fd );
+#else
+        (void)name;
+        (void)host;
+        (void)port;
+#endif
+    }
+
+    bool TcpNode::connect( const std::string& signalPath,
+                           const std::string& slotPath )
+    {
+        std::string signalNode, signalName, slotNode, slotName;
+        splitPath( signalPath, signalNode, signalName );
+        splitPath( slotPath, slotNode, slotName );
+        if( !signalNode.empty() && signalNode != m_name )
+            return false;
+        AnySignal* signal = AnySignal::get( signalName );
+        if( slotNode.empty() || slotNode == m_name )
+            return Link::connect( signal, AnySlot::get( slotName ) );
+        std::map<std::string, Peer*>::const_iterator it = m_peers.find( slotNode );
+        if( !signal || it == m_peers.end() )
+            return false;
+        return Link::connect( signal, it->second->route( slotName ) );
+    }
+
+    void TcpNode::flush()
+    {
+        for( std::map<std::string, Peer*>::iterator it = m_peers.begin();
+             it != m_peers.end(); ++it )
+            it->second->flush();
+    }
+
+    // The closed connections are deleted with their Signals
+    size_t TcpNode::poll()
+    {
+        flush();
+        size_t n = 0;
+#ifdef MPO_HAS_SOCKETS
+        for( ;; )
+        {
+            int fd = accept( m_listener, nullptr, nullptr );
+            if( fd < 0 )
+                break;
+            setNonBlocking( fd );
+            m_connections.push_back( new Connection( fd ) );
+        }
+#endif
+        for( size_t i = 0; i < m_connections.size(); )
+        {
+            if( receive( *m_connections[i], n ) )
+                ++i;
+            else
+            {
+                delete m_connections[i];
+                m_connections.erase( m_connections.begin() + i );
+            }
+        }
+        return n;
+    }
+
+    // Parse the complete records after each read until none is available
+    bool TcpNode::receive( Connection& c, size_t& n )
+    {
+#ifdef MPO_HAS_SOCKETS
+        for( ;; )
+        {
+            if( c.input.size() - c.end < ReadSize / 4 )
+            {
+                // Move the partial record at the start or grow the buffer
+                if( c.begin )
+                {
+                    std::copy( c.input.begin() + c.begin, c.input.begin() + c.end,
+                               c.input.begin() );
+                    c.end -= c.begin;
+                    c.begin = 0;
+                }
+                if( c.input.size() - c.end < ReadSize / 4 )
+                    c.input.resize( c.input.size() + ReadSize );
+            }
+            ssize_t r = recv( c.fd, &c.input[c.end], c.input.size() - c.end, 0 );
+            if( r == 0 )
+                return false;
+            if( r < 0 )
+            {
+                if( errno == EINTR )
+                    continue;
+                return errno == EAGAIN || errno == EWOULDBLOCK;
+            }
+            c.end += size_t( r );
+            while( c.end - c.begin >= sizeof(WireHeader) )
+            {
+                WireHeader h;
+                std::memcpy( &h, &c.input[c.begin], sizeof(h) );
+                if( h.size > MaxRecord )
+                    return false;
+                size_t size = sizeof(h) + h.size;
+                if( c.end - c.begin < size )
+                {
+                    if( c.input.size() - c.begin < size )
+                        c.input.resize( c.begin + size );
+                    break;
+                }
+                // Skipped first so that a decoding failure drops the record
+                const char* data = &c.input[c.begin + sizeof(h)];
+                c.begin += size;
+                handle( c, h.route, h.type, data, h.size, n );
+            }
+            if( c.begin == c.end )
+                c.begin = c.end = 0;
+        }
+#else
+        (void)c;
+        (void)n;
+        return false;
+#endif
+    }
+
+    // A route of a Slot unknown in this process stays null
+    void TcpNode::handle( Connection& c, boost::uint16_t route,
+                          boost::uint16_t type, const char* data, size_t size,
+                          size_t& n )
+    {
+        if( route == ControlRoute )
+        {
+            boost::uint16_t id;
+            if( size < sizeof(id) )
+                return;
+            std::memcpy( &id, data, sizeof(id) );
+            if( type == DeclareRoute )
+            {
+                if( id >= c.signals.size() )
+                    c.signals.resize( id + 1, nullptr );
+                AnySlot* slot = AnySlot::get(
+                    std::string( data + sizeof(id), size - sizeof(id) ) );
+                if( !slot || c.signals[id] )
+                    return;
+                Signal<Message>* signal = new Signal<Message>();
+                signal->setDomain( m_domain );
+                Link::connect( signal, slot );
+                c.signals[id] = signal;
+            }
+            else if( type == DeclareType && size == sizeof(id) + sizeof(boost::uint64_t) )
+            {
+                boost::uint64_t wireId;
+                std::memcpy( &wireId, data + sizeof(id), sizeof(wireId) );
+                if( id >= c.codecs.size() )
+                    c.codecs.resize( id + 1, nullptr );
+                c.codecs[id] = MessageCodec::find( wireId );
+            }
+            return;
+        }
+        const MessageCodec::Codec* codec = type < c.codecs.size() ? c.codecs[type]
+                                                                  : nullptr;
+        Signal<Message>* signal = route < c.signals.size() ? c.signals[route]
+                                                           : nullptr;
+        if( !codec || !signal )
+        {
+            ++m_nbrDropped;
+            return;
+        }
+        signal->emit( codec->decode( data, size ) );
+        ++n;
+    }
+}
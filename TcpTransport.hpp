@@ -0,0 +1,177 @@
+#ifndef TCPTRANSPORT_HPP
+#define TCPTRANSPORT_HPP
+
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/cstdint.hpp>
+
+#include "RemoteSlot.hpp"
+#include "Signal.hpp"
+#include "Domain.hpp"
+
+namespace MPO
+{
+
+/**
+    @brief Node of an Action network distributed over TCP connections
+
+    Each process hosting a part of the network runs a named TcpNode, which
+    listens for the connections of the other nodes and connects to its
+    peers. A connection is given with the node of the Signal and of the
+    Slot, the local parts are looked up with AnySignal::get() and
+    AnySlot::get().
+
+    @code
+        // Process of nodeA
+        TcpNode node( "nodeA" );
+        node.addPeer( "nodeB", "10.0.0.2", 7000 );
+        node.connect( "nodeA/Ping::output", "nodeB/Pong::input" );
+
+        // Process of nodeB
+        TcpNode node( "nodeB", 7000 );
+        while( ... )
+        {
+            node.poll();
+            ...
+        }
+    @endcode
+
+    A Message emitted to a remote Slot is encoded with the codec of its type
+    in the batch of its peer. A record has an 8 byte header holding its
+    size and the compact ids of its route and type, which are announced once
+    per connection by control records. The encoding of a codec with a viewer
+    isn't copied: the batch references it and keeps the Message until
+    written. The batch is written with a single scatter/gather write when it
+    reaches the batch size or when flush() or poll() is called. The write
+    blocks the thread until the kernel accepts the batch.
+
+    The nodes must have the same byte order, since the headers and the
+    trivial codecs are written in the host order. The methods of a TcpNode
+    are called by the thread processing the Domain of its Signals, the
+    bridged Signals must belong to that Domain.
+*/
+class TcpNode
+{
+public:
+    /**
+     * @brief Constructor listening for the connections of the peers
+     *
+     * @param name Name of the node
+     * @param port Port to listen on, 0 for a port chosen by the system
+     * @param domain Domain of the Signals emitting the received Message
+     * @throw std::runtime_error if the port can't be bound
+     */
+    TcpNode( const std::string& name, unsigned short port = 0,
+             Domain& domain = Domain::main() );
+
+    /// Destructor closing the connections and disconnecting the Signals
+    ~TcpNode();
+
+    /**
+     * @brief Open the connection to a peer node
+     *
+     * @param name Name of the peer node
+     * @param host Host name or address of the peer
+     * @param port Port the peer listens on
+     * @throw std::runtime_error if the connection fails
+     */
+    void addPeer( const std::string& name, const std::string& host,
+                  unsigned short port );
+
+    /**
+     * @brief Establish a connection given as "node/Signal" to "node/Slot"
+     *
+     * A connection between two local parts is a regular Link, a local
+     * Signal is bridged to the Slot of a peer, and a connection from a
+     * Signal of another node is established by that node.
+     *
+     * @param signalPath Node and name of the Signal
+     * @param slotPath Node and name of the Slot
+     * @return false if the Signal or the Slot or the peer is unknown, or
+     *         the Signal isn't local
+     */
+    bool connect( const std::string& signalPath, const std::string& slotPath );
+
+    /**
+     * @brief Write the batches of the peers
+     *
+     * @throw std::runtime_error if a connection failed
+     */
+    void flush();
+
+    /**
+     * @brief Flush the batches, accept connections and emit the Message
+     *        received from the peers
+     *
+     * @return the number of emitted Message
+     */
+    size_t poll();
+
+    /**
+     * @brief Set the number of bytes of a batch triggering its write
+     *
+     * @param size Size of the batches, 64 KiB by default
+     */
+    void setBatchSize( size_t size ) { m_batchSize = size; }
+
+    /**
+     * @brief Return the name of the node
+     *
+     * @return the node name
+     */
+    const std::string& name() const { return m_name; }
+
+    /**
+     * @brief Return the port the node listens on
+     *
+     * @return the listening port
+     */
+    unsigned short port() const { return m_port; }
+
+    /**
+     * @brief Return the number of scatter/gather writes
+     *
+     * @return the number of writes of the batches
+     */
+    size_t nbrWrites() const { return m_nbrWrites; }
+
+    /**
+     * @brief Return the number of dropped records
+     *
+     * @return the number of received records of unknown types or routes
+     */
+    size_t nbrDropped() const { return m_nbrDropped; }
+
+    /// Outgoing connection to a peer, defined in TcpTransport.cpp
+    struct Peer;
+
+    /// Incoming connection from a peer, defined in TcpTransport.cpp
+    struct Connection;
+
+private:
+    /// Read the available bytes of a connection and emit its Message
+    bool receive( Connection& connection, size_t& n );
+
+    /// Handle a complete record of a connection
+    void handle( Connection& connection, boost::uint16_t route,
+                 boost::uint16_t type, const char* data, size_t size, size_t& n );
+
+    // Non copyable
+    TcpNode( const TcpNode& );
+    TcpNode& operator=( const TcpNode& );
+
+    std::string m_name;                    ///< Name of the node
+    Domain& m_domain;                      ///< Domain of the Signals
+    int m_listener;                        ///< Listening socket
+    unsigned short m_port;                 ///< Listening port
+    size_t m_batchSize;                    ///< Bytes triggering a write
+    std::map<std::string, Peer*> m_peers;  ///< Peers by name
+    std::vector<Connection*> m_connections; ///< Accepted connections
+    size_t m_nbrWrites;                    ///< Number of writes
+    size_t m_nbrDropped;                   ///< Number of dropped records
+};
+
+} // namespace MPO
+
+#endif // TCPTRANSPORT_HPP
@@ -0,0 +1,170 @@
+#include <algorithm>
+#include <new>
+#include <stdexcept>
+#include <utility>
+#include <boost/unordered_map.hpp>
+
+#include "Topology.hpp"
+#include "Action.hpp"
+
+namespace MPO
+{
+    // Reserve the link vectors of a port for a run of new links, growing
+    // them geometrically as push_back would, so that a port occurring in
+    // many short runs is not reallocated for each of them
+    template <class TPort>
+    void Topology::reserveLinks( TPort* port, size_t nbrLinks )
+    {
+        size_t size = port->m_links.size() + nbrLinks;
+        if( size > port->m_links.capacity() )
+            port->m_links.reserve( std::max( size, 2 * port->m_links.capacity() ) );
+    }
+
+    // Add a connection between existing Signal and Slot
+    void Topology::add( AnySignal* signal, AnySlot* slot, bool forceStatic )
+    {
+        if( !signal || !slot )
+            throw std::runtime_error( "Topology::add called with a nullptr" );
+        Connection connection = { signal, slot, forceStatic };
+        m_connections.push_back( connection );
+    }
+
+    // Add a connection between a named Signal and a named Slot
+    void Topology::add( const std::string& signalName,
+                        const std::string& slotName, bool forceStatic )
+    {
+        AnySignal* signal = AnySignal::get( signalName );
+        if( !signal )
+            throw std::runtime_error( "Unknown Signal '" + signalName + "'" );
+        AnySlot* slot = AnySlot::get( slotName );
+        if( !slot )
+            throw std::runtime_error( "Unknown Slot '" + slotName + "'" );
+        add( signal, slot, forceStatic );
+    }
+
+    // Add a connection between ports of named Actions
+    void Topology::add( const std::string& signalAction,
+                        const std::string& signalName,
+                        const std::string& slotAction,
+                        const std::string& slotName, bool forceStatic )
+    {
+        AnySignal* signal = Action::getSignal( signalAction, signalName );
+        if( !signal )
+            throw std::runtime_error( "Unknown Signal '" + signalAction +
+                                      "::" + signalName + "'" );
+        AnySlot* slot = Action::getSlot( slotAction, slotName );
+        if( !slot )
+            throw std::runtime_error( "Unknown Slot '" + slotAction +
+                                      "::" + slotName + "'" );
+        add( signal, slot, forceStatic );
+    }
+
+    // Build the Links in a single block of a GraphMemory released by them
+    size_t Topology::build()
+    {
+        if( m_connections.empty() )
+            return 0;
+        GraphMemory* memory = new GraphMemory(
+                m_connections.size() * GraphMemory::objectSize( sizeof(Link) ) );
+        try
+        {
+            size_t nbrLinks = build( *memory, nullptr );
+            memory->release();
+            return nbrLinks;
+        }
+        catch( ... )
+        {
+            memory->release();
+            throw;
+        }
+    }
+
+    // Build the Links in the memory of the arena
+    size_t Topology::build( GraphArena& arena )
+    {
+        if( m_connections.empty() )
+            return 0;
+        return build( *arena.m_memory, &arena );
+    }
+
+    // Build the Links in memory, adopted by arena if not nullptr
+    size_t Topology::build( GraphMemory& memory, GraphArena* arena )
+    {
+        // Nothing is built if a Signal may not be rewired
+        for( size_t i = 0; i < m_connections.size(); ++i )
+        {
+            const Connection& c = m_connections[i];
+            if( !c.signal->isConnected( *c.slot ) )
+                c.signal->checkUnfrozen();
+        }
+
+        // Reserve the link vectors once per run of connections sharing the
+        // same Signal or Slot, as they are usually listed together
+        for( size_t i = 0, j; i < m_connections.size(); i = j )
+        {
+            AnySignal* signal = m_connections[i].signal;
+            for( j = i + 1; j < m_connections.size() &&
+                            m_connections[j].signal == signal; ++j ) {}
+            reserveLinks( signal, j - i );
+        }
+        for( size_t i = 0, j; i < m_connections.size(); i = j )
+        {
+            AnySlot* slot = m_connections[i].slot;
+            for( j = i + 1; j < m_connections.size() &&
+                            m_connections[j].slot == slot; ++j ) {}
+            reserveLinks( slot, j - i );
+        }
+
+        // Check the cast of each pair of Message types once
+        typedef std::pair<size_t, size_t> TypePair;
+        boost::unordered_map<TypePair, bool> staticCasts;
+        TypePair lastTypes( size_t(-1), size_t(-1) );
+        bool lastStaticCast = false;
+        size_t nbrLinks = 0;
+        for( size_t i = 0; i < m_connections.size(); ++i )
+        {
+            const Connection& c = m_connections[i];
+            if( c.signal->isConnected( *c.slot ) )
+                continue;
+            TypePair types( c.signal->messageType().id(),
+                            c.slot->messageType().id() );
+            if( types != lastTypes )
+            {
+                boost::unordered_map<TypePair, bool>::iterator it =
+                        staticCasts.find( types );
+                if( it == staticCasts.end() )
+                    it = staticCasts.insert( std::make_pair( types,
+                            Link::isStaticCast( *c.signal, *c.slot ) ) ).first;
+                lastTypes = types;
+                lastStaticCast = it->second;
+            }
+            Link* link = new( memory ) Link( *c.signal, *c.slot,
+                                             c.forceStatic || lastStaticCast );
+            c.signal->connect( *c.slot, *link );
+            c.slot->connect( *link );
+            if( arena )
+                arena->adopt( link );
+            if( m_signals.empty() || m_signals.back() != c.signal )
+                m_signals.push_back( c.signal );
+            ++nbrLinks;
+        }
+        m_connections.clear();
+        return nbrLinks;
+    }
+
+    // Freeze each Signal once, the runs of its connections may be scattered
+    void Topology::freeze()
+    {
+        std::sort( m_signals.begin(), m_signals.end() );
+        m_signals.erase( std::unique( m_signals.begin(), m_signals.end() ),
+                         m_signals.end() );
+        for( size_t i = 0; i < m_signals.size(); ++i )
+            m_signals[i]->freeze();
+    }
+
+    void Topology::unfreeze()
+    {
+        for( size_t i = 0; i < m_signals.size(); ++i )
+            m_signals[i]->unfreeze();
+    }
+}
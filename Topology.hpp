@@ -0,0 +1,175 @@
+#ifndef TOPOLOGY_HPP
+#define TOPOLOGY_HPP
+
+#include <string>
+#include <vector>
+
+#include "Link.hpp"
+
+namespace MPO
+{
+
+/**
+    @brief Builder of a network of Links from a list of connections
+
+    A Topology collects the connections of a network, typically read from a
+    configuration file, and builds all their Links at once. Compared to a
+    Link::connect() call per connection, the build
+
+    @li reserves the link vectors of the Signals and Slots once per run of
+        consecutive connections sharing them,
+    @li allocates all Links in a single block of memory,
+    @li checks if a static cast is possible once per pair of Signal and
+        Slot Message types instead of once per Link.
+
+    @code
+        Topology topology;
+        topology.reserve( lines.size() );
+        for( ... )
+            topology.add( signalName, slotName );
+        topology.build();
+    @endcode
+
+    The Links built by a Topology behave as any other Link and may be
+    deleted or disconnected individually. The block of memory holding them
+    is released when the last of them is deleted, unless they are built in a
+    GraphArena tearing them down at once. The Topology may be destroyed or
+    reused once built.
+
+    Once the network is configured, freeze() compiles the dispatch plans of
+    the Signals of the built Links.
+*/
+class Topology
+{
+public:
+    /// Constructor of an empty Topology
+    Topology() {}
+
+    /**
+     * @brief Reserve memory for n connections
+     *
+     * @param n Number of connections that will be added
+     */
+    void reserve( size_t n ) { m_connections.reserve( n ); }
+
+    /**
+     * @brief Add a connection from a Signal to a Slot
+     *
+     * @param signal Signal to connect from
+     * @param slot Slot to connect to
+     * @param forceStatic true if a static cast must always be performed
+     * @throws runtime_error if signal or slot is a nullptr
+     */
+    void add( AnySignal* signal, AnySlot* slot, bool forceStatic = false );
+
+    /**
+     * @brief Add a connection from a named Signal to a named Slot
+     *
+     * @param signalName Name of Signal to connect from
+     * @param slotName Name of Slot to connect to
+     * @param forceStatic true if a static cast must always be performed
+     * @throws runtime_error if the Signal or the Slot is not found
+     */
+    void add( const std::string& signalName, const std::string& slotName,
+              bool forceStatic = false );
+
+    /**
+     * @brief Add a connection from a Signal of an Action to a Slot of an
+     *        Action
+     *
+     * @param signalAction Name of the Action owning the Signal
+     * @param signalName Name of the Signal in its Action
+     * @param slotAction Name of the Action owning the Slot
+     * @param slotName Name of the Slot in its Action
+     * @param forceStatic true if a static cast must always be performed
+     * @throws runtime_error if the Signal or the Slot is not found
+     */
+    void add( const std::string& signalAction, const std::string& signalName,
+              const std::string& slotAction, const std::string& slotName,
+              bool forceStatic = false );
+
+    /**
+     * @brief Return the number of connections added since the last build
+     *
+     * @return the number of pending connections
+     */
+    size_t size() const { return m_connections.size(); }
+
+    /**
+     * @brief Build the Links of the added connections and clear them
+     *
+     * Connections that already exist are skipped.
+     *
+     * @return the number of Links created
+     * @throws runtime_error if the Signal of a new Link is frozen
+     */
+    size_t build();
+
+    /**
+     * @brief Build the Links of the added connections in a GraphArena and
+     *        clear them
+     *
+     * The Links are torn down with the arena.
+     *
+     * @param arena GraphArena holding the Links
+     * @return the number of Links created
+     * @throws runtime_error if the Signal of a new Link is frozen
+     */
+    size_t build( GraphArena& arena );
+
+    /// Remove the added connections without building them
+    void clear() { m_connections.clear(); }
+
+    /**
+     * @brief Freeze the Signals of the built Links
+     *
+     * Each Signal connected by a build of the Topology compiles its Links
+     * into a dispatch plan and may not be rewired until unfreeze() is
+     * called. The Signals must not be destroyed while the Topology may
+     * unfreeze them.
+     *
+     * @see AnySignal::freeze()
+     */
+    void freeze();
+
+    /// Unfreeze the Signals of the built Links to permit rewiring them
+    void unfreeze();
+
+private:
+    /// Connection to build
+    struct Connection
+    {
+        AnySignal* signal; ///< Signal to connect from
+        AnySlot* slot;     ///< Slot to connect to
+        bool forceStatic;  ///< True if a static cast must be performed
+    };
+
+    /**
+     * @brief Reserve the link vector of a Signal or a Slot
+     *
+     * @param port Signal or Slot to connect
+     * @param nbrLinks Number of new links of port
+     */
+    template <class TPort>
+    static void reserveLinks( TPort* port, size_t nbrLinks );
+
+    /**
+     * @brief Build the Links of the added connections in memory
+     *
+     * @param memory GraphMemory of the Links
+     * @param arena GraphArena adopting the Links or nullptr
+     * @return the number of Links created
+     */
+    size_t build( GraphMemory& memory, GraphArena* arena );
+
+    // Non copyable
+    Topology( const Topology& );
+    Topology& operator=( const Topology& );
+
+    std::vector<Connection> m_connections; ///< Connections to build
+    std::vector<AnySignal*> m_signals;     ///< Signals of the built Links
+};
+
+} // namespace MPO
+
+#endif // TOPOLOGY_HPP
@@ -0,0 +1,244 @@
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <boost/chrono.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/lock_guard.hpp>
+#include <boost/thread/tss.hpp>
+
+#if defined(__x86_64__) || defined(__i386__)
+#  if defined(_MSC_VER)
+#    include <intrin.h>
+#  else
+#    include <x86intrin.h>
+#  endif
+#  define MPO_HAS_TSC
+#endif
+
+#include "Trace.hpp"
+#include "Link.hpp"
+
+namespace MPO
+{
+    // Ring buffer of the records of a thread, written by the thread only
+    struct Trace::Buffer
+    {
+        Buffer( size_t capacity, boost::uint32_t index ) :
+            records( capacity ), mask( capacity - 1 ), written(0), flushed(0),
+            index(index) {}
+
+        std::vector<TraceRecord> records;      ///< Ring of records
+        size_t mask;                           ///< Capacity minus 1
+        boost::atomic<boost::uint64_t> written; ///< Number of records written
+        boost::uint64_t flushed;               ///< Records written when flushed
+        std::vector<const TypeDef*> types;     ///< Recorded types by id
+        boost::uint32_t index;                 ///< Index of the thread
+    };
+
+    namespace
+    {
+        // Buffers of all threads, kept when their thread exits
+        struct Registry
+        {
+            Registry() : capacity(65536), baseTicks(0) {}
+
+            boost::mutex mutex;
+            std::vector<Trace::Buffer*> buffers;
+            size_t capacity;
+            boost::uint64_t baseTicks;
+            boost::chrono::steady_clock::time_point baseTime;
+        };
+
+        // Registry never deleted so that threads may record until exit
+        Registry& registry()
+        {
+            static Registry* r = new Registry();
+            return *r;
+        }
+
+        // The buffers are owned by the registry, not by their thread
+        void keepBuffer( Trace::Buffer* ) {}
+
+        // Write n bytes in file or throw
+        void write( std::FILE* file, const void* data, size_t n )
+        {
+            if( n && std::fwrite( data, 1, n, file ) != n )
+            {
+                std::fclose( file );
+                throw std::runtime_error( "Trace can't write its file" );
+            }
+        }
+
+        // Write a string preceded by its length
+        void writeString( std::FILE* file, const std::string& s )
+        {
+            boost::uint32_t n = boost::uint32_t( s.size() );
+            write( file, &n, sizeof(n) );
+            write( file, s.data(), n );
+        }
+    }
+
+    boost::atomic<bool> Trace::m_enabled( false );
+
+    // Read the time stamp counter, or the steady clock without one
+    boost::uint64_t Trace::ticks()
+    {
+#ifdef MPO_HAS_TSC
+        return __rdtsc();
+#else
+        return boost::chrono::duration_cast<boost::chrono::nanoseconds>(
+            boost::chrono::steady_clock::now().time_since_epoch() ).count();
+#endif
+    }
+
+    // Record the base time to calibrate the ticks and start recording
+    void Trace::enable( size_t capacity )
+    {
+        Registry& r = registry();
+        {
+            boost::lock_guard<boost::mutex> lock( r.mutex );
+            size_t rounded = 1;
+            while( rounded < capacity )
+                rounded <<= 1;
+            r.capacity = rounded;
+            r.baseTicks = ticks();
+            r.baseTime = boost::chrono::steady_clock::now();
+        }
+        m_enabled.store( true, boost::memory_order_release );
+    }
+
+    // Stop recording
+    void Trace::disable()
+    {
+        m_enabled.store( false, boost::memory_order_release );
+    }
+
+    // Return the buffer of the thread, registering it on first call
+    Trace::Buffer& Trace::buffer()
+    {
+        static boost::thread_specific_ptr<Buffer> local( &keepBuffer );
+        Buffer* b = local.get();
+        if( !b )
+        {
+            Registry& r = registry();
+            boost::lock_guard<boost::mutex> lock( r.mutex );
+            b = new Buffer( r.capacity, boost::uint32_t( r.buffers.size() ) );
+            r.buffers.push_back( b );
+            local.reset( b );
+        }
+        return *b;
+    }
+
+    // Append a record to the ring of the thread, overwriting the oldest
+    void Trace::record( TraceRecord::Event event, const Link* link,
+                        const AnySlot* slot, const TypeDef& type,
+                        size_t priority, size_t count )
+    {
+        Buffer& b = buffer();
+        size_t id = type.id();
+        if( id >= b.types.size() || !b.types[id] )
+        {
+            // Types are registered under the lock read by flush()
+            boost::lock_guard<boost::mutex> lock( registry().mutex );
+            if( id >= b.types.size() )
+                b.types.resize( id + 1, nullptr );
+            b.types[id] = &type;
+        }
+        boost::uint64_t n = b.written.load( boost::memory_order_relaxed );
+        TraceRecord& r = b.records[n & b.mask];
+        r.ticks = ticks();
+        r.link = reinterpret_cast<boost::uint64_t>( link );
+        r.slot = reinterpret_cast<boost::uint64_t>( slot );
+        r.type = boost::uint32_t( id );
+        r.event = boost::uint8_t( event );
+        r.priority = boost::uint8_t( priority );
+        r.count = boost::uint16_t( count < 0xffff ? count : 0xffff );
+        b.written.store( n + 1, boost::memory_order_release );
+    }
+
+    // Record the Enqueue events of an emitted Message
+    void Trace::recordEmit( Link* const* links, size_t n, const TypeDef& type )
+    {
+        for( size_t i = 0; i < n; ++i )
+            record( TraceRecord::Enqueue, links[i], links[i]->m_slot, type,
+                    links[i]->m_priority );
+    }
+
+    // Write the header, the names and the records not flushed yet of
+    // each thread
+    size_t Trace::flush( const std::string& path )
+    {
+        Registry& r = registry();
+        boost::lock_guard<boost::mutex> lock( r.mutex );
+        std::FILE* file = std::fopen( path.c_str(), "wb" );
+        if( !file )
+            throw std::runtime_error( "Trace can't open " + path );
+
+        // Collect the types of all threads
+        std::vector<const TypeDef*> types;
+        for( size_t i = 0; i < r.buffers.size(); ++i )
+        {
+            const std::vector<const TypeDef*>& t = r.buffers[i]->types;
+            if( t.size() > types.size() )
+                types.resize( t.size(), nullptr );
+            for( size_t j = 0; j < t.size(); ++j )
+                if( t[j] )
+                    types[j] = t[j];
+        }
+        boost::uint32_t nbrTypes = 0;
+        for( size_t i = 0; i < types.size(); ++i )
+            nbrTypes += types[i] ? 1 : 0;
+
+        TraceFileHeader header;
+        std::memset( &header, 0, sizeof(header) );
+        std::memcpy( header.magic, "MPOTRACE", 8 );
+        header.version = 1;
+        header.nbrThreads = boost::uint32_t( r.buffers.size() );
+        double seconds = boost::chrono::duration<double>(
+            boost::chrono::steady_clock::now() - r.baseTime ).count();
+#ifdef MPO_HAS_TSC
+        header.ticksPerSecond = seconds > 0 ?
+            double( ticks() - r.baseTicks ) / seconds : 1e9;
+#else
+        header.ticksPerSecond = 1e9;
+#endif
+        header.baseTicks = r.baseTicks;
+        header.nbrTypes = nbrTypes;
+        header.nbrSlots = boost::uint32_t( AnySlot::m_slotMap.size() );
+        write( file, &header, sizeof(header) );
+
+        for( size_t i = 0; i < types.size(); ++i )
+            if( types[i] )
+            {
+                boost::uint32_t id = boost::uint32_t( i );
+                write( file, &id, sizeof(id) );
+                writeString( file, types[i]->name() );
+            }
+        for( SlotMap::const_iterator it = AnySlot::m_slotMap.begin();
+             it != AnySlot::m_slotMap.end(); ++it )
+        {
+            boost::uint64_t slot = reinterpret_cast<boost::uint64_t>( it->second );
+            write( file, &slot, sizeof(slot) );
+            writeString( file, it->first );
+        }
+
+        size_t total = 0;
+        for( size_t i = 0; i < r.buffers.size(); ++i )
+        {
+            Buffer& b = *r.buffers[i];
+            boost::uint64_t end = b.written.load( boost::memory_order_acquire );
+            boost::uint64_t begin = std::max( b.flushed,
+                end > b.records.size() ? end - b.records.size() : 0 );
+            boost::uint64_t count = end - begin;
+            write( file, &b.index, sizeof(b.index) );
+            write( file, &count, sizeof(count) );
+            for( boost::uint64_t n = begin; n < end; ++n )
+                write( file, &b.records[n & b.mask], sizeof(TraceRecord) );
+            b.flushed = end;
+            total += size_t( count );
+        }
+        if( std::fclose( file ) != 0 )
+            throw std::runtime_error( "Trace can't write " + path );
+        return total;
+    }
+}
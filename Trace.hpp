@@ -0,0 +1,154 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/atomic.hpp>
+
+namespace MPO
+{
+
+class Link;
+class AnySlot;
+class TypeDef;
+
+/// Event recorded in a trace
+struct TraceRecord
+{
+    /// Kinds of traced events
+    enum Event
+    {
+        Enqueue,       ///< Message queued for a Link by AnySignal::emit()
+        DispatchBegin, ///< Slot method called by the dispatcher
+        DispatchEnd    ///< Slot method returned
+    };
+
+    boost::uint64_t ticks; ///< Time stamp counter when recorded
+    boost::uint64_t link;  ///< Address of the Link, used as its id
+    boost::uint64_t slot;  ///< Address of the Slot, used as its id
+    boost::uint32_t type;  ///< TypeDef id of the Message
+    boost::uint8_t event;  ///< Event kind
+    boost::uint8_t priority; ///< Priority of the Link
+    boost::uint16_t count; ///< Number of Message of a batch dispatch
+};
+
+/// Header of a trace file written by Trace::flush()
+struct TraceFileHeader
+{
+    char magic[8];                  ///< "MPOTRACE"
+    boost::uint32_t version;        ///< Version of the file format, 1
+    boost::uint32_t nbrThreads;     ///< Number of thread sections
+    double ticksPerSecond;          ///< Frequency of the time stamp counter
+    boost::uint64_t baseTicks;      ///< Ticks when tracing was enabled
+    boost::uint32_t nbrTypes;       ///< Number of type names
+    boost::uint32_t nbrSlots;       ///< Number of Slot names
+};
+
+/**
+    @brief Recorder of the enqueue and dispatch events in binary ring buffers
+
+    When enabled, AnySignal::emit() records an Enqueue event per queued Link
+    and the dispatcher records the DispatchBegin and DispatchEnd events
+    around each Slot call. A direct Link calling its Slot at once only
+    records the dispatch events. The records hold the time stamp counter,
+    the Link and Slot addresses, which serve as ids, and the TypeDef id of
+    the Message. Each thread writes in its own ring buffer without lock,
+    which keeps the last records once full, so that a latency spike may be
+    analysed after the fact.
+
+    @code
+        Trace::enable();
+        ...
+        Trace::disable();
+        Trace::flush( "dispatch.trace" );
+    @endcode
+
+    The file is converted in the Chrome trace JSON format, opened by
+    chrome://tracing and Perfetto, with the tools/mpo-trace2json tool. When
+    disabled, each hook costs a single test of a flag, so tracing may stay
+    compiled in production builds.
+
+    The Slot addresses stand for the Action ids since a Slot doesn't know
+    its Action. The names of the Slots registered with AnySlot::setName()
+    and of the Message types are written in the file.
+*/
+class Trace
+{
+public:
+    /**
+     * @brief Start recording events
+     *
+     * @param capacity Number of records of the ring buffer of each thread,
+     *                 rounded up to a power of 2, applied to the threads
+     *                 recording their first event
+     */
+    static void enable( size_t capacity = 65536 );
+
+    /// Stop recording events, the records are kept until flushed
+    static void disable();
+
+    /**
+     * @brief Return true if events are recorded
+     *
+     * @return true if tracing is enabled
+     */
+    static bool isEnabled() { return m_enabled.load( boost::memory_order_relaxed ); }
+
+    /**
+     * @brief Record an event in the ring buffer of the calling thread
+     *
+     * @param event Kind of event
+     * @param link Link of the event
+     * @param slot Slot of the event
+     * @param type TypeDef of the Message
+     * @param priority Priority of the Link
+     * @param count Number of Message of the event
+     */
+    static void record( TraceRecord::Event event, const Link* link,
+                        const AnySlot* slot, const TypeDef& type,
+                        size_t priority, size_t count = 1 );
+
+    /**
+     * @brief Record an Enqueue event for each of n links
+     *
+     * @param links Array of the Links a Message is emitted through
+     * @param n Number of Links
+     * @param type TypeDef of the Message
+     */
+    static void recordEmit( Link* const* links, size_t n, const TypeDef& type );
+
+    /**
+     * @brief Write the records of all threads in a file and clear them
+     *
+     * The records are copied while the threads may still record, a record
+     * overwritten during the copy may then be inconsistent. Flushing after
+     * disable() gives exact records.
+     *
+     * @param path Path of the file to write
+     * @return the number of records written
+     * @throw std::runtime_error if the file can't be written
+     */
+    static size_t flush( const std::string& path );
+
+    /**
+     * @brief Return the time stamp counter, or nanoseconds if unavailable
+     *
+     * @return the current number of ticks
+     */
+    static boost::uint64_t ticks();
+
+    /// Ring buffer of the records of a thread, defined in Trace.cpp
+    struct Buffer;
+
+private:
+    /// Return the ring buffer of the calling thread, created on first call
+    static Buffer& buffer();
+
+    static boost::atomic<bool> m_enabled; ///< True while recording
+};
+
+} // namespace MPO
+
+#endif // TRACE_HPP
@@ -2,6 +2,10 @@
 #define TYPE_HPP
 
 #include <string>
+#include <vector>
+#include <boost/atomic.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/lock_guard.hpp>
 
 #define nullptr NULL
 
@@ -86,24 +90,44 @@ public:
      * @param ptr Pointer on the parent class TypeDef or nullptr if none
      */
     TypeDef( const std::string& name, const TypeDef* ptr = nullptr )
-        : m_name(name), m_parent(ptr) {}
+        : m_name(name), m_parent(ptr), m_id(nextId()), m_depth(0),
+          m_resolved(false) {}
 
     /**
      * @brief Return true if this type is same or subtype of type
      *
+     * The check is a single compare in the display vector of this type,
+     * which holds the ids of its ancestors indexed by their depth.
+     *
      * @param type TypeDef of the class to compare with
      * @return true if this type is same or subtype of type
      */
     bool isSameOrSubtypeOf( const TypeDef* type ) const
     {
-        while( type )
-            if( type->name() == name() )
-                return true;
-            else
-                type = type->parent();
-        return false;
+        if( !type )
+            return false;
+        resolve();
+        type->resolve();
+        return type->m_depth <= m_depth &&
+               m_ancestors[type->m_depth] == type->m_id;
     }
 
+    /**
+     * @brief Return the dense integer id of the type
+     *
+     * Ids are assigned in construction order starting at 0.
+     *
+     * @return the id of the type
+     */
+    size_t id() const { return m_id; }
+
+    /**
+     * @brief Return the number of ancestors of the type
+     *
+     * @return the depth of the type, 0 for a root type
+     */
+    size_t depth() const { resolve(); return m_depth; }
+
     /**
      * @brief Return name of type
      *
@@ -119,8 +143,49 @@ public:
     const TypeDef* parent() const { return m_parent; }
 
 private:
+    /// Return the next type id
+    static size_t nextId()
+    {
+        static boost::atomic<size_t> nbrTypes( 0 );
+        return nbrTypes++;
+    }
+
+    /**
+     * @brief Compute the depth and display vector on first use
+     *
+     * The parent may be defined in another translation unit and not be
+     * constructed yet when this type is, so the hierarchy is only walked
+     * once all static TypeDef are built.
+     */
+    void resolve() const
+    {
+        if( m_resolved.load( boost::memory_order_acquire ) )
+            return;
+        if( m_parent )
+            m_parent->resolve();
+        static boost::mutex mutex;
+        boost::lock_guard<boost::mutex> lock( mutex );
+        if( m_resolved.load( boost::memory_order_relaxed ) )
+            return;
+        if( m_parent )
+        {
+            m_depth = m_parent->m_depth + 1;
+            m_ancestors = m_parent->m_ancestors;
+        }
+        m_ancestors.push_back( m_id );
+        m_resolved.store( true, boost::memory_order_release );
+    }
+
+    // Non copyable
+    TypeDef( const TypeDef& );
+    TypeDef& operator=( const TypeDef& );
+
     const std::string m_name; ///< Name of defined type
     const TypeDef* m_parent;  ///< Pointer to parent type or nullptr if none
+    const size_t m_id;        ///< Dense id of the type
+    mutable size_t m_depth;   ///< Number of ancestors of the type
+    mutable std::vector<size_t> m_ancestors; ///< Ancestor ids by depth
+    mutable boost::atomic<bool> m_resolved;  ///< True once depth is set
 };
 
 } // namespace MPO
@@ -0,0 +1,30 @@
+TEMPLATE = app
+CONFIG += console
+CONFIG -= qt
+
+TARGET = mpo-bench
+
+INCLUDEPATH += ..
+
+LIBS += -lboost_thread -lboost_chrono -lboost_system
+unix:!macx: LIBS += -lrt
+
+SOURCES += main.cpp \
+    ../Message.cpp \
+    ../Instrumentation.cpp \
+    ../Trace.cpp \
+    ../BufferMessage.cpp \
+    ../MessageCodec.cpp \
+    ../Link.cpp \
+    ../Signal.cpp \
+    ../Slot.cpp \
+    ../Action.cpp \
+    ../Topology.cpp \
+    ../GraphArena.cpp \
+    ../Domain.cpp \
+    ../Scheduler.cpp \
+    ../RemoteSlot.cpp \
+    ../ShmRing.cpp \
+    ../ShmTransport.cpp \
+    ../TcpTransport.cpp \
+    ../Journal.cpp
@@ -0,0 +1,1033 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdio>
+#include <boost/chrono.hpp>
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+#include <boost/atomic.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include "MPO.hpp"
+#include "AsioAdaptor.hpp"
+
+using namespace std;
+using namespace MPO;
+
+/*
+    Benchmarks of the Message dispatch
+
+    Each benchmark adds one or more measures to the result list, which is
+    printed as CSV (default) or JSON once all benchmarks ran.
+
+    Usage: mpo-bench [--json|--csv] [--output file] [--scale n]
+
+    The scale divides the number of iterations of all benchmarks to get
+    quick runs while developing.
+*/
+
+typedef boost::chrono::steady_clock Clock;
+
+/// Return the seconds elapsed since start
+double elapsed( Clock::time_point start )
+{
+    return boost::chrono::duration<double>( Clock::now() - start ).count();
+}
+
+/// A measure of a benchmark
+struct Result
+{
+    Result( const string& benchmark, const string& parameter,
+            const string& metric, double value ) :
+        benchmark(benchmark), parameter(parameter), metric(metric),
+        value(value) {}
+
+    string benchmark; ///< Name of the benchmark
+    string parameter; ///< Value of the benchmark parameter or ""
+    string metric;    ///< Name of the measure with its unit
+    double value;     ///< Measured value
+};
+
+vector<Result> results;
+
+/// Record the cost and rate of nbr operations performed in seconds
+void report( const string& benchmark, const string& parameter,
+             size_t nbr, double seconds )
+{
+    results.push_back( Result( benchmark, parameter, "ns_per_op",
+                               seconds * 1e9 / nbr ) );
+    results.push_back( Result( benchmark, parameter, "ops_per_second",
+                               nbr / seconds ) );
+}
+
+/// Return n as a string
+string str( size_t n )
+{
+    ostringstream oss;
+    oss << n;
+    return oss.str();
+}
+
+
+class Ball : public Message
+{
+public:
+    Ball() : count(0), maxCount(0) {}
+    typedef boost::shared_ptr<Ball> Ptr;
+    static const TypeDef& Type() { return Ball::m_type; }
+    virtual const TypeDef& type() const { return Ball::Type(); }
+    int count, maxCount;
+    Clock::time_point stamp;
+private:
+    static const TypeDef m_type;
+};
+const TypeDef Ball::m_type( "Ball", &Message::Type() );
+
+class PooledBall : public PooledMessage<PooledBall>
+{
+public:
+    typedef boost::shared_ptr<PooledBall> Ptr;
+    static const TypeDef& Type() { return PooledBall::m_type; }
+    virtual const TypeDef& type() const { return PooledBall::Type(); }
+private:
+    static const TypeDef m_type;
+};
+const TypeDef PooledBall::m_type( "PooledBall", &Message::Type() );
+
+/// Action forwarding the received balls until their count reaches maxCount
+class Relay : public Action
+{
+public:
+    Relay( const string& name ) : Action(name), m_input(this)
+    {
+        add( "input", m_input );
+        add( "output", m_output );
+    }
+
+    void relay( Ball::Ptr ball, Link* )
+    {
+        if( ++ball->count < ball->maxCount )
+            m_output.emit( ball );
+    }
+
+    static const TypeDef& Type() { return Relay::m_type; }
+    virtual const TypeDef& type() const { return Relay::Type(); }
+
+    Slot<Ball, Relay, &Relay::relay> m_input;
+    Signal<Ball> m_output;
+
+private:
+    static const TypeDef m_type;
+};
+const TypeDef Relay::m_type( "Relay", &Action::Type() );
+
+boost::atomic<size_t> nbrReceived( 0 );
+void receive( Ball::Ptr, Link* )
+{
+    nbrReceived.fetch_add( 1, boost::memory_order_relaxed );
+}
+
+vector<double> latencies;
+void receiveLatency( Ball::Ptr ball, Link* )
+{
+    latencies.push_back( boost::chrono::duration<double, boost::nano>(
+                             Clock::now() - ball->stamp ).count() );
+    nbrReceived.fetch_add( 1, boost::memory_order_release );
+}
+
+
+/// Two Relays bouncing a ball nbr times through queued or direct Links
+void benchPingPong( size_t nbr, Link::Mode mode )
+{
+    new Relay( "ping" );
+    new Relay( "pong" );
+    Link::connect( "ping::output", "pong::input", false, mode );
+    Link::connect( "pong::output", "ping::input", false, mode );
+    Signal<Ball> start;
+    Link::connect( &start, AnySlot::get( "ping::input" ) );
+
+    Ball::Ptr ball( new Ball() );
+    ball->maxCount = nbr;
+    Clock::time_point t = Clock::now();
+    start.emit( ball );
+    while( Message::processNext() );
+    report( "ping_pong", mode == Link::Direct ? "direct" : "", nbr, elapsed( t ) );
+    Action::clearActions();
+}
+
+/// One Signal connected to fanOut Slots
+void benchFanOut( size_t nbr, size_t fanOut )
+{
+    Signal<Ball> signal;
+    vector< SlotFunction<Ball, &receive>* > slots;
+    for( size_t i = 0; i < fanOut; ++i )
+    {
+        slots.push_back( new SlotFunction<Ball, &receive>() );
+        Link::connect( &signal, slots.back() );
+    }
+    Ball::Ptr ball( new Ball() );
+    size_t nbrEmits = nbr / fanOut;
+    Clock::time_point t = Clock::now();
+    for( size_t i = 0; i < nbrEmits; ++i )
+    {
+        signal.emit( ball );
+        while( Message::processNext() );
+    }
+    report( "fan_out", str( fanOut ), nbrEmits * fanOut, elapsed( t ) );
+    for( size_t i = 0; i < slots.size(); ++i )
+        delete slots[i];
+}
+
+/// One Signal connected to fanOut Slots, emitting through its dispatch plan
+void benchFrozen( size_t nbr, size_t fanOut )
+{
+    Signal<Ball> signal;
+    vector< SlotFunction<Ball, &receive>* > slots;
+    for( size_t i = 0; i < fanOut; ++i )
+    {
+        slots.push_back( new SlotFunction<Ball, &receive>() );
+        Link::connect( &signal, slots.back() );
+    }
+    signal.freeze();
+    Ball::Ptr ball( new Ball() );
+    size_t nbrEmits = nbr / fanOut;
+    Clock::time_point t = Clock::now();
+    for( size_t i = 0; i < nbrEmits; ++i )
+    {
+        signal.emit( ball );
+        while( Message::processNext() );
+    }
+    report( "fan_out_frozen", str( fanOut ), nbrEmits * fanOut, elapsed( t ) );
+    signal.unfreeze();
+    for( size_t i = 0; i < slots.size(); ++i )
+        delete slots[i];
+}
+
+/// fanIn Signals connected to one Slot
+void benchFanIn( size_t nbr, size_t fanIn )
+{
+    SlotFunction<Ball, &receive> slot;
+    vector< Signal<Ball>* > signals;
+    for( size_t i = 0; i < fanIn; ++i )
+    {
+        signals.push_back( new Signal<Ball>() );
+        Link::connect( signals.back(), &slot );
+    }
+    Ball::Ptr ball( new Ball() );
+    size_t nbrRounds = nbr / fanIn;
+    Clock::time_point t = Clock::now();
+    for( size_t i = 0; i < nbrRounds; ++i )
+    {
+        for( size_t j = 0; j < fanIn; ++j )
+            signals[j]->emit( ball );
+        while( Message::processNext() );
+    }
+    report( "fan_in", str( fanIn ), nbrRounds * fanIn, elapsed( t ) );
+    for( size_t i = 0; i < signals.size(); ++i )
+        delete signals[i];
+}
+
+/// Balls traversing a pipeline of depth Relays linked by queued or direct
+/// Links
+void benchChain( size_t nbr, size_t depth, Link::Mode mode )
+{
+    Signal<Ball> start;
+    AnySignal* output = &start;
+    for( size_t i = 0; i < depth; ++i )
+    {
+        Relay* relay = new Relay( "relay" + str( i ) );
+        Link::connect( output, &relay->m_input, false, i ? mode : Link::Queued );
+        output = &relay->m_output;
+    }
+    size_t nbrBalls = nbr / depth;
+    Clock::time_point t = Clock::now();
+    for( size_t i = 0; i < nbrBalls; ++i )
+    {
+        Ball::Ptr ball( new Ball() );
+        ball->maxCount = depth;
+        start.emit( ball );
+        while( Message::processNext() );
+    }
+    report( mode == Link::Direct ? "chain_direct" : "chain", str( depth ),
+            nbrBalls * depth, elapsed( t ) );
+    Action::clearActions();
+}
+
+/// Dispatch through a static cast Link and through a checked cast Link
+void benchCast( size_t nbr )
+{
+    Signal<Ball> ballSignal;
+    Signal<Message> messageSignal;
+    SlotFunction<Ball, &receive> slot;
+    Ball::Ptr ball( new Ball() );
+
+    Link::connect( &ballSignal, &slot );
+    Clock::time_point t = Clock::now();
+    for( size_t i = 0; i < nbr; ++i )
+    {
+        ballSignal.emit( ball );
+        Message::processNext();
+    }
+    report( "cast", "static", nbr, elapsed( t ) );
+
+    Link::connect( &messageSignal, &slot );
+    t = Clock::now();
+    for( size_t i = 0; i < nbr; ++i )
+    {
+        messageSignal.emit( ball );
+        Message::processNext();
+    }
+    report( "cast", "dynamic", nbr, elapsed( t ) );
+}
+
+/// Connect and disconnect nbr pairs of Signal and Slot, by pointer and name
+void benchConnect( size_t nbr )
+{
+    vector< Signal<Ball>* > signals;
+    vector< SlotFunction<Ball, &receive>* > slots;
+    vector<string> signalNames, slotNames;
+    for( size_t i = 0; i < nbr; ++i )
+    {
+        signals.push_back( new Signal<Ball>() );
+        slots.push_back( new SlotFunction<Ball, &receive>() );
+        signalNames.push_back( "signal" + str( i ) );
+        slotNames.push_back( "slot" + str( i ) );
+        signals[i]->setName( signalNames[i] );
+        slots[i]->setName( slotNames[i] );
+    }
+
+    Clock::time_point t = Clock::now();
+    for( size_t i = 0; i < nbr; ++i )
+        Link::connect( signals[i], slots[i] );
+    report( "connect", "pointer", nbr, elapsed( t ) );
+
+    t = Clock::now();
+    for( size_t i = 0; i < nbr; ++i )
+        Link::disconnect( signals[i], slots[i] );
+    report( "disconnect", "pointer", nbr, elapsed( t ) );
+
+    t = Clock::now();
+    for( size_t i = 0; i < nbr; ++i )
+        Link::connect( signalNames[i], slotNames[i] );
+    report( "connect", "name", nbr, elapsed( t ) );
+
+    t = Clock::now();
+    for( size_t i = 0; i < nbr; ++i )
+        Link::disconnect( signalNames[i], slotNames[i] );
+    report( "disconnect", "name", nbr, elapsed( t ) );
+
+    size_t nbrFound = 0;
+    t = Clock::now();
+    for( size_t i = 0; i < nbr; ++i )
+        nbrFound += AnySignal::get( signalNames[i] ) && AnySlot::get( slotNames[i] );
+    report( "lookup", "name", nbr, elapsed( t ) );
+    if( nbrFound != nbr )
+        cerr << "lookup: " << nbr - nbrFound << " names not found" << endl;
+
+    for( size_t i = 0; i < nbr; ++i )
+    {
+        delete signals[i];
+        delete slots[i];
+    }
+
+    // Chain of nbr Actions connected with their Action and port names
+    vector<string> actionNames;
+    for( size_t i = 0; i < nbr; ++i )
+    {
+        actionNames.push_back( "node" + str( i ) );
+        new Relay( actionNames.back() );
+    }
+    // Connect once to allocate the link containers of the Actions
+    for( size_t i = 1; i < nbr; ++i )
+        Link::connect( actionNames[i-1], "output", actionNames[i], "input" );
+    for( size_t i = 1; i < nbr; ++i )
+        Link::disconnect( actionNames[i-1], "output", actionNames[i], "input" );
+
+    t = Clock::now();
+    for( size_t i = 1; i < nbr; ++i )
+        Link::connect( actionNames[i-1] + "::output", actionNames[i] + "::input" );
+    report( "connect", "action_name", nbr - 1, elapsed( t ) );
+
+    t = Clock::now();
+    for( size_t i = 1; i < nbr; ++i )
+        Link::disconnect( actionNames[i-1], "output", actionNames[i], "input" );
+    report( "disconnect", "action_port", nbr - 1, elapsed( t ) );
+
+    t = Clock::now();
+    for( size_t i = 1; i < nbr; ++i )
+        Link::connect( actionNames[i-1], "output", actionNames[i], "input" );
+    report( "connect", "action_port", nbr - 1, elapsed( t ) );
+    Action::clearActions();
+}
+
+/// Connect and disconnect nbr Links while nbr Message are queued
+void benchTeardown( size_t nbr )
+{
+    Signal<Ball> loadSignal;
+    SlotFunction<Ball, &receive> loadSlot;
+    Link::connect( &loadSignal, &loadSlot );
+    Ball::Ptr ball( new Ball() );
+    for( size_t i = 0; i < nbr; ++i )
+        loadSignal.emit( ball );
+
+    Signal<Ball> signal;
+    SlotFunction<Ball, &receive> slot;
+    Clock::time_point t = Clock::now();
+    for( size_t i = 0; i < nbr; ++i )
+    {
+        Link::connect( &signal, &slot );
+        Link::disconnect( &signal, &slot );
+    }
+    report( "rewire", "loaded_queue", nbr, elapsed( t ) );
+    while( Message::processNext() );
+}
+
+/// Start a chain of nbr Actions with a Link::connect per link or a Topology
+void benchTopology( size_t nbr )
+{
+    // Both networks are allocated beforehand to share the same heap state
+    vector<string> connectNames, topologyNames;
+    for( size_t i = 0; i < nbr; ++i )
+    {
+        connectNames.push_back( "connect" + str( i ) );
+        topologyNames.push_back( "topology" + str( i ) );
+        new Relay( connectNames.back() );
+        new Relay( topologyNames.back() );
+    }
+    Clock::time_point t = Clock::now();
+    for( size_t i = 1; i < nbr; ++i )
+        Link::connect( connectNames[i-1], "output", connectNames[i], "input" );
+    report( "startup", "link_connect", nbr - 1, elapsed( t ) );
+
+    t = Clock::now();
+    Topology topology;
+    topology.reserve( nbr - 1 );
+    for( size_t i = 1; i < nbr; ++i )
+        topology.add( topologyNames[i-1], "output", topologyNames[i], "input" );
+    topology.build();
+    report( "startup", "topology", nbr - 1, elapsed( t ) );
+    Action::clearActions();
+
+    // Same networks with resolved ports, measuring the Link creation alone
+    vector< Signal<Ball>* > signals;
+    vector< SlotFunction<Ball, &receive>* > slots;
+    for( size_t i = 0; i < 2 * nbr; ++i )
+    {
+        signals.push_back( new Signal<Ball>() );
+        slots.push_back( new SlotFunction<Ball, &receive>() );
+    }
+    t = Clock::now();
+    for( size_t i = 1; i < nbr; ++i )
+        Link::connect( signals[2*i-2], slots[2*i] );
+    report( "startup", "link_connect_pointer", nbr - 1, elapsed( t ) );
+
+    t = Clock::now();
+    for( size_t i = 1; i < nbr; ++i )
+        topology.add( signals[2*i-1], slots[2*i+1] );
+    topology.build();
+    report( "startup", "topology_pointer", nbr - 1, elapsed( t ) );
+    for( size_t i = 0; i < 2 * nbr; ++i )
+    {
+        delete signals[i];
+        delete slots[i];
+    }
+}
+
+/// Build a chain of nbr Relays, run a ball through it and tear it down,
+/// allocating the Relays and Links one by one or in a GraphArena
+void benchGraphArena( size_t nbr, size_t rounds )
+{
+    vector<string> names;
+    for( size_t i = 0; i < nbr; ++i )
+        names.push_back( "relay" + str( i ) );
+    Ball::Ptr ball( new Ball() );
+
+    Clock::time_point t = Clock::now();
+    for( size_t round = 0; round < rounds; ++round )
+    {
+        for( size_t i = 0; i < nbr; ++i )
+            new Relay( names[i] );
+        for( size_t i = 1; i < nbr; ++i )
+            Link::connect( names[i-1], "output", names[i], "input" );
+        ball->count = 0;
+        ball->maxCount = nbr;
+        static_cast<Relay*>( Action::getAction( names[0] ) )->m_output.emit( ball );
+        while( Message::processNext() );
+        Action::clearActions();
+    }
+    report( "rebuild", "heap", nbr * rounds, elapsed( t ) );
+
+    t = Clock::now();
+    GraphArena arena;
+    for( size_t round = 0; round < rounds; ++round )
+    {
+        for( size_t i = 0; i < nbr; ++i )
+            new( arena ) Relay( names[i] );
+        for( size_t i = 1; i < nbr; ++i )
+            arena.connect( names[i-1], "output", names[i], "input" );
+        ball->count = 0;
+        ball->maxCount = nbr;
+        static_cast<Relay*>( Action::getAction( names[0] ) )->m_output.emit( ball );
+        while( Message::processNext() );
+        arena.clear();
+    }
+    report( "rebuild", "graph_arena", nbr * rounds, elapsed( t ) );
+}
+
+/// Emit nbr balls
+void emitBalls( Signal<Ball>* signal, size_t nbr )
+{
+    Ball::Ptr ball( new Ball() );
+    for( size_t i = 0; i < nbr; ++i )
+        signal->emit( ball );
+}
+
+/// Emit from 1 to 32 threads in a multiple producers queue
+void benchMultiProducers( size_t nbr )
+{
+    Signal<Ball> signal;
+    SlotFunction<Ball, &receive> slot;
+    Link::connect( &signal, &slot );
+    Message::setMultiProducer( true );
+    for( size_t nbrThreads = 1; nbrThreads <= 32; nbrThreads *= 2 )
+    {
+        size_t n = nbr / nbrThreads;
+        nbrReceived = 0;
+        Clock::time_point t = Clock::now();
+        boost::thread_group producers;
+        for( size_t i = 0; i < nbrThreads; ++i )
+            producers.create_thread( boost::bind( &emitBalls, &signal, n ) );
+        while( nbrReceived.load() != nbrThreads * n )
+            if( !Message::processNext() )
+                boost::this_thread::yield();
+        producers.join_all();
+        report( "multi_producers", str( nbrThreads ), nbrThreads * n, elapsed( t ) );
+    }
+    Message::setMultiProducer( false );
+}
+
+/// Creation and release of short lived Message
+void benchCreate( size_t nbr )
+{
+    Clock::time_point t = Clock::now();
+    for( size_t i = 0; i < nbr; ++i )
+        Ball::Ptr( new Ball() );
+    report( "create", "new", nbr, elapsed( t ) );
+
+    t = Clock::now();
+    for( size_t i = 0; i < nbr; ++i )
+        PooledBall::create();
+    report( "create", "pooled", nbr, elapsed( t ) );
+}
+
+/// Process the Domain until stop is set
+void runDomain( Domain* domain, boost::atomic<bool>* stop )
+{
+    while( !stop->load() )
+        if( !domain->processNext() )
+            boost::this_thread::yield();
+}
+
+/// Emit nbr state updates in bursts of 100 between dispatches, with a
+/// coalescing Link or a FIFO one
+void benchCoalescing( size_t nbr )
+{
+    Signal<Ball> signal;
+    SlotFunction<Ball, &receive> slot;
+    Link::connect( &signal, &slot );
+    Ball::Ptr ball( new Ball() );
+    for( int coalescing = 0; coalescing < 2; ++coalescing )
+    {
+        signal.setCoalescing( coalescing != 0 );
+        Clock::time_point t = Clock::now();
+        for( size_t i = 0; i < nbr; i += 100 )
+        {
+            for( size_t j = 0; j < 100; ++j )
+                signal.emit( ball );
+            while( Message::processNext() );
+        }
+        report( "state_updates", coalescing ? "coalescing" : "fifo",
+                nbr, elapsed( t ) );
+    }
+}
+
+/// Frame class carrying a shared payload
+class Frame : public BufferMessage<Frame>
+{
+public:
+    Frame( const BufferSlice& payload ) : BufferMessage( payload ) {}
+    typedef boost::shared_ptr<Frame> Ptr;
+    static const TypeDef& Type() { return Frame::m_type; }
+    virtual const TypeDef& type() const { return Frame::Type(); }
+private:
+    static const TypeDef m_type;
+};
+const TypeDef Frame::m_type( "Frame", &Message::Type() );
+
+/// Count the received frames
+void receiveFrame( Frame::Ptr, Link* )
+{
+    nbrReceived.fetch_add( 1, boost::memory_order_relaxed );
+}
+
+/// Emit nbr frames of 64 KiB to 4 Slots, copying the payload of each frame
+/// in a new Buffer or sharing a single Buffer
+void benchPayload( size_t nbr )
+{
+    const size_t size = 64 * 1024;
+    Signal<Frame> signal;
+    SlotFunction<Frame, &receiveFrame> slot1, slot2, slot3, slot4;
+    Link::connect( &signal, &slot1 );
+    Link::connect( &signal, &slot2 );
+    Link::connect( &signal, &slot3 );
+    Link::connect( &signal, &slot4 );
+    boost::shared_ptr<Buffer> source = Buffer::create( size );
+    std::fill( source->data(), source->data() + size, 'x' );
+    BufferSlice shared( source );
+    for( int sharing = 0; sharing < 2; ++sharing )
+    {
+        Clock::time_point t = Clock::now();
+        for( size_t i = 0; i < nbr; ++i )
+        {
+            BufferSlice payload = sharing ? shared
+                : BufferSlice( Buffer::copy( source->data(), size ) );
+            signal.emit( Frame::create( payload ) );
+            while( Message::processNext() );
+        }
+        report( "payload_64k", sharing ? "shared" : "copy", nbr, elapsed( t ) );
+    }
+}
+
+class Position : public Message
+{
+public:
+    struct Data { double x, y; boost::int32_t id; } data;
+    typedef boost::shared_ptr<Position> Ptr;
+    static const TypeDef& Type() { return Position::m_type; }
+    virtual const TypeDef& type() const { return Position::Type(); }
+private:
+    static const TypeDef m_type;
+};
+const TypeDef Position::m_type( "Position", &Message::Type() );
+
+/// Count the received positions
+void receivePosition( Position::Ptr, Link* )
+{
+    nbrReceived.fetch_add( 1, boost::memory_order_relaxed );
+}
+
+/// Poll the ring and dispatch the positions until nbr were received
+void pollPositions( ShmReceiver* receiver, Domain* domain, size_t nbr )
+{
+    while( nbrReceived.load( boost::memory_order_relaxed ) < nbr )
+    {
+        if( !receiver->poll( 64 ) )
+            boost::this_thread::yield();
+        while( domain->processNext() );
+    }
+}
+
+/// Emit nbr positions in bursts of 100 through a shared memory ring read
+/// by another thread, as another process would
+void benchShm( size_t nbr )
+{
+    MessageCodec::addTrivial<Position, Position::Data, &Position::data>();
+    ShmSender sender( "/mpo-bench-shm", 1 << 20 );
+    Domain domain;
+    ShmReceiver receiver( "/mpo-bench-shm", domain );
+    SlotFunction<Position, &receivePosition> slot;
+    slot.setDomain( domain );
+    slot.setName( "Bench::position" );
+    Signal<Position> signal;
+    sender.bridge( &signal, "Bench::position" );
+    nbrReceived = 0;
+    Position::Ptr position( new Position() );
+    Clock::time_point t = Clock::now();
+    boost::thread consumer( boost::bind( &pollPositions, &receiver, &domain, nbr ) );
+    for( size_t i = 0; i < nbr; i += 100 )
+    {
+        for( size_t j = 0; j < 100; ++j )
+            signal.emit( position );
+        while( Message::processNext() );
+    }
+    consumer.join();
+    report( "shm_transport", "position_24B", nbr, elapsed( t ) );
+    slot.unregisterName();
+}
+
+/// Poll the node and dispatch the positions until nbr were received
+void pollNode( TcpNode* node, Domain* domain, size_t nbr )
+{
+    while( nbrReceived.load( boost::memory_order_relaxed ) < nbr )
+    {
+        if( !node->poll() )
+            boost::this_thread::yield();
+        while( domain->processNext() );
+    }
+}
+
+/// Emit nbr positions in bursts of 100 to a node polled by another thread
+/// through a loopback TCP connection, flushing the batch after each burst
+void benchTcp( size_t nbr )
+{
+    MessageCodec::addTrivial<Position, Position::Data, &Position::data>();
+    Domain domain;
+    TcpNode receiver( "receiver", 0, domain );
+    TcpNode sender( "sender" );
+    sender.addPeer( "receiver", "127.0.0.1", receiver.port() );
+    SlotFunction<Position, &receivePosition> slot;
+    slot.setDomain( domain );
+    slot.setName( "Bench::position" );
+    Signal<Position> signal;
+    signal.setName( "Bench::positions" );
+    sender.connect( "sender/Bench::positions", "receiver/Bench::position" );
+    nbrReceived = 0;
+    Position::Ptr position( new Position() );
+    Clock::time_point t = Clock::now();
+    boost::thread consumer( boost::bind( &pollNode, &receiver, &domain, nbr ) );
+    for( size_t i = 0; i < nbr; i += 100 )
+    {
+        for( size_t j = 0; j < 100; ++j )
+            signal.emit( position );
+        while( Message::processNext() );
+        sender.flush();
+    }
+    consumer.join();
+    report( "tcp_transport", "position_24B", nbr, elapsed( t ) );
+    signal.unregisterName();
+    slot.unregisterName();
+}
+
+/// Record nbr positions in bursts of 100 in a journal of 64 MiB segments,
+/// then replay them at maximum speed
+void benchJournal( size_t nbr )
+{
+    MessageCodec::addTrivial<Position, Position::Data, &Position::data>();
+    const string directory = "/tmp/mpo-bench-journal";
+    Signal<Position> signal;
+    Position::Ptr position( new Position() );
+    {
+        JournalWriter journal( directory, 64 << 20 );
+        journal.tap( &signal );
+        Clock::time_point t = Clock::now();
+        for( size_t i = 0; i < nbr; i += 100 )
+        {
+            for( size_t j = 0; j < 100; ++j )
+                signal.emit( position );
+            while( Message::processNext() );
+        }
+        report( "journal_write", "position_24B", nbr, elapsed( t ) );
+    }
+    JournalReplay replay( directory );
+    SlotFunction<Position, &receivePosition> slot;
+    Link::connect( &replay.output(), &slot );
+    nbrReceived = 0;
+    Clock::time_point t = Clock::now();
+    while( replay.replay( JournalReplay::MaximumSpeed, 100 ) )
+        while( Message::processNext() );
+    report( "journal_replay", "position_24B", nbrReceived.load(), elapsed( t ) );
+    for( unsigned index = 1; index <= replay.nbrSegments(); ++index )
+    {
+        char name[32];
+        sprintf( name, "/journal-%08u.mpoj", index );
+        remove( ( directory + name ).c_str() );
+    }
+    remove( directory.c_str() );
+}
+
+/// Dispatch bursts of 100 balls with tracing disabled or recording
+void benchTracing( size_t nbr )
+{
+    Signal<Ball> signal;
+    SlotFunction<Ball, &receive> slot;
+    Link::connect( &signal, &slot );
+    Ball::Ptr ball( new Ball() );
+    for( int traced = 0; traced < 2; ++traced )
+    {
+        if( traced )
+            Trace::enable();
+        Clock::time_point t = Clock::now();
+        for( size_t i = 0; i < nbr; i += 100 )
+        {
+            for( size_t j = 0; j < 100; ++j )
+                signal.emit( ball );
+            while( Message::processNext() );
+        }
+        report( "tracing", traced ? "enabled" : "disabled", nbr, elapsed( t ) );
+        Trace::disable();
+    }
+}
+
+/// Handler processing one Message and posting itself while some are pending
+void processOne( Domain* domain, boost::asio::io_context* io )
+{
+    if( domain->processNext() )
+        boost::asio::post( *io, boost::bind( &processOne, domain, io ) );
+}
+
+/// Handler of the notifier of a hand wired Domain
+void postProcessOne( Domain* domain, boost::asio::io_context* io )
+{
+    boost::asio::post( *io, boost::bind( &processOne, domain, io ) );
+}
+
+/// Emit nbr balls in bursts of 100 to a Domain processed by io_context
+/// handlers posted per Message or by an AsioAdaptor
+void benchAsio( size_t nbr )
+{
+    Signal<Ball> signal;
+    SlotFunction<Ball, &receive> slot;
+    Domain domain;
+    slot.setDomain( domain );
+    Link::connect( &signal, &slot );
+    Ball::Ptr ball( new Ball() );
+    for( int adapted = 0; adapted < 2; ++adapted )
+    {
+        boost::asio::io_context io;
+        boost::scoped_ptr<AsioAdaptor> adaptor;
+        if( adapted )
+            adaptor.reset( new AsioAdaptor( io, domain ) );
+        else
+            domain.setMessageNotifier( boost::bind( &postProcessOne, &domain, &io ) );
+        Clock::time_point t = Clock::now();
+        for( size_t i = 0; i < nbr; i += 100 )
+        {
+            for( size_t j = 0; j < 100; ++j )
+                signal.emit( ball );
+            io.restart();
+            io.poll();
+        }
+        report( "asio", adapted ? "adaptor" : "post_per_message", nbr,
+                elapsed( t ) );
+        domain.setMessageNotifier( Domain::MessageNotifier() );
+    }
+}
+
+/// Count the balls received by ranges
+class BatchReceiver
+{
+protected:
+    void receive( const Ball::Ptr*, size_t n, Link* )
+        { nbrReceived.fetch_add( n, boost::memory_order_relaxed ); }
+public:
+    BatchReceiver() : input(this) {}
+    BatchSlot<Ball, BatchReceiver, &BatchReceiver::receive> input;
+};
+
+/// Dispatch bursts of 100 balls to a Slot processing them one by one or
+/// to a BatchSlot receiving them by ranges of 64
+void benchBatching( size_t nbr )
+{
+    Signal<Ball> signal;
+    SlotFunction<Ball, &receive> slot;
+    BatchReceiver batchReceiver;
+    Ball::Ptr ball( new Ball() );
+    for( int batched = 0; batched < 2; ++batched )
+    {
+        AnySlot* target = batched ? static_cast<AnySlot*>( &batchReceiver.input )
+                                  : static_cast<AnySlot*>( &slot );
+        Link::connect( &signal, target );
+        Clock::time_point t = Clock::now();
+        for( size_t i = 0; i < nbr; i += 100 )
+        {
+            for( size_t j = 0; j < 100; ++j )
+                signal.emit( ball );
+            while( Message::processNext() );
+        }
+        report( "delivery", batched ? "batch_slot" : "slot", nbr, elapsed( t ) );
+        Link::disconnect( &signal, target );
+    }
+}
+
+/// Emit nbr balls to another Domain whose queue blocks the producer once
+/// it holds capacity balls, or is unbounded if capacity is 0
+void benchBackpressure( size_t nbr, size_t capacity )
+{
+    Domain domain;
+    domain.setCapacity( capacity );
+    domain.setOverflowPolicy( Message::Block );
+    Signal<Ball> signal;
+    SlotFunction<Ball, &receive> slot;
+    slot.setDomain( domain );
+    Link::connect( &signal, &slot );
+    nbrReceived = 0;
+    boost::atomic<bool> stop( false );
+    boost::thread consumer( boost::bind( &runDomain, &domain, &stop ) );
+    Clock::time_point t = Clock::now();
+    emitBalls( &signal, nbr );
+    while( nbrReceived.load() != nbr )
+        boost::this_thread::yield();
+    report( "backpressure", capacity ? "block_" + str( capacity ) : "unbounded",
+            nbr, elapsed( t ) );
+    stop = true;
+    consumer.join();
+}
+
+/// Latency of a control ball emitted behind nbr bulk balls, with the bulk
+/// Link in the same lane as the control Link or in the bulk lane
+void benchPriority( size_t nbr )
+{
+    Signal<Ball> bulk, control;
+    SlotFunction<Ball, &receive> slotBulk;
+    SlotFunction<Ball, &receiveLatency> slotControl;
+    Link::connect( &bulk, &slotBulk );
+    Link::connect( &control, &slotControl );
+    control.setPriority( Message::ControlPriority );
+    Ball::Ptr ball( new Ball() );
+    const char* lanes[] = { "same_lane", "bulk_lane" };
+    for( int i = 0; i < 2; ++i )
+    {
+        bulk.setPriority( i ? Message::BulkPriority : Message::ControlPriority );
+        for( size_t j = 0; j < nbr; ++j )
+            bulk.emit( ball );
+        latencies.clear();
+        Ball::Ptr controlBall( new Ball() );
+        controlBall->stamp = Clock::now();
+        control.emit( controlBall );
+        while( latencies.empty() )
+            Message::processNext();
+        results.push_back( Result( "priority", lanes[i], "control_latency_ns",
+                                   latencies[0] ) );
+        while( Message::processNext() );
+    }
+}
+
+/// Latency percentiles of balls sent one at a time to another Domain
+void benchLatency( size_t nbr )
+{
+    Domain domain;
+    Signal<Ball> signal;
+    SlotFunction<Ball, &receiveLatency> slot;
+    slot.setDomain( domain );
+    Link::connect( &signal, &slot );
+    latencies.clear();
+    latencies.reserve( nbr );
+    nbrReceived = 0;
+    boost::atomic<bool> stop( false );
+    boost::thread consumer( boost::bind( &runDomain, &domain, &stop ) );
+    Ball::Ptr ball( new Ball() );
+    for( size_t i = 0; i < nbr; ++i )
+    {
+        ball->stamp = Clock::now();
+        signal.emit( ball );
+        while( nbrReceived.load( boost::memory_order_acquire ) != i + 1 )
+            boost::this_thread::yield();
+    }
+    stop = true;
+    consumer.join();
+    Link::disconnect( &signal, &slot );
+
+    sort( latencies.begin(), latencies.end() );
+    const double percentiles[] = { 50, 90, 99, 99.9 };
+    const char* names[] = { "p50_ns", "p90_ns", "p99_ns", "p999_ns" };
+    for( size_t i = 0; i < 4; ++i )
+    {
+        size_t index = size_t( percentiles[i] / 100. * ( latencies.size() - 1 ) );
+        results.push_back( Result( "latency", "cross_domain", names[i],
+                                   latencies[index] ) );
+    }
+    results.push_back( Result( "latency", "cross_domain", "max_ns",
+                               latencies.back() ) );
+}
+
+
+/// Print the results as CSV
+void printCsv( ostream& out )
+{
+    out << "benchmark,parameter,metric,value" << endl;
+    for( size_t i = 0; i < results.size(); ++i )
+        out << results[i].benchmark << ',' << results[i].parameter << ','
+            << results[i].metric << ',' << results[i].value << endl;
+}
+
+/// Print the results as JSON
+void printJson( ostream& out )
+{
+    out << "{" << endl << "  \"results\": [" << endl;
+    for( size_t i = 0; i < results.size(); ++i )
+        out << "    { \"benchmark\": \"" << results[i].benchmark
+            << "\", \"parameter\": \"" << results[i].parameter
+            << "\", \"metric\": \"" << results[i].metric
+            << "\", \"value\": " << results[i].value << " }"
+            << ( i + 1 < results.size() ? "," : "" ) << endl;
+    out << "  ]" << endl << "}" << endl;
+}
+
+int main( int argc, char* argv[] )
+{
+    bool json = false;
+    string output;
+    size_t scale = 1;
+    for( int i = 1; i < argc; ++i )
+    {
+        string arg = argv[i];
+        if( arg == "--json" )
+            json = true;
+        else if( arg == "--csv" )
+            json = false;
+        else if( arg == "--output" && i + 1 < argc )
+            output = argv[++i];
+        else if( arg == "--scale" && i + 1 < argc )
+            scale = std::max( atoi( argv[++i] ), 1 );
+        else
+        {
+            cerr << "Usage: " << argv[0]
+                 << " [--json|--csv] [--output file] [--scale n]" << endl;
+            return 1;
+        }
+    }
+
+    size_t nbr = 1000000 / scale;
+    benchPingPong( nbr, Link::Queued );
+    benchPingPong( nbr, Link::Direct );
+    benchFanOut( nbr, 1 );
+    benchFanOut( nbr, 4 );
+    benchFanOut( nbr, 16 );
+    benchFrozen( nbr, 1 );
+    benchFrozen( nbr, 16 );
+    benchFanIn( nbr, 4 );
+    benchFanIn( nbr, 16 );
+    benchChain( nbr, 4, Link::Queued );
+    benchChain( nbr, 16, Link::Queued );
+    benchChain( nbr, 4, Link::Direct );
+    benchCast( nbr );
+    benchConnect( 10000 / scale );
+    benchTopology( 50000 / scale );
+    benchTeardown( 10000 / scale );
+    benchGraphArena( 1000, 50 / scale + 1 );
+    benchMultiProducers( nbr );
+    benchCreate( nbr );
+    benchCoalescing( nbr );
+    benchBatching( nbr );
+    benchPayload( nbr / 100 );
+    benchShm( nbr );
+    benchTcp( nbr );
+    benchJournal( nbr );
+    benchTracing( nbr );
+    benchAsio( nbr );
+    benchBackpressure( nbr, 0 );
+    benchBackpressure( nbr, 1024 );
+    benchPriority( nbr );
+    benchLatency( 10000 / scale );
+
+    ofstream file;
+    if( !output.empty() )
+    {
+        file.open( output.c_str() );
+        if( !file )
+        {
+            cerr << "Cannot open " << output << endl;
+            return 1;
+        }
+    }
+    ostream& out = output.empty() ? cout : file;
+    if( json )
+        printJson( out );
+    else
+        printCsv( out );
+    return 0;
+}
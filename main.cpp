@@ -1,14 +1,68 @@
 #include <iostream>
 #include <map>
-#include <sys/time.h>
+#include <new>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <boost/chrono.hpp>
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+#include <boost/atomic.hpp>
 
 #include "MPO.hpp"
+#include "AsioAdaptor.hpp"
 
 
 using namespace std;
 using namespace MPO;
 
 
+// Count the heap allocations to check the steady state of the Message queue
+static boost::atomic<size_t> nbrAllocations( 0 );
+
+// Count and allocate with malloc, nullptr if out of memory
+static void* countedMalloc( size_t size )
+{
+    nbrAllocations.fetch_add( 1, boost::memory_order_relaxed );
+    return malloc( size ? size : 1 );
+}
+
+void* operator new( size_t size )
+{
+    if( void* p = countedMalloc( size ) )
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[]( size_t size )
+{
+    if( void* p = countedMalloc( size ) )
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new( size_t size, const std::nothrow_t& ) BOOST_NOEXCEPT
+{
+    return countedMalloc( size );
+}
+
+void* operator new[]( size_t size, const std::nothrow_t& ) BOOST_NOEXCEPT
+{
+    return countedMalloc( size );
+}
+
+// Release with free, not inlined so that the compiler doesn't pair the
+// free with the operator new of the caller
+static BOOST_NOINLINE void countedFree( void* p ) { free( p ); }
+
+void operator delete( void* p ) BOOST_NOEXCEPT { countedFree( p ); }
+void operator delete[]( void* p ) BOOST_NOEXCEPT { countedFree( p ); }
+void operator delete( void* p, size_t ) BOOST_NOEXCEPT { countedFree( p ); }
+void operator delete[]( void* p, size_t ) BOOST_NOEXCEPT { countedFree( p ); }
+void operator delete( void* p, const std::nothrow_t& ) BOOST_NOEXCEPT { countedFree( p ); }
+void operator delete[]( void* p, const std::nothrow_t& ) BOOST_NOEXCEPT { countedFree( p ); }
+
+
 // Serie of test to validate the MPO package.
 
 
@@ -156,6 +210,66 @@ private:
 };
 const TypeDef Ball::m_type( "Ball", &Message::Type() );
 
+class PooledBall : public PooledMessage<PooledBall>
+{
+public:
+    PooledBall( int count = 0 ) : count(count) {}
+    typedef boost::shared_ptr<PooledBall> Ptr;
+    static const TypeDef& Type() { return PooledBall::m_type; }
+    virtual const TypeDef& type() const { return PooledBall::Type(); }
+    int count;
+private:
+    static const TypeDef m_type;
+};
+const TypeDef PooledBall::m_type( "PooledBall", &Message::Type() );
+
+class Frame : public BufferMessage<Frame>
+{
+public:
+    Frame( const BufferSlice& payload ) : BufferMessage( payload ) {}
+    typedef boost::shared_ptr<Frame> Ptr;
+    static const TypeDef& Type() { return Frame::m_type; }
+    virtual const TypeDef& type() const { return Frame::Type(); }
+private:
+    static const TypeDef m_type;
+};
+const TypeDef Frame::m_type( "Frame", &Message::Type() );
+
+class Position : public Message
+{
+public:
+    struct Data { double x, y; boost::int32_t id; } data;
+    typedef boost::shared_ptr<Position> Ptr;
+    static const TypeDef& Type() { return Position::m_type; }
+    virtual const TypeDef& type() const { return Position::Type(); }
+private:
+    static const TypeDef m_type;
+};
+const TypeDef Position::m_type( "Position", &Message::Type() );
+
+class Samples : public Message
+{
+public:
+    struct Data { boost::int16_t values[512]; } data;
+    typedef boost::shared_ptr<Samples> Ptr;
+    static const TypeDef& Type() { return Samples::m_type; }
+    virtual const TypeDef& type() const { return Samples::Type(); }
+private:
+    static const TypeDef m_type;
+};
+const TypeDef Samples::m_type( "Samples", &Message::Type() );
+
+class Heartbeat : public Message
+{
+public:
+    typedef boost::shared_ptr<Heartbeat> Ptr;
+    static const TypeDef& Type() { return Heartbeat::m_type; }
+    virtual const TypeDef& type() const { return Heartbeat::Type(); }
+private:
+    static const TypeDef m_type;
+};
+const TypeDef Heartbeat::m_type( "Heartbeat", &Message::Type() );
+
 class Ping : public Action
 {
 public:
@@ -230,6 +344,77 @@ public:
 };
 const TypeDef Pong::m_type( "Pong", &Action::Type() );
 
+int nbrNotifications = 0;
+void countNotification()
+{
+    ++nbrNotifications;
+}
+
+int nbrBallCounted = 0;
+void countBall( Ball::Ptr, Link * )
+{
+    ++nbrBallCounted;
+}
+
+// Emit the ball again through its Signal, then connect one more counter
+Signal<Ball>* rewiredSignal = nullptr;
+SlotFunction<Ball,&countBall>* rewiredCounters = nullptr;
+size_t nbrRewired = 0;
+void rewireSignal( Ball::Ptr ball, Link * )
+{
+    if( nbrRewired == 8 )
+        return;
+    SlotFunction<Ball,&countBall>& counter = rewiredCounters[nbrRewired++];
+    rewiredSignal->emit( ball );
+    Link::connect( rewiredSignal, &counter );
+}
+
+// Count the balls received through control Links
+int nbrControlBallCounted = 0;
+void countControlBall( Ball::Ptr, Link * )
+{
+    ++nbrControlBallCounted;
+}
+
+// Count the writable again notifications
+int nbrWritable = 0;
+void countWritable()
+{
+    ++nbrWritable;
+}
+
+// Producer thread emitting nbr Ball with the given signal
+void emitBalls( Signal<Ball>* signal, int nbr )
+{
+    Ball::Ptr ball( new Ball() );
+    for( int i = 0; i < nbr; ++i )
+        signal->emit( ball );
+}
+
+// Emit nbrThreads*nbr Ball from nbrThreads threads while processing them
+void emitBallsFromThreads( Signal<Ball>& signal, int nbrThreads, int nbr )
+{
+    nbrBallCounted = 0;
+    boost::thread_group producers;
+    for( int i = 0; i < nbrThreads; ++i )
+        producers.create_thread( boost::bind( &emitBalls, &signal, nbr ) );
+    while( nbrBallCounted != nbrThreads*nbr )
+        Message::processNext();
+    producers.join_all();
+}
+
+// Process the Message queue of the Domain until stop is set and it is empty
+void runDomain( Domain* domain, boost::atomic<bool>* stop )
+{
+    for(;;)
+        if( !domain->processNext() )
+        {
+            if( stop->load() && domain->empty() )
+                return;
+            boost::this_thread::yield();
+        }
+}
+
 int nbrBallCatched = 0;
 void catchBall( Ball::Ptr ball, Link * )
 {
@@ -237,6 +422,158 @@ void catchBall( Ball::Ptr ball, Link * )
         nbrBallCatched++;
 }
 
+// Sum the counts of the received pooled balls
+int nbrPooledBallCounted = 0;
+void countPooledBall( PooledBall::Ptr ball, Link * )
+{
+    nbrPooledBallCounted += ball->count;
+}
+
+// Create and release pooled balls from a thread
+void createPooledBalls( size_t nbr )
+{
+    std::vector<PooledBall::Ptr> balls;
+    for( size_t i = 0; i < nbr; ++i )
+        balls.push_back( PooledBall::create( int(i) ) );
+}
+
+// Record the reference count of the received ball
+long ballUseCount = 0;
+void holdBall( Ball::Ptr ball, Link * )
+{
+    ballUseCount = ball.use_count();
+}
+
+// Record the reference count of the watched ball borrowed by the slot
+Ball::Ptr watchedBall;
+void borrowBall( const Ball& ball, Link * )
+{
+    if( &ball == watchedBall.get() )
+        ballUseCount = watchedBall.use_count();
+}
+
+
+// Count the batches and the balls received by a batch slot
+class BallBatcher
+{
+protected:
+    void receive( const Ball::Ptr* balls, size_t n, Link * )
+    {
+        ++nbrBatches;
+        for( size_t i = 0; i < n; ++i )
+            if( balls[i] )
+                ++nbrBalls;
+    }
+public:
+    BallBatcher() : input(this, 4), nbrBatches(0), nbrBalls(0) {}
+    BatchSlot<Ball, BallBatcher, &BallBatcher::receive> input;
+    int nbrBatches;
+    int nbrBalls;
+};
+
+// Record the payload address of the received frames
+int nbrFramesShared = 0;
+const char* sharedPayload = nullptr;
+void checkFrame( Frame::Ptr frame, Link * )
+{
+    if( frame->data() == sharedPayload )
+        ++nbrFramesShared;
+}
+
+// Count the pooled balls modified in place
+int nbrMutatedInPlace = 0;
+void mutatePooledBall( PooledBall::Ptr ball, Link * )
+{
+    PooledBall* received = ball.get();
+    Message::mutate( ball ).count += 1;
+    if( ball.get() == received )
+        ++nbrMutatedInPlace;
+    nbrPooledBallCounted += ball->count;
+}
+
+// Check the order and content of the received positions
+int nbrPositions = 0;
+bool positionsInOrder = true;
+void receivePosition( Position::Ptr position, Link * )
+{
+    if( position->data.id != nbrPositions ||
+            position->data.x != 0.5 * position->data.id )
+        positionsInOrder = false;
+    ++nbrPositions;
+}
+
+// Sum the first and last values of the received samples
+int samplesSum = 0;
+void receiveSamples( Samples::Ptr samples, Link * )
+{
+    samplesSum += samples->data.values[0] + samples->data.values[511];
+}
+
+// Encode a heartbeat in no byte
+size_t encodeHeartbeat( const Message&, void*, size_t )
+{
+    return 0;
+}
+
+// Decode a heartbeat from no byte
+Message::Ptr decodeHeartbeat( const void*, size_t )
+{
+    return Message::Ptr( new Heartbeat() );
+}
+
+// Count the received heartbeats
+int nbrHeartbeats = 0;
+void receiveHeartbeat( Heartbeat::Ptr, Link * )
+{
+    ++nbrHeartbeats;
+}
+
+// Remove the segments of a journal and its directory
+void removeJournal( const string& directory )
+{
+    for( unsigned index = 1; index < 100; ++index )
+    {
+        char name[32];
+        sprintf( name, "/journal-%08u.mpoj", index );
+        remove( ( directory + name ).c_str() );
+    }
+    remove( directory.c_str() );
+}
+
+// Record the number of balls counted when the probe handler runs
+int nbrBallCountedByProbe = -1;
+void probeBallCount()
+{
+    nbrBallCountedByProbe = nbrBallCounted;
+}
+
+#ifdef MPO_HAS_COROUTINES
+// Coroutine slot incrementing the ping counter of the balls in a job
+class BallTasker
+{
+public:
+    BallTasker() : nbrStarted(0), nbrCompleted(0), countedWhenResumed(-1),
+        overlapped(false), input(this) {}
+
+    Task increment( Ball::Ptr ball, Link * )
+    {
+        if( ++nbrStarted != nbrCompleted + 1 )
+            overlapped = true;
+        auto job = [ball]() {
+            boost::this_thread::sleep_for( boost::chrono::milliseconds( 1 ) );
+            return ball->pingCnt + 1; };
+        int count = co_await offload( job );
+        if( countedWhenResumed < 0 )
+            countedWhenResumed = nbrBallCounted;
+        ball->pingCnt = count;
+        ++nbrCompleted;
+    }
+
+    int nbrStarted, nbrCompleted, countedWhenResumed;
+    bool overlapped;
+    TaskSlot<Ball, BallTasker, &BallTasker::increment> input;
+};
+#endif
 
 int main()
 {
@@ -244,7 +581,8 @@ int main()
     MsgA::Ptr ma( new MsgA() );
     MsgB::Ptr mb( new MsgB() );
 
-    MyAction::Ptr action(new MyAction("myAction"));
+    // The Action map owns the instance, get a shared_ptr from it
+    MyAction::Ptr action = (new MyAction("myAction"))->getPtr<MyAction>();
     std::string op;
 
     cout << "Test Slot dynamic cast : ";
@@ -354,6 +692,20 @@ int main()
     // action->m_signalMsgB.emit( ma ); // Ok: static Error
     action->m_signalMsgB.emit( mb );
 
+    // Subtype checks follow the class hierarchy
+    if( !MsgB::Type().isSameOrSubtypeOf( &MsgA::Type() ) ||
+        !MsgB::Type().isSameOrSubtypeOf( &Message::Type() ) ||
+        !MsgA::Type().isSameOrSubtypeOf( &MsgA::Type() ) ||
+        MsgA::Type().isSameOrSubtypeOf( &MsgB::Type() ) ||
+        Message::Type().isSameOrSubtypeOf( &MsgA::Type() ) ||
+        Ball::Type().isSameOrSubtypeOf( &MsgA::Type() ) ||
+        MsgB::Type().depth() != 2 )
+    {
+        cout << "Failed!" << endl;
+        cout << "   Invalid TypeDef subtype check." << endl;
+        exit(1);
+    }
+
     cout << "Ok" << endl;
 
     cout << "Test connecting links  : ";
@@ -389,6 +741,19 @@ int main()
             cout << "   Link myAction::signalMsgM -> myAction::slotMsgM exist." << endl;
             exit(1);
         }
+
+        // Connect with the Action and port names
+        if( !Link::connect( "myAction", "signalMsgM", "myAction", "slotMsgM" ) ||
+            !Link::isConnected( "myAction::signalMsgM", "myAction::slotMsgM") ||
+            !Link::disconnect( "myAction", "signalMsgM", "myAction", "slotMsgM" ) ||
+            Link::isConnected( "myAction::signalMsgM", "myAction::slotMsgM") ||
+            Link::connect( "myAction", "signalMsgM", "noAction", "slotMsgM" ) ||
+            Link::connect( "myAction", "noSignal", "myAction", "slotMsgM" ) )
+        {
+            cout << "Failed!" << endl;
+            cout << "   Link by Action and port names failed." << endl;
+            exit(1);
+        }
         cout << "Ok" << endl;
 
 
@@ -401,6 +766,64 @@ int main()
         action->expectDynamicType( op, "MsgB" );
         action->expectStaticType( op, "Message" );
         Link::disconnect( "myAction::signalMsgM", "myAction::slotMsgM");
+
+        // A Message signal may emit Message the MsgA slot must ignore
+        Link::connect( "myAction::signalMsgM", "myAction::slotMsgA");
+        op = "   Invoke action m_signalMsgM with mm";
+        action->m_signalMsgM.emit( mm );
+        while( Message::processNext() );
+        action->expectDynamicType( op, "" );
+        op = "   Invoke action m_signalMsgM with mb";
+        action->m_signalMsgM.emit( mb );
+        while( Message::processNext() );
+        action->expectDynamicType( op, "MsgB" );
+        action->expectStaticType( op, "MsgA" );
+        Link::disconnect( "myAction::signalMsgM", "myAction::slotMsgA");
+        cout << "Ok" << endl;
+
+        cout << "Test batch processing  : ";
+
+        op = "   Process batches of m_signalMsgA with ma";
+        Message::setMessageNotifier( &countNotification );
+        Link::connect( "myAction::signalMsgA", "myAction::slotMsgA");
+        for( int i = 0; i < 10; ++i )
+            action->m_signalMsgA.emit( ma );
+        if( nbrNotifications != 1 )
+        {
+            cout << "Failed!" << endl;
+            cout << "   Burst of 10 Message notified " << nbrNotifications
+                 << " times instead of 1." << endl;
+            exit(1);
+        }
+        if( Message::processBatch( 4 ) != 4 )
+        {
+            cout << "Failed!" << endl;
+            cout << "   processBatch(4) didn't process 4 Message." << endl;
+            exit(1);
+        }
+        if( Message::processUntil( boost::chrono::steady_clock::now() +
+                                   boost::chrono::seconds(1) ) != 6 )
+        {
+            cout << "Failed!" << endl;
+            cout << "   processUntil() didn't process the 6 remaining Message."
+                 << endl;
+            exit(1);
+        }
+        Message::setHighWaterMark( 5 );
+        for( int i = 0; i < 10; ++i )
+            action->m_signalMsgA.emit( ma );
+        if( nbrNotifications != 3 )
+        {
+            cout << "Failed!" << endl;
+            cout << "   High water mark not notified." << endl;
+            exit(1);
+        }
+        while( Message::processNext() );
+        Message::setHighWaterMark( 0 );
+        Message::setMessageNotifier( 0 );
+        Link::disconnect( "myAction::signalMsgA", "myAction::slotMsgA");
+        action->expectDynamicType( op, "MsgA" );
+        action->expectStaticType( op, "MsgA" );
         cout << "Ok" << endl;
 
         cout << "Test Action network    : ";
@@ -471,6 +894,109 @@ int main()
         }
         cout << "Ok" << endl;
 
+        cout << "Test direct links      : ";
+        {
+            Ping* directPing = new Ping( "directPing" );
+            Pong* directPong = new Pong( "directPong" );
+            Link::connect( &directPing->m_output, &directPong->m_input, false, Link::Direct );
+            Link::connect( &directPong->m_output, &directPing->m_input, false, Link::Direct );
+            SlotFunction<Ball,&countBall> counter;
+            Link::connect( &directPing->m_output, &counter );
+
+            // The cycle is called directly until the nested calls reach the
+            // maximum depth, its Message is then queued behind the 3 queued
+            // for the counter by the nested Ping calls
+            nbrBallCounted = 0;
+            Ball::Ptr directBall( new Ball() );
+            directPing->m_output.freeze();
+            directPing->start( directBall, 1000 );
+            int countedWhenStarted = nbrBallCounted;
+            size_t queuedWhenStarted = Domain::main().size();
+            directPing->m_output.unfreeze();
+            while( Message::processNext() );
+            Link* link = directPing->m_output.links().find( &directPong->m_input )->second;
+            if( !link->isDirect() || countedWhenStarted != 0 ||
+                    queuedWhenStarted != 4 ||
+                    directBall->pingCnt != 1000 || directBall->pongCnt != 1000 ||
+                    nbrBallCounted != 1000 )
+            {
+                cout << "Failed!" << endl;
+                cout << "   Direct links bounced " << directBall->pingCnt
+                     << " pings and " << directBall->pongCnt << " pongs" << endl;
+                exit(1);
+            }
+
+            // A direct Slot rewiring the Signal and emitting through it
+            // again doesn't invalidate the runs of the outer emit
+            Signal<Ball> signal;
+            SlotFunction<Ball,&rewireSignal> rewirer;
+            SlotFunction<Ball,&countBall> queuedCounter, counters[8];
+            rewiredSignal = &signal;
+            rewiredCounters = counters;
+            Link::connect( &signal, &rewirer, false, Link::Direct );
+            Link::connect( &signal, &queuedCounter );
+            nbrBallCounted = 0;
+            signal.emit( directBall );
+            while( Message::processNext() );
+            if( nbrRewired != 8 || signal.links().size() != 10 ||
+                    nbrBallCounted == 0 )
+            {
+                cout << "Failed!" << endl;
+                cout << "   Rewired " << nbrRewired << " Links, counted "
+                     << nbrBallCounted << " balls" << endl;
+                exit(1);
+            }
+        }
+        cout << "Ok" << endl;
+
+        cout << "Test queue allocations : ";
+
+        // The queue capacity was reached by the previous run, replaying the
+        // ping pong transactions must not allocate memory.
+        size_t nbrAllocationsBefore = nbrAllocations;
+        ping->start( ball, 15 );
+        while( Message::processNext() );
+        if( nbrAllocations != nbrAllocationsBefore )
+        {
+            cout << "Failed!" << endl;
+            cout << "   Ping pong performed " << nbrAllocations - nbrAllocationsBefore
+                 << " allocations." << endl;
+            exit(1);
+        }
+
+        // The nodes of the multiple producers queue are recycled once it
+        // reached the peak length of the replay
+        Message::setMultiProducer( true );
+        ping->start( ball, 15 );
+        while( Message::processNext() );
+        nbrAllocationsBefore = nbrAllocations;
+        ping->start( ball, 15 );
+        while( Message::processNext() );
+        Message::setMultiProducer( false );
+        if( nbrAllocations != nbrAllocationsBefore )
+        {
+            cout << "Failed!" << endl;
+            cout << "   Multiple producers ping pong performed "
+                 << nbrAllocations - nbrAllocationsBefore
+                 << " allocations." << endl;
+            exit(1);
+        }
+
+        // Deleting a Link must leave no pending Message for it in the queue
+        Ball::Ptr ball2( new Ball() );
+        ping->start( ball2, 15 );
+        Link::disconnect( "Pong2::output", "Ping::input" );
+        Link::disconnect( "Ping::output", "Pong2::input" );
+        while( Message::processNext() );
+        if( ball2->pongCnt != ball2->maxCount )
+        {
+            cout << "Failed!" << endl;
+            cout << "   Ball pong counter is not " << ball2->maxCount
+                 << ". Found " << ball2->pongCnt << endl;
+            exit(1);
+        }
+        cout << "Ok" << endl;
+
         cout << "Test free functions    : ";
 
         SlotFunction<Ball,&catchBall> slotBall;
@@ -517,6 +1043,1141 @@ int main()
         }
         cout << "Ok" << endl;
 
+        cout << "Test fan out           : ";
+        {
+            Signal<Ball> signal;
+            SlotFunction<Ball,&countBall> slots[8];
+            for( int i = 0; i < 8; ++i )
+                Link::connect( &signal, &slots[i] );
+
+            // All entries of an emit are queued with a single notification
+            nbrNotifications = 0;
+            nbrBallCounted = 0;
+            Message::setMessageNotifier( &countNotification );
+            signal.emit( ball );
+            Message::setMessageNotifier( 0 );
+            while( Message::processNext() );
+            if( nbrNotifications != 1 || nbrBallCounted != 8 )
+            {
+                cout << "Failed!" << endl;
+                cout << "   Emit to 8 slots notified " << nbrNotifications
+                     << " times and delivered " << nbrBallCounted << endl;
+                exit(1);
+            }
+
+            // Disconnecting a link in the middle keeps the others connected
+            Link::disconnect( &signal, &slots[3] );
+            signal.emit( ball );
+            while( Message::processNext() );
+            if( nbrBallCounted != 15 || signal.links().size() != 7 ||
+                    slots[7].links().size() != 1 || !slots[3].links().empty() )
+            {
+                cout << "Failed!" << endl;
+                cout << "   Emit to 7 slots delivered " << nbrBallCounted - 8
+                     << endl;
+                exit(1);
+            }
+        }
+        cout << "Ok" << endl;
+
+        cout << "Test topology          : ";
+        {
+            Signal<Ball> signal;
+            SlotFunction<Ball,&countBall> slots[8];
+            Topology topology;
+            topology.reserve( 10 );
+            for( int i = 0; i < 8; ++i )
+                topology.add( &signal, &slots[i] );
+            topology.add( &signal, &slots[0] );
+            topology.add( "myAction", "signalMsgM", "myAction", "slotMsgM" );
+            bool unknownThrows = false;
+            try { topology.add( "myAction::noSignal", "myAction::slotMsgM" ); }
+            catch( std::runtime_error& ) { unknownThrows = true; }
+
+            // Duplicated connections are built once
+            nbrBallCounted = 0;
+            if( !unknownThrows || topology.build() != 9 || topology.size() ||
+                    signal.links().size() != 8 ||
+                    !Link::isConnected( "myAction::signalMsgM", "myAction::slotMsgM") )
+            {
+                cout << "Failed!" << endl;
+                cout << "   Topology built " << signal.links().size()
+                     << " links from signal" << endl;
+                exit(1);
+            }
+            signal.emit( ball );
+            while( Message::processNext() );
+
+            // Links of the Arena are released one by one
+            Link::disconnect( "myAction::signalMsgM", "myAction::slotMsgM" );
+            Link::disconnect( &signal, &slots[5] );
+            if( nbrBallCounted != 8 || signal.links().size() != 7 ||
+                    Link::isConnected( "myAction::signalMsgM", "myAction::slotMsgM") )
+            {
+                cout << "Failed!" << endl;
+                cout << "   Emit to topology delivered " << nbrBallCounted
+                     << endl;
+                exit(1);
+            }
+        }
+        cout << "Ok" << endl;
+
+        cout << "Test frozen signals    : ";
+        {
+            Signal<Ball> signal;
+            SlotFunction<Ball,&countBall> slots[4];
+            Topology topology;
+            for( int i = 0; i < 4; ++i )
+                topology.add( &signal, &slots[i] );
+            nbrBallCounted = 0;
+            bool rewiringThrows = false;
+            {
+                // The plan follows the Slots destroyed while frozen
+                SlotFunction<Ball,&countBall> slotGone;
+                topology.add( &signal, &slotGone );
+                topology.build();
+                topology.freeze();
+                try { Link::disconnect( &signal, &slots[0] ); }
+                catch( std::runtime_error& ) { rewiringThrows = true; }
+                signal.emit( ball );
+            }
+            while( Message::processNext() );
+
+            // and the Links changing their mode
+            Link::setCoalescing( &signal, &slots[1], true );
+            signal.emit( ball );
+            signal.emit( ball );
+            while( Message::processNext() );
+            SlotFunction<Ball,&countBall> slotNew;
+            bool connectThrows = false;
+            try { Link::connect( &signal, &slotNew ); }
+            catch( std::runtime_error& ) { connectThrows = true; }
+            bool frozen = signal.isFrozen();
+            topology.unfreeze();
+            if( !rewiringThrows || !connectThrows || !frozen ||
+                    nbrBallCounted != 11 || signal.links().size() != 4 ||
+                    !Link::connect( &signal, &slotNew ) || signal.isFrozen() )
+            {
+                cout << "Failed!" << endl;
+                cout << "   Frozen signal delivered " << nbrBallCounted
+                     << " balls to " << signal.links().size() << " links"
+                     << endl;
+                exit(1);
+            }
+
+            // The plan of an unfrozen Signal follows its rewiring
+            signal.emit( ball );
+            while( Message::processNext() );
+            Link::disconnect( &signal, &slots[2] );
+            signal.emit( ball );
+            while( Message::processNext() );
+            if( nbrBallCounted != 11 + 5 + 4 )
+            {
+                cout << "Failed!" << endl;
+                cout << "   Rewired signal delivered " << nbrBallCounted
+                     << " balls" << endl;
+                exit(1);
+            }
+        }
+        cout << "Ok" << endl;
+
+        cout << "Test link teardown     : ";
+        {
+            Signal<Ball> signal;
+            SlotFunction<Ball,&countBall> slot;
+            nbrBallCounted = 0;
+
+            // Entries of a disconnected Link stay queued and are skipped
+            Link::connect( &signal, &slot );
+            for( int i = 0; i < 100; ++i )
+                signal.emit( ball );
+            Link::disconnect( &signal, &slot );
+            Link::connect( &signal, &slot );
+            signal.emit( ball );
+            {
+                // A Slot may be destroyed with pending entries
+                SlotFunction<Ball,&countBall> slotGone;
+                Link::connect( &signal, &slotGone );
+                signal.emit( ball );
+            }
+            size_t queued = Domain::main().size();
+            size_t processed = Message::processBatch( queued );
+            if( queued != 103 || processed != 2 || nbrBallCounted != 2 ||
+                    !Domain::main().empty() )
+            {
+                cout << "Failed!" << endl;
+                cout << "   Processed " << processed << " of " << queued
+                     << " entries after re-wiring" << endl;
+                exit(1);
+            }
+        }
+        cout << "Ok" << endl;
+
+        cout << "Test graph arena       : ";
+        {
+            GraphArena arena( 1024 );
+            Ping* ping = new( arena ) Ping( "arenaPing" );
+            new( arena ) Pong( "arenaPong" );
+            Signal<Ball> outside;
+            SlotFunction<Ball,&countBall> counter;
+            arena.connect( "arenaPing", "output", "arenaPong", "input" );
+            arena.connect( "arenaPong", "output", "arenaPing", "input" );
+            arena.connect( "arenaPing", "output", "arenaPong", "input" );
+            arena.connect( &ping->m_output, &counter );
+            Topology topology;
+            topology.add( &outside, &counter );
+            topology.build( arena );
+            Link::connect( &outside, &ping->m_input );
+            nbrBallCounted = 0;
+            Ball::Ptr arenaBall( new Ball() );
+            ping->start( arenaBall, 10 );
+            while( Message::processNext() ) {}
+
+            // A Link of the arena may be disconnected alone, the others are
+            // detached with entries pending
+            Link::disconnect( &ping->m_output, &counter );
+            ping->start( arenaBall, 10 );
+            outside.emit( arenaBall );
+            size_t nbrLinks = arena.nbrLinks();
+            size_t nbrActions = arena.nbrActions();
+            arena.clear();
+            size_t queued = Domain::main().size();
+            size_t processed = Message::processBatch( queued );
+            bool reusable = ( new( arena ) Pong( "arenaPong" ) ) &&
+                            arena.nbrActions() == 1;
+            arena.clear();
+            if( nbrLinks != 4 || nbrActions != 2 || queued != 3 || processed != 0 ||
+                nbrBallCounted != 10 || Action::getAction( "arenaPing" ) ||
+                Action::getAction( "arenaPong" ) || !outside.links().empty() ||
+                !counter.links().empty() || !reusable )
+            {
+                cout << "Failed!" << endl;
+                cout << "   Arena of " << nbrLinks << " links and " << nbrActions
+                     << " actions left " << outside.links().size() << " links"
+                     << endl;
+                exit(1);
+            }
+        }
+        cout << "Ok" << endl;
+
+        cout << "Test priority lanes    : ";
+        {
+            Signal<Ball> bulk, control;
+            SlotFunction<Ball,&countBall> slotBulk;
+            SlotFunction<Ball,&countControlBall> slotControl;
+            bulk.setPriority( Message::BulkPriority );
+            Link::connect( &bulk, &slotBulk );
+            Link::connect( &control, &slotControl );
+            Link::setPriority( &control, &slotControl, Message::ControlPriority );
+            nbrBallCounted = 0;
+            nbrControlBallCounted = 0;
+
+            // A control Message overtakes the bulk Message queued before
+            for( int i = 0; i < 100; ++i )
+                bulk.emit( ball );
+            control.emit( ball );
+            size_t bulkSize = Message::laneSize( Message::BulkPriority );
+            size_t controlSize = Message::laneSize( Message::ControlPriority );
+            Message::processNext();
+            if( bulkSize != 100 || controlSize != 1 ||
+                    nbrControlBallCounted != 1 || nbrBallCounted != 0 )
+            {
+                cout << "Failed!" << endl;
+                cout << "   Control Message processed after " << nbrBallCounted
+                     << " bulk Message" << endl;
+                exit(1);
+            }
+            while( Message::processNext() );
+
+            // Weighted round robin serves 8 control Message per bulk one
+            Message::setScheduling( Message::WeightedRoundRobin );
+            for( int i = 0; i < 20; ++i )
+            {
+                bulk.emit( ball );
+                control.emit( ball );
+            }
+            Message::processBatch( 18 );
+            Message::setScheduling( Message::StrictPriority );
+            if( nbrControlBallCounted != 17 || nbrBallCounted != 102 )
+            {
+                cout << "Failed!" << endl;
+                cout << "   Round robin processed " << nbrControlBallCounted - 1
+                     << " control and " << nbrBallCounted - 100 << " bulk"
+                     << endl;
+                exit(1);
+            }
+            while( Message::processNext() );
+        }
+        cout << "Ok" << endl;
+
+        cout << "Test bounded queues    : ";
+        {
+            Signal<Ball> signal;
+            SlotFunction<Ball,&countBall> slot;
+            Link::connect( &signal, &slot );
+            Ball::Ptr last( new Ball() );
+            Message::setCapacity( 10 );
+            Message::setWritableNotifier( &countWritable );
+            nbrWritable = 0;
+            nbrBallCounted = 0;
+
+            // The new Message are dropped and tryEmit fails on a full queue
+            for( int i = 0; i < 15; ++i )
+                signal.emit( ball );
+            bool emitted = signal.tryEmit( ball );
+
+            // but the direct Links are called without room in the queue
+            Signal<Ball> direct;
+            SlotFunction<Ball,&countBall> directSlot;
+            Link::connect( &direct, &directSlot, false, Link::Direct );
+            bool called = direct.tryEmit( ball ) && nbrBallCounted == 1;
+            size_t queued = Domain::main().size();
+            Message::processBatch( 4 );
+            int writableBefore = nbrWritable;
+            Message::processNext();
+            if( emitted || !called || queued != 10 || writableBefore != 0 ||
+                    nbrWritable != 1 )
+            {
+                cout << "Failed!" << endl;
+                cout << "   Full queue held " << queued << " Message and "
+                     << "notified " << nbrWritable << " times" << endl;
+                exit(1);
+            }
+            while( Message::processNext() );
+
+            // Drop the oldest Message or replace the last one
+            const Message::OverflowPolicy policies[] =
+                { Message::DropNewest, Message::DropOldest, Message::Coalesce };
+            const long useCounts[] = { 1, 2, 2 };
+            for( int i = 0; i < 3; ++i )
+            {
+                Message::setOverflowPolicy( policies[i] );
+                for( int j = 0; j < 10; ++j )
+                    signal.emit( ball );
+                signal.emit( last );
+                if( Domain::main().size() != 10 || last.use_count() != useCounts[i] )
+                {
+                    cout << "Failed!" << endl;
+                    cout << "   Overflow policy " << i << " queued "
+                         << Domain::main().size() << " Message" << endl;
+                    exit(1);
+                }
+                while( Message::processNext() );
+            }
+
+            // Blocking the thread processing the queue would never return
+            Message::setOverflowPolicy( Message::Block );
+            bool blockThrows = false;
+            try
+            {
+                for( int i = 0; i < 11; ++i )
+                    signal.emit( ball );
+            }
+            catch( std::runtime_error& ) { blockThrows = true; }
+            while( Message::processNext() );
+            Message::setOverflowPolicy( Message::DropNewest );
+            Message::setCapacity( 0 );
+            Message::setWritableNotifier( 0 );
+            if( !blockThrows || nbrBallCounted != 1 + 10 + 3 * 10 + 10 )
+            {
+                cout << "Failed!" << endl;
+                cout << "   Block policy in processing thread didn't throw"
+                     << endl;
+                exit(1);
+            }
+        }
+        cout << "Ok" << endl;
+
+        cout << "Test coalescing links  : ";
+        {
+            Signal<Ball> state;
+            SlotFunction<Ball,&countBall> slotLatest, slotAll;
+            state.setCoalescing( true );
+            Link::connect( &state, &slotLatest );
+            Link::connect( &state, &slotAll );
+            Link::setCoalescing( &state, &slotAll, false );
+            Ball::Ptr last( new Ball() );
+            nbrBallCounted = 0;
+
+            // The pending Message of the coalescing Link is replaced
+            for( int i = 0; i < 10; ++i )
+                state.emit( ball );
+            state.emit( last );
+            size_t queued = Domain::main().size();
+            long lastCount = last.use_count();
+            while( Message::processNext() );
+            if( queued != 12 || lastCount != 3 || nbrBallCounted != 12 )
+            {
+                cout << "Failed!" << endl;
+                cout << "   Coalescing link queued " << queued - 11
+                     << " Message" << endl;
+                exit(1);
+            }
+
+            // Message from another Domain are coalesced when drained
+            Link::disconnect( &state, &slotAll );
+            Domain domain;
+            slotLatest.setDomain( domain );
+            for( int i = 0; i < 5; ++i )
+                state.emit( ball );
+            size_t sent = domain.size();
+            size_t processed = domain.processBatch( sent );
+            if( sent != 5 || processed != 1 || !domain.empty() )
+            {
+                cout << "Failed!" << endl;
+                cout << "   Processed " << processed << " of " << sent
+                     << " Message sent to a coalescing link" << endl;
+                exit(1);
+            }
+            slotLatest.setDomain( Domain::main() );
+        }
+        cout << "Ok" << endl;
+
+        cout << "Test batch slots       : ";
+        {
+            Signal<Ball> signal, other;
+            SlotFunction<Ball,&countBall> slotCount;
+            BallBatcher batcher;
+            Link::connect( &signal, &batcher.input );
+            Link::connect( &other, &slotCount );
+            nbrBallCounted = 0;
+
+            // Consecutive entries are delivered by batches of 4 at most
+            for( int i = 0; i < 10; ++i )
+                signal.emit( ball );
+            other.emit( ball );
+            signal.emit( ball );
+            while( Message::processNext() );
+            if( batcher.nbrBatches != 4 || batcher.nbrBalls != 11 ||
+                nbrBallCounted != 1 )
+            {
+                cout << "Failed!" << endl;
+                cout << "   Delivered " << batcher.nbrBalls << " Message in "
+                     << batcher.nbrBatches << " batches" << endl;
+                exit(1);
+            }
+
+            // A batch doesn't exceed the entries processBatch may process
+            batcher.nbrBatches = batcher.nbrBalls = 0;
+            batcher.input.setBatchSize( 64 );
+            for( int i = 0; i < 10; ++i )
+                signal.emit( ball );
+            size_t processed = Message::processBatch( 3 );
+            while( Message::processNext() );
+            if( processed != 3 || batcher.nbrBatches != 2 ||
+                batcher.nbrBalls != 10 )
+            {
+                cout << "Failed!" << endl;
+                cout << "   Processed " << processed << " Message in a batch "
+                     << "of " << batcher.nbrBatches << " calls" << endl;
+                exit(1);
+            }
+        }
+        cout << "Ok" << endl;
+
+        cout << "Test instrumentation   : ";
+        {
+            // Histogram buckets keep a relative precision of 12.5%
+            Histogram histogram;
+            for( boost::uint64_t v = 1; v <= 1000; ++v )
+                histogram.record( v );
+            HistogramSnapshot snapshot = histogram.snapshot();
+            boost::uint64_t median = snapshot.percentile( 50 );
+            if( snapshot.count != 1000 || snapshot.max != 1000 ||
+                median < 500 || median > 563 ||
+                snapshot.percentile( 100 ) != 1000 ||
+                Histogram::lowerBound( Histogram::bucket( 1234567 ) ) > 1234567 )
+            {
+                cout << "Failed!" << endl;
+                cout << "   Histogram median of 1..1000 is " << median << endl;
+                exit(1);
+            }
+
+            Signal<Ball> signal;
+            SlotFunction<Ball,&countBall> slot;
+            Link::connect( &signal, &slot );
+            Link* link = signal.links().begin()->second;
+            for( int i = 0; i < 5; ++i )
+                signal.emit( ball );
+            while( Message::processNext() );
+#ifdef MPO_INSTRUMENTATION
+            bool recorded = link->stats().count() == 5 &&
+                slot.stats().count() == 5 &&
+                slot.stats().executionTime().count == 5 &&
+                Message::stats().maxDepth() >= 5 &&
+                Message::stats().latency().count >= 5;
+#else
+            // Without instrumentation nothing is recorded
+            bool recorded = !Instrumentation::enabled &&
+                link->stats().count() == 0 &&
+                slot.stats().executionTime().count == 0 &&
+                Message::stats().maxDepth() == 0;
+#endif
+            if( !recorded )
+            {
+                cout << "Failed!" << endl;
+                cout << "   Link forwarded " << link->stats().count()
+                     << " Message, queue depth " << Message::stats().maxDepth()
+                     << endl;
+                exit(1);
+            }
+        }
+        cout << "Ok" << endl;
+
+        cout << "Test dispatch tracing  : ";
+        {
+            Signal<Ball> signal;
+            SlotFunction<Ball,&countBall> slot1, slot2;
+            Link::connect( &signal, &slot1 );
+            Link::connect( &signal, &slot2 );
+
+            // Each Link records an enqueue, a dispatch begin and end event
+            Trace::enable( 16 );
+            signal.emit( ball );
+            while( Message::processNext() );
+            Trace::disable();
+            signal.emit( ball );
+            while( Message::processNext() );
+            const char* path = "mpo-test.trace";
+            size_t nbrRecords = Trace::flush( path );
+            TraceFileHeader header;
+            FILE* file = fopen( path, "rb" );
+            bool valid = file && fread( &header, sizeof(header), 1, file ) == 1 &&
+                         memcmp( header.magic, "MPOTRACE", 8 ) == 0 &&
+                         header.nbrThreads == 1 && header.nbrTypes == 1;
+            if( file )
+                fclose( file );
+            remove( path );
+            size_t nbrFlushedAgain = Trace::flush( path );
+            remove( path );
+            if( nbrRecords != 6 || !valid || nbrFlushedAgain != 0 )
+            {
+                cout << "Failed!" << endl;
+                cout << "   Flushed " << nbrRecords << " records, expected 6"
+                     << endl;
+                exit(1);
+            }
+
+            // A direct Link records its dispatch events without enqueue
+            Signal<Ball> direct;
+            Link::connect( &direct, &slot1, false, Link::Direct );
+            Trace::enable( 16 );
+            direct.emit( ball );
+            Trace::disable();
+            nbrRecords = Trace::flush( path );
+            remove( path );
+            if( nbrRecords != 2 )
+            {
+                cout << "Failed!" << endl;
+                cout << "   Flushed " << nbrRecords << " records of a direct"
+                     << " Link, expected 2" << endl;
+                exit(1);
+            }
+        }
+        cout << "Ok" << endl;
+
+        cout << "Test message references: ";
+        {
+            Signal<Ball> signal;
+            SlotFunction<Ball,&holdBall> slotHold;
+            RefSlotFunction<Ball,&borrowBall> slotBorrow;
+            watchedBall.reset( new Ball() );
+
+            // The queued entry holds the only reference added by the emit
+            Link::connect( &signal, &slotHold );
+            signal.emit( watchedBall );
+            long queuedCount = watchedBall.use_count();
+            while( Message::processNext() );
+#ifndef BOOST_NO_CXX11_RVALUE_REFERENCES
+            long expectedCount = 2;
+#else
+            long expectedCount = 3;
+#endif
+            if( queuedCount != 2 || ballUseCount != expectedCount )
+            {
+                cout << "Failed!" << endl;
+                cout << "   Found use counts " << queuedCount << " queued and "
+                     << ballUseCount << " in slot for a single Link" << endl;
+                exit(1);
+            }
+            Link::disconnect( &signal, &slotHold );
+
+            // A reference slot borrows the Message from the queue entry
+            ballUseCount = 0;
+            Link::connect( &signal, &slotBorrow );
+            signal.emit( watchedBall );
+            while( Message::processNext() );
+            if( ballUseCount != 2 || watchedBall.use_count() != 1 )
+            {
+                cout << "Failed!" << endl;
+                cout << "   Found use count " << ballUseCount
+                     << " in reference slot" << endl;
+                exit(1);
+            }
+            watchedBall.reset();
+        }
+        cout << "Ok" << endl;
+
+        cout << "Test buffer messages   : ";
+        {
+            boost::shared_ptr<Buffer> buffer = Buffer::create( 1 << 20 );
+            for( size_t i = 0; i < buffer->size(); ++i )
+                buffer->data()[i] = char( i );
+            Signal<Frame> signal;
+            SlotFunction<Frame,&checkFrame> slot1, slot2, slot3;
+            Link::connect( &signal, &slot1 );
+            Link::connect( &signal, &slot2 );
+            Link::connect( &signal, &slot3 );
+
+            // The fanned out frames share the payload of the Buffer
+            Frame::Ptr frame = Frame::create( BufferSlice( buffer ) );
+            sharedPayload = buffer->data();
+            nbrFramesShared = 0;
+            signal.emit( frame );
+            while( Message::processNext() );
+            bool aligned = reinterpret_cast<size_t>( buffer->data() ) %
+                           Buffer::DefaultAlignment == 0;
+            if( nbrFramesShared != 3 || !aligned || buffer.use_count() != 2 )
+            {
+                cout << "Failed!" << endl;
+                cout << "   " << nbrFramesShared << " of 3 frames shared the "
+                     << "payload" << endl;
+                exit(1);
+            }
+
+            // A sub slice views the same bytes and its range is checked
+            BufferSlice slice = frame->payload().slice( 1000, 24 ).slice( 8 );
+            bool rejected = false;
+            try { slice.slice( 10, 7 ); }
+            catch( const std::runtime_error& ) { rejected = true; }
+            if( slice.size() != 16 || slice.data() != buffer->data() + 1008 ||
+                slice.data()[0] != char( 1008 ) || !rejected )
+            {
+                cout << "Failed!" << endl;
+                cout << "   Sub slice has " << slice.size() << " bytes at "
+                     << "offset " << slice.offset() << endl;
+                exit(1);
+            }
+        }
+        cout << "Ok" << endl;
+
+        cout << "Test message pool      : ";
+        {
+            // The memory of a released Message is reused by the next one
+            PooledBall* first = PooledBall::create( 1 ).get();
+            size_t nbrAllocationsBefore = nbrAllocations;
+            PooledBall::Ptr pooled = PooledBall::create( 2 );
+            if( pooled.get() != first || pooled->count != 2 ||
+                    nbrAllocations != nbrAllocationsBefore )
+            {
+                cout << "Failed!" << endl;
+                cout << "   Pooled Message memory was not recycled" << endl;
+                exit(1);
+            }
+
+            // Pooled Message are emitted as any other Message
+            Signal<Message> signal;
+            SlotFunction<PooledBall,&countPooledBall> slot;
+            Link::connect( &signal, &slot );
+            signal.emit( pooled );
+            pooled.reset();
+            while( Message::processNext() );
+            if( nbrPooledBallCounted != 2 )
+            {
+                cout << "Failed!" << endl;
+                cout << "   Pooled ball counter is not 2. Found "
+                     << nbrPooledBallCounted << endl;
+                exit(1);
+            }
+
+            // The free list of an exiting thread is recycled by the others
+            std::vector<PooledBall::Ptr> balls;
+            balls.reserve( 200 );
+            boost::thread creator( boost::bind( &createPooledBalls, 200 ) );
+            creator.join();
+            nbrAllocationsBefore = nbrAllocations;
+            for( int i = 0; i < 200; ++i )
+                balls.push_back( PooledBall::create( i ) );
+            if( nbrAllocations != nbrAllocationsBefore )
+            {
+                cout << "Failed!" << endl;
+                cout << "   Pooled Message memory of an exited thread was not"
+                     << " recycled" << endl;
+                exit(1);
+            }
+        }
+        cout << "Ok" << endl;
+
+#ifndef BOOST_NO_CXX11_RVALUE_REFERENCES
+        cout << "Test copy on write     : ";
+        {
+            Signal<PooledBall> signal;
+            SlotFunction<PooledBall,&mutatePooledBall> slot1, slot2, slot3;
+            PooledBall::Ptr ball = PooledBall::create( 1 );
+            nbrMutatedInPlace = nbrPooledBallCounted = 0;
+
+            // A single Link gives the Slot the only reference
+            Link::connect( &signal, &slot1 );
+            signal.emit( ball );
+            ball.reset();
+            while( Message::processNext() );
+            if( nbrMutatedInPlace != 1 || nbrPooledBallCounted != 2 )
+            {
+                cout << "Failed!" << endl;
+                cout << "   Sole owner copied the Message" << endl;
+                exit(1);
+            }
+
+            // Fanned out to 3 Slots, the Message is copied for all but the
+            // last one and the producer Message is unchanged
+            Link::connect( &signal, &slot2 );
+            Link::connect( &signal, &slot3 );
+            ball = PooledBall::create( 1 );
+            nbrMutatedInPlace = nbrPooledBallCounted = 0;
+            signal.emit( ball );
+            PooledBall::Ptr kept = ball;
+            ball.reset();
+            while( Message::processNext() );
+            if( nbrMutatedInPlace != 0 || nbrPooledBallCounted != 6 ||
+                kept->count != 1 )
+            {
+                cout << "Failed!" << endl;
+                cout << "   Mutated " << nbrMutatedInPlace << " shared Message"
+                     << " in place" << endl;
+                exit(1);
+            }
+            kept.reset();
+            nbrMutatedInPlace = nbrPooledBallCounted = 0;
+            signal.emit( PooledBall::create( 1 ) );
+            while( Message::processNext() );
+            if( nbrMutatedInPlace != 1 || nbrPooledBallCounted != 6 )
+            {
+                cout << "Failed!" << endl;
+                cout << "   Copied " << 3 - nbrMutatedInPlace << " of 3 fanned "
+                     << "out Message" << endl;
+                exit(1);
+            }
+        }
+        cout << "Ok" << endl;
+#endif
+
+        cout << "Test dispatch domains  : ";
+
+        // Pong processes its Message in its own Domain and thread
+        Ping* pingD = new Ping("PingD");
+        Pong* pongD = new Pong("PongD");
+        Domain domainPong;
+        pongD->setDomain( domainPong );
+        Link::connect( "PingD::output", "PongD::input");
+        Link::connect( "PongD::output", "PingD::input");
+        if( &pongD->m_input.domain() != &domainPong ||
+                &pingD->m_input.domain() != &Domain::main() )
+        {
+            cout << "Failed!" << endl;
+            cout << "   Slots not assigned to the Action Domain." << endl;
+            exit(1);
+        }
+        boost::atomic<bool> stopPong( false );
+        boost::thread threadPong( boost::bind( &runDomain, &domainPong, &stopPong ) );
+        Ball::Ptr ballD( new Ball() );
+        pingD->start( ballD, 1000 );
+        while( ballD->pingCnt != ballD->maxCount )
+            Message::processNext();
+        stopPong = true;
+        threadPong.join();
+        if( ballD->pongCnt != ballD->maxCount || !domainPong.empty() )
+        {
+            cout << "Failed!" << endl;
+            cout << "   Ball pong counter is not " << ballD->maxCount
+                 << ". Found " << ballD->pongCnt << endl;
+            exit(1);
+        }
+        Link::disconnect( "PingD::output", "PongD::input");
+        Link::disconnect( "PongD::output", "PingD::input");
+        cout << "Ok" << endl;
+
+        cout << "Test asio adaptor      : ";
+        {
+            boost::asio::io_context io;
+            Domain domain;
+            Signal<Ball> signal;
+            SlotFunction<Ball,&countBall> slot;
+            slot.setDomain( domain );
+            Link::connect( &signal, &slot );
+            nbrBallCounted = 0;
+            nbrBallCountedByProbe = -1;
+            AsioAdaptor adaptor( io, domain, boost::chrono::nanoseconds( 0 ), 100 );
+
+            // A handler processes a slice of 100 Message and reposts, other
+            // handlers run in between
+            for( int i = 0; i < 1000; ++i )
+                signal.emit( ball );
+            boost::asio::post( io, &probeBallCount );
+            io.run();
+            size_t nbrPosts = adaptor.nbrPosts();
+            if( nbrBallCounted != 1000 || nbrBallCountedByProbe != 100 ||
+                nbrPosts != 10 )
+            {
+                cout << "Failed!" << endl;
+                cout << "   Processed " << nbrBallCounted << " Message in "
+                     << nbrPosts << " handlers, probe saw "
+                     << nbrBallCountedByProbe << endl;
+                exit(1);
+            }
+
+            // The handler is posted again when the empty Domain gets Message
+            io.restart();
+            signal.emit( ball );
+            signal.emit( ball );
+            io.run();
+            if( nbrBallCounted != 1002 || adaptor.nbrPosts() != 11 )
+            {
+                cout << "Failed!" << endl;
+                cout << "   Posted " << adaptor.nbrPosts() - nbrPosts
+                     << " handlers for 2 Message" << endl;
+                exit(1);
+            }
+        }
+        cout << "Ok" << endl;
+
+        cout << "Test shared memory     : ";
+        {
+            MessageCodec::addTrivial<Position, Position::Data, &Position::data>();
+            ShmSender sender( "/mpo-test-shm", 4096 );
+            ShmReceiver receiver( "/mpo-test-shm" );
+            Signal<Position> signal;
+            SlotFunction<Position,&receivePosition> slot;
+            slot.setName( "Test::position" );
+            sender.bridge( &signal, "Test::position" );
+            sender.bridge( &signal, "Test::unknown" );
+
+            // The 4096 bytes ring holds 85 records of 48 bytes, it wraps
+            // around every other round
+            for( int round = 0; round < 10; ++round )
+            {
+                for( int i = 0; i < 30; ++i )
+                {
+                    Position::Ptr position( new Position() );
+                    position->data.id = round * 30 + i;
+                    position->data.x = 0.5 * position->data.id;
+                    signal.emit( position );
+                }
+                while( Message::processNext() ) {}
+                receiver.poll();
+                while( Message::processNext() ) {}
+            }
+            slot.unregisterName();
+            if( nbrPositions != 300 || !positionsInOrder ||
+                receiver.nbrDropped() != 300 || sender.nbrStalls() != 0 )
+            {
+                cout << "Failed!" << endl;
+                cout << "   Received " << nbrPositions << " positions, dropped "
+                     << receiver.nbrDropped() << endl;
+                exit(1);
+            }
+        }
+        cout << "Ok" << endl;
+
+        cout << "Test tcp transport     : ";
+        {
+            MessageCodec::addTrivial<Samples, Samples::Data, &Samples::data>();
+            TcpNode nodeB( "nodeB" );
+            TcpNode nodeA( "nodeA" );
+            nodeA.addPeer( "nodeB", "127.0.0.1", nodeB.port() );
+            Signal<Position> positions;
+            Signal<Samples> samples;
+            positions.setName( "Test::positions" );
+            samples.setName( "Test::samples" );
+            SlotFunction<Position,&receivePosition> positionSlot;
+            SlotFunction<Samples,&receiveSamples> samplesSlot;
+            positionSlot.setName( "Test::position" );
+            samplesSlot.setName( "Test::samples" );
+            if( !nodeA.connect( "nodeA/Test::positions", "nodeB/Test::position" ) ||
+                !nodeA.connect( "nodeA/Test::samples", "nodeB/Test::samples" ) ||
+                nodeA.connect( "nodeB/Test::positions", "nodeA/Test::position" ) ||
+                nodeA.connect( "nodeA/Test::positions", "nodeC/Test::position" ) )
+            {
+                cout << "Failed!" << endl;
+                cout << "   Node connections not resolved." << endl;
+                exit(1);
+            }
+
+            // The positions are copied in the batch and the samples are
+            // referenced, the batch is written at once
+            nbrPositions = 0;
+            positionsInOrder = true;
+            samplesSum = 0;
+            for( int i = 0; i < 1000; ++i )
+            {
+                Position::Ptr position( new Position() );
+                position->data.id = i;
+                position->data.x = 0.5 * i;
+                positions.emit( position );
+                if( i % 100 == 0 )
+                {
+                    Samples::Ptr s( new Samples() );
+                    s->data.values[0] = boost::int16_t( i );
+                    s->data.values[511] = 1;
+                    samples.emit( s );
+                }
+            }
+            while( Message::processNext() ) {}
+            nodeA.flush();
+            boost::chrono::steady_clock::time_point deadline =
+                boost::chrono::steady_clock::now() + boost::chrono::seconds( 10 );
+            while( ( nbrPositions != 1000 || samplesSum != 4510 ) &&
+                   boost::chrono::steady_clock::now() < deadline )
+            {
+                if( !nodeB.poll() )
+                    boost::this_thread::yield();
+                while( Message::processNext() ) {}
+            }
+            positions.unregisterName();
+            samples.unregisterName();
+            positionSlot.unregisterName();
+            samplesSlot.unregisterName();
+            if( nbrPositions != 1000 || !positionsInOrder || samplesSum != 4510 ||
+                nodeA.nbrWrites() != 1 || nodeB.nbrDropped() != 0 )
+            {
+                cout << "Failed!" << endl;
+                cout << "   Received " << nbrPositions << " positions and "
+                     << samplesSum << " samples sum in " << nodeA.nbrWrites()
+                     << " writes" << endl;
+                exit(1);
+            }
+        }
+        cout << "Ok" << endl;
+
+        cout << "Test journal           : ";
+        {
+            const string directory = "/tmp/mpo-test-journal";
+            removeJournal( directory );
+            Signal<Position> signal;
+            SlotFunction<Position,&receivePosition> slot;
+            size_t nbrRecords, nbrStalls;
+
+            // The 4096 bytes segments hold 84 records of 48 bytes, a second
+            // writer appends its segments after the first ones
+            for( int run = 0; run < 2; ++run )
+            {
+                JournalWriter journal( directory, 4096 );
+                journal.tap( &signal );
+                for( int i = run * 500; i < run * 500 + 500; ++i )
+                {
+                    Position::Ptr position( new Position() );
+                    position->data.id = i;
+                    position->data.x = 0.5 * i;
+                    signal.emit( position );
+                }
+                while( Message::processNext() ) {}
+                nbrRecords = journal.nbrRecords();
+                nbrStalls = journal.nbrStalls();
+            }
+
+            JournalReplay replay( directory );
+            Link::connect( &replay.output(), &slot );
+            nbrPositions = 0;
+            positionsInOrder = true;
+            size_t nbrReplayed = replay.replay( JournalReplay::RecordedSpeed, 10 );
+            while( Message::processNext() ) {}
+            while( size_t n = replay.replay() )
+            {
+                nbrReplayed += n;
+                while( Message::processNext() ) {}
+            }
+            removeJournal( directory );
+            if( nbrRecords != 500 || nbrReplayed != 1000 || nbrPositions != 1000 ||
+                !positionsInOrder || replay.nbrSegments() != 12 ||
+                replay.nbrDropped() != 0 )
+            {
+                cout << "Failed!" << endl;
+                cout << "   Replayed " << nbrPositions << " positions from "
+                     << replay.nbrSegments() << " segments, " << nbrStalls
+                     << " stalls" << endl;
+                exit(1);
+            }
+
+            // A Message encoded in no byte doesn't end the segment
+            MessageCodec::add( Heartbeat::Type(), &encodeHeartbeat,
+                               &decodeHeartbeat );
+            Signal<Heartbeat> heartbeats;
+            SlotFunction<Heartbeat,&receiveHeartbeat> heartbeatSlot;
+            {
+                JournalWriter journal( directory, 4096 );
+                journal.tap( &signal );
+                journal.tap( &heartbeats );
+                for( int i = 0; i < 2; ++i )
+                {
+                    heartbeats.emit( Heartbeat::Ptr( new Heartbeat() ) );
+                    Position::Ptr position( new Position() );
+                    position->data.id = i;
+                    position->data.x = 0.5 * i;
+                    signal.emit( position );
+                }
+                while( Message::processNext() ) {}
+            }
+            JournalReplay heartbeatReplay( directory );
+            Link::connect( &heartbeatReplay.output(), &slot );
+            Link::connect( &heartbeatReplay.output(), &heartbeatSlot );
+            nbrPositions = 0;
+            positionsInOrder = true;
+            nbrReplayed = heartbeatReplay.replay();
+            while( Message::processNext() ) {}
+            removeJournal( directory );
+            if( nbrReplayed != 4 || nbrPositions != 2 || nbrHeartbeats != 2 ||
+                !positionsInOrder || heartbeatReplay.nbrDropped() != 0 )
+            {
+                cout << "Failed!" << endl;
+                cout << "   Replayed " << nbrReplayed << " records with "
+                     << nbrHeartbeats << " heartbeats" << endl;
+                exit(1);
+            }
+        }
+        cout << "Ok" << endl;
+
+#ifdef MPO_HAS_COROUTINES
+        cout << "Test coroutine slots   : ";
+        {
+            Signal<Ball> signal;
+            BallTasker tasker;
+            SlotFunction<Ball,&countBall> slot;
+            Link::connect( &signal, &tasker.input );
+            Link::connect( &signal, &slot );
+            nbrBallCounted = 0;
+            Ball::Ptr ball( new Ball() );
+
+            // The Tasks run one at a time while the other Slot gets its
+            // Message, the jobs resume the Tasks in the main Domain
+            for( int i = 0; i < 3; ++i )
+                signal.emit( ball );
+            boost::chrono::steady_clock::time_point deadline =
+                boost::chrono::steady_clock::now() + boost::chrono::seconds( 10 );
+            while( tasker.nbrCompleted != 3 &&
+                   boost::chrono::steady_clock::now() < deadline )
+                if( !Message::processNext() )
+                    boost::this_thread::yield();
+            if( tasker.nbrCompleted != 3 || ball->pingCnt != 3 ||
+                tasker.overlapped || tasker.countedWhenResumed != 3 ||
+                tasker.input.running() || tasker.input.pending() )
+            {
+                cout << "Failed!" << endl;
+                cout << "   Completed " << tasker.nbrCompleted
+                     << " Tasks, ping count " << ball->pingCnt
+                     << ", counted " << tasker.countedWhenResumed
+                     << " Message before resuming" << endl;
+                exit(1);
+            }
+        }
+        cout << "Ok" << endl;
+#endif
+
+        cout << "Test scheduler         : ";
+
+        // Four independent ping pong pairs processed by two workers
+        {
+            // The starters are disconnected once the Scheduler moved the
+            // Actions back to the main Domain
+            Signal<Ball> starter[4];
+            Scheduler scheduler( 2 );
+            std::vector<Ball::Ptr> balls;
+            for( int i = 0; i < 4; ++i )
+            {
+                std::string n( 1, char('0' + i) );
+                scheduler.add( *new Ping("PingS" + n) );
+                scheduler.add( *new Pong("PongS" + n) );
+                Link::connect( "PingS" + n + "::output", "PongS" + n + "::input" );
+                Link::connect( "PongS" + n + "::output", "PingS" + n + "::input" );
+                balls.push_back( Ball::Ptr( new Ball() ) );
+                balls.back()->maxCount = 1000;
+            }
+            scheduler.start();
+            for( int i = 0; i < 4; ++i )
+            {
+                std::string n( 1, char('0' + i) );
+                Link::connect( &starter[i], AnySlot::get( "PingS" + n + "::input" ) );
+                starter[i].emit( balls[i] );
+            }
+            scheduler.waitIdle();
+            scheduler.stop();
+            for( int i = 0; i < 4; ++i )
+                if( balls[i]->pingCnt != 1000 || balls[i]->pongCnt != 1000 )
+                {
+                    cout << "Failed!" << endl;
+                    cout << "   Ball " << i << " counters are " << balls[i]->pingCnt
+                         << " and " << balls[i]->pongCnt << endl;
+                    exit(1);
+                }
+
+            // Balls left in flight when the Scheduler is destroyed
+            for( int i = 0; i < 4; ++i )
+            {
+                balls[i]->totCount = 0;
+                balls[i]->maxCount = 100000;
+            }
+            scheduler.start();
+            for( int i = 0; i < 4; ++i )
+                starter[i].emit( balls[i] );
+        }
+
+        // The Actions of the deleted Domains are back in the main Domain
+        for( int i = 0; i < 4; ++i )
+        {
+            std::string n( 1, char('0' + i) );
+            Ping* pingS = static_cast<Ping*>( Action::getAction( "PingS" + n ) );
+            Ball::Ptr mainBall( new Ball() );
+            pingS->start( mainBall, 10 );
+            while( Message::processNext() );
+            if( &pingS->domain() != &Domain::main() || mainBall->pongCnt != 10 )
+            {
+                cout << "Failed!" << endl;
+                cout << "   Action " << pingS->name() << " left in a deleted Domain"
+                     << endl;
+                exit(1);
+            }
+        }
+        cout << "Ok" << endl;
+
+        cout << "Test multi producers   : ";
+
+        SlotFunction<Ball,&countBall> slotCount;
+        Link::connect( &signalBall, &slotCount );
+        Message::setMultiProducer( true );
+        emitBallsFromThreads( signalBall, 4, 10000 );
+        Message::setMultiProducer( false );
+        Link::disconnect( &signalBall, &slotCount );
+        while( Message::processNext() );
+        if( nbrBallCatched != 2 + 40000 )
+        {
+            cout << "Failed!" << endl;
+            cout << "   nbrBallCatched counter is not " << 2 + 40000
+                 << ". Found " << nbrBallCatched << endl;
+            exit(1);
+        }
+
+        // The consumer is notified once while the lanes hold entries
+        {
+            Signal<Ball> signal;
+            Link::connect( &signal, &slotCount );
+            Message::setMultiProducer( true );
+            nbrNotifications = 0;
+            Message::setMessageNotifier( &countNotification );
+            signal.emit( ball );
+            signal.emit( ball );
+            Message::processNext();
+            signal.emit( ball );
+            Message::setMessageNotifier( 0 );
+            Message::setMultiProducer( false );
+            while( Message::processNext() );
+            if( nbrNotifications != 1 )
+            {
+                cout << "Failed!" << endl;
+                cout << "   Consumer notified " << nbrNotifications
+                     << " times for a non empty queue" << endl;
+                exit(1);
+            }
+        }
+        cout << "Ok" << endl;
+
 
         // destroy all objects
         Action::clearActions();
@@ -535,45 +2196,6 @@ int main()
     }
 
 
-    {
-        int nbr = 1000000;
-        cout << "Timing for " << nbr << " MPO signal ping pong : ";
-        cout.flush();
-        class Timer {
-            double m_start, m_stop;
-        public:
-            Timer() { start(); stop(); }
-            double getTime()
-            {
-                struct timeval t;
-                ::gettimeofday( &t, NULL );
-                return double(t.tv_sec) + double(t.tv_usec)/1000000.;
-            }
-
-            void start() { m_start = getTime(); }
-            void stop() { m_stop = getTime(); }
-            double getDelta() { return m_stop - m_start; }
-        } timer;
-
-        Ping* ping = new Ping("Ping");
-        Pong* pong = new Pong("Pong");
-        Link::connect( "Ping::output", "Pong::input");
-        Link::connect( "Pong::output", "Ping::input");
-
-        Ball::Ptr ball( new Ball() );
-        ping->start( ball, nbr );
-
-        timer.start();
-        while( Message::processNext() );
-        timer.stop();
-
-        cout << timer.getDelta() << " seconds " << endl;
-
-    }
-
-
-
-
     return 0;
 }
 
@@ -0,0 +1,153 @@
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Trace.hpp"
+
+using namespace std;
+using namespace MPO;
+
+/*
+    Conversion of a trace file written by Trace::flush() in the Chrome trace
+    JSON format, opened by chrome://tracing and https://ui.perfetto.dev
+
+    Usage: mpo-trace2json trace-file [json-file]
+
+    Each thread is a track of the process. The dispatches are duration
+    events named by the Slot name, or the Message type of unnamed Slots,
+    and the enqueues are instant events.
+*/
+
+/// Read n bytes or exit with an error
+void read( FILE* file, void* data, size_t n )
+{
+    if( n && fread( data, 1, n, file ) != n )
+    {
+        cerr << "Truncated trace file" << endl;
+        exit( 1 );
+    }
+}
+
+/// Read a string preceded by its length
+string readString( FILE* file )
+{
+    boost::uint32_t n = 0;
+    read( file, &n, sizeof(n) );
+    string s( n, ' ' );
+    if( n )
+        read( file, &s[0], n );
+    return s;
+}
+
+/// Return s with the JSON special characters escaped
+string escape( const string& s )
+{
+    string escaped;
+    for( size_t i = 0; i < s.size(); ++i )
+    {
+        if( s[i] == '"' || s[i] == '\\' )
+            escaped += '\\';
+        if( (unsigned char)s[i] >= 0x20 )
+            escaped += s[i];
+    }
+    return escaped;
+}
+
+/// Return an id as hexadecimal string
+string hex( boost::uint64_t id )
+{
+    char buffer[32];
+    sprintf( buffer, "0x%llx", (unsigned long long)id );
+    return buffer;
+}
+
+int main( int argc, char* argv[] )
+{
+    if( argc < 2 || argc > 3 )
+    {
+        cerr << "Usage: mpo-trace2json trace-file [json-file]" << endl;
+        return 1;
+    }
+    FILE* file = fopen( argv[1], "rb" );
+    if( !file )
+    {
+        cerr << "Cannot open " << argv[1] << endl;
+        return 1;
+    }
+    TraceFileHeader header;
+    read( file, &header, sizeof(header) );
+    if( memcmp( header.magic, "MPOTRACE", 8 ) != 0 || header.version != 1 )
+    {
+        cerr << argv[1] << " is not a trace file of version 1" << endl;
+        return 1;
+    }
+    map<boost::uint32_t, string> types;
+    for( boost::uint32_t i = 0; i < header.nbrTypes; ++i )
+    {
+        boost::uint32_t id = 0;
+        read( file, &id, sizeof(id) );
+        types[id] = readString( file );
+    }
+    map<boost::uint64_t, string> slots;
+    for( boost::uint32_t i = 0; i < header.nbrSlots; ++i )
+    {
+        boost::uint64_t slot = 0;
+        read( file, &slot, sizeof(slot) );
+        slots[slot] = readString( file );
+    }
+
+    ofstream output;
+    if( argc == 3 )
+    {
+        output.open( argv[2] );
+        if( !output )
+        {
+            cerr << "Cannot open " << argv[2] << endl;
+            return 1;
+        }
+    }
+    ostream& out = argc == 3 ? output : cout;
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    const char* separator = "\n";
+    double usPerTick = 1e6 / header.ticksPerSecond;
+    for( boost::uint32_t t = 0; t < header.nbrThreads; ++t )
+    {
+        boost::uint32_t thread = 0;
+        boost::uint64_t count = 0;
+        read( file, &thread, sizeof(thread) );
+        read( file, &count, sizeof(count) );
+        for( boost::uint64_t i = 0; i < count; ++i )
+        {
+            TraceRecord r;
+            read( file, &r, sizeof(r) );
+            string type = escape( types[r.type] );
+            map<boost::uint64_t, string>::const_iterator slot = slots.find( r.slot );
+            string name = slot != slots.end() ? escape( slot->second ) : type;
+            const char* phase = r.event == TraceRecord::Enqueue ? "i" :
+                                r.event == TraceRecord::DispatchBegin ? "B" : "E";
+            out << separator << "{\"name\":\""
+                << ( r.event == TraceRecord::Enqueue ? "enqueue " + type : name )
+                << "\",\"cat\":\"" << ( r.event == TraceRecord::Enqueue ?
+                                        "enqueue" : "dispatch" )
+                << "\",\"ph\":\"" << phase << "\"";
+            if( r.event == TraceRecord::Enqueue )
+                out << ",\"s\":\"t\"";
+            char ts[32];
+            boost::int64_t ticks = boost::int64_t( r.ticks - header.baseTicks );
+            sprintf( ts, "%.3f", double( ticks ) * usPerTick );
+            out << ",\"ts\":" << ts << ",\"pid\":1,\"tid\":" << thread
+                << ",\"args\":{\"type\":\"" << type << "\",\"link\":\""
+                << hex( r.link ) << "\",\"slot\":\"" << hex( r.slot )
+                << "\",\"priority\":" << unsigned( r.priority )
+                << ",\"count\":" << r.count << "}}";
+            separator = ",\n";
+        }
+    }
+    out << "\n]}" << endl;
+    fclose( file );
+    return 0;
+}
@@ -0,0 +1,9 @@
+TEMPLATE = app
+CONFIG += console
+CONFIG -= qt
+
+TARGET = mpo-trace2json
+
+INCLUDEPATH += ..
+
+SOURCES += trace2json.cpp